@@ -1,12 +1,160 @@
 #include <iostream>
 #include <cstdint>
+#include <cstdlib>
+#include <string>
 
-#include "gameboy-emulator/core/cpu.hpp"
+#include <GL/freeglut.h>
+
+#include "gameboy-emulator/core/apu.hpp"
+#include "gameboy-emulator/core/ppu.hpp"
+#include "gameboy-emulator/frontend/emulation_thread.hpp"
+#include "gameboy-emulator/frontend/scaler.hpp"
+
+using namespace emulator;
+
+static const int scale = 3;
+static GLuint texture = 0;
+static int last_title = 0;
+static bool filtered = false;
+
+// upload runs of consecutive changed lines of the newest frame
+static void upload(const std::bitset<PPU::height> &dirty, const uint8_t *pixels, const int &factor)
+{
+    int ly = 0;
+    while (ly < PPU::height)
+    {
+        if (!dirty.test(ly))
+        {
+            ly++;
+            continue;
+        }
+
+        int start = ly;
+        while (ly < PPU::height && dirty.test(ly))
+        {
+            ly++;
+        }
+        const int pitch = PPU::width * factor * 4;
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, start * factor, PPU::width * factor, (ly - start) * factor,
+                        GL_RGBA, GL_UNSIGNED_BYTE, pixels + start * factor * pitch);
+    }
+}
+
+// frame counters of a triple buffer, for the window title
+template <typename T>
+static std::string counters(const frontend::TripleBuffer<T> &frames)
+{
+    return "frames " + std::to_string(frames.frames()) + " dropped " + std::to_string(frames.dropped()) +
+           " duplicated " + std::to_string(frames.duplicated());
+}
+
+static void display()
+{
+    if (filtered)
+    {
+        frontend::TripleBuffer<frontend::ScaledFrame> &scaled = frontend::ScalerThread::frames();
+        if (scaled.update())
+        {
+            const frontend::ScaledFrame &frame = scaled.read_buffer();
+            upload(frame.dirty, reinterpret_cast<const uint8_t *>(frame.pixels), frame.factor);
+        }
+    }
+    else
+    {
+        frontend::TripleBuffer<frontend::Frame> &frames = frontend::EmulationThread::frames();
+        if (frames.update())
+        {
+            const frontend::Frame &frame = frames.read_buffer();
+            upload(frame.dirty, frame.pixels, 1);
+        }
+    }
+
+    glClear(GL_COLOR_BUFFER_BIT);
+    glBegin(GL_QUADS);
+    glTexCoord2f(0.0f, 1.0f); glVertex2f(-1.0f, -1.0f);
+    glTexCoord2f(1.0f, 1.0f); glVertex2f(1.0f, -1.0f);
+    glTexCoord2f(1.0f, 0.0f); glVertex2f(1.0f, 1.0f);
+    glTexCoord2f(0.0f, 0.0f); glVertex2f(-1.0f, 1.0f);
+    glEnd();
+    glutSwapBuffers();
+
+    int now = glutGet(GLUT_ELAPSED_TIME);
+    if (now - last_title >= 1000)
+    {
+        // counters of the frames actually presented, which are the scaler's when filtering
+        last_title = now;
+        std::string title = "gameboy-emulator | " + (filtered ? counters(frontend::ScalerThread::frames())
+                                                             : counters(frontend::EmulationThread::frames()));
+        glutSetWindowTitle(title.c_str());
+    }
+}
 
 int main(int argc, char* argv[])
 {
-  
-  uint8_t x = 128;
-  x = x << 1;
-  std::cout << "hello, world!" << std::endl;
+    glutInit(&argc, argv);
+
+    if (argc < 2)
+    {
+        std::cout << "usage: " << argv[0] << " <rom> [nearest|scale2x|scale3x|lcd] [factor]" << std::endl;
+        return 1;
+    }
+
+    frontend::Filter filter = frontend::Filter::NEAREST;
+    int factor = 1;
+    if (argc >= 3)
+    {
+        std::string name = argv[2];
+        if (name == "scale2x") { filter = frontend::Filter::SCALE2X; }
+        else if (name == "scale3x") { filter = frontend::Filter::SCALE3X; }
+        else if (name == "lcd") { filter = frontend::Filter::LCD_GRID; }
+        factor = frontend::filter_factor(filter, argc >= 4 ? std::stoi(argv[3]) : scale);
+        filtered = true;
+    }
+
+    // there is no audio output yet, so don't synthesise any
+    APU::set_enabled(false);
+
+    // builds with GAMEBOY_TRACE write an execution trace to the file this names, for tracedump
+    const char *trace = std::getenv("GAMEBOY_TRACE");
+    // set to print how often each opcode ran, and for how many cycles, on exit
+    const bool profile = std::getenv("GAMEBOY_PROFILE") != nullptr;
+    // names a file to dump the addresses run as opcodes to on exit
+    const char *coverage = std::getenv("GAMEBOY_COVERAGE");
+
+    // emulation runs on its own thread; vsync in glutSwapBuffers only ever stalls this one
+    if (!frontend::EmulationThread::start(argv[1], video::PixelFormat::RGBA8888, true, trace != nullptr ? trace : "",
+                                          profile, coverage != nullptr ? coverage : ""))
+    {
+        std::cout << "could not read " << argv[1] << std::endl;
+        return 1;
+    }
+
+    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);
+    glutInitWindowSize(PPU::width * scale, PPU::height * scale);
+    glutCreateWindow("gameboy-emulator");
+    glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, PPU::width * factor, PPU::height * factor, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glEnable(GL_TEXTURE_2D);
+
+    glutDisplayFunc(display);
+    glutIdleFunc(glutPostRedisplay);
+
+    if (filtered)
+    {
+        // upscaling runs on its own thread too, between emulation and presentation
+        frontend::ScalerThread::start(filter, factor);
+    }
+    glutMainLoop();
+    frontend::ScalerThread::stop();
+    frontend::EmulationThread::stop();
+
+    frontend::TripleBuffer<frontend::Frame> &frames = frontend::EmulationThread::frames();
+    std::cout << "frames: " << frames.frames() << std::endl;
+    std::cout << "dropped: " << frames.dropped() << std::endl;
+    std::cout << "duplicated: " << frames.duplicated() << std::endl;
 }
@@ -0,0 +1,60 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "gameboy-emulator/core/tracer.hpp"
+
+using namespace emulator;
+
+// renders a binary execution trace as text, one instruction per line
+
+static uint16_t get_16(const uint8_t *p)
+{
+    return static_cast<uint16_t>(p[0] | p[1] << 8);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cout << "usage: " << argv[0] << " <trace> [first record] [record count]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream f(argv[1], std::ios::binary);
+    if (!f)
+    {
+        std::cout << "could not read " << argv[1] << std::endl;
+        return 1;
+    }
+
+    uint8_t header[Tracer::header_size];
+    if (!f.read(reinterpret_cast<char *>(header), sizeof(header)) || std::memcmp(header, "GBTR", 4) != 0)
+    {
+        std::cout << argv[1] << " is not a trace" << std::endl;
+        return 1;
+    }
+    if (get_16(header + 4) != Tracer::version || get_16(header + 6) != Tracer::record_size)
+    {
+        std::cout << argv[1] << " is trace version " << get_16(header + 4) << ", expected " << Tracer::version
+                  << std::endl;
+        return 1;
+    }
+
+    const uint64_t first = argc >= 3 ? std::stoull(argv[2]) : 0;
+    const uint64_t count = argc >= 4 ? std::stoull(argv[3]) : UINT64_MAX;
+    f.seekg(static_cast<std::streamoff>(Tracer::header_size + first * Tracer::record_size));
+
+    uint8_t bytes[Tracer::record_size];
+    for (uint64_t i = 0; i < count && f.read(reinterpret_cast<char *>(bytes), sizeof(bytes)); i++)
+    {
+        const TraceRecord r = Tracer::decode(bytes);
+        std::printf("%12llu %04X: %02X %02X %02X  af %04X bc %04X de %04X hl %04X sp %04X\n",
+                    static_cast<unsigned long long>(r.cycle), r.pc, r.bytes[0], r.bytes[1], r.bytes[2], r.af, r.bc,
+                    r.de, r.hl, r.sp);
+    }
+    return 0;
+}
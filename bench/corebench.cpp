@@ -0,0 +1,454 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gameboy-emulator/assembler/assembler.hpp"
+#include "gameboy-emulator/core/alu.hpp"
+#include "gameboy-emulator/core/apu.hpp"
+#include "gameboy-emulator/core/cpu.hpp"
+#include "gameboy-emulator/core/gameboy.hpp"
+#include "gameboy-emulator/core/memory.hpp"
+
+using namespace emulator;
+
+// microbenchmarks of the core, printed as JSON in the layout google benchmark uses,
+// so results from different machines and commits can be compared with its tools
+
+struct Result
+{
+    std::string name;
+    uint64_t iterations;
+    double real_ns; // per iteration
+    double cpu_ns;
+};
+
+static double min_seconds = 0.1;
+static std::string filter;
+static std::vector<Result> results;
+
+// stops the compiler from dropping work whose result is never used
+static volatile uint32_t sink;
+
+/**@brief Time a benchmark, calling batch until min_seconds have passed.
+ *
+ *@param name Name the result is reported under
+ *@param batch Runs some iterations and returns how many, called repeatedly
+ */
+template <typename F> static void measure(const std::string &name, F batch)
+{
+    if (!filter.empty() && name.find(filter) == std::string::npos)
+    {
+        return;
+    }
+
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+    const std::clock_t cpu_start = std::clock();
+    uint64_t iterations = 0;
+    double elapsed = 0.0;
+    while (elapsed < min_seconds)
+    {
+        iterations += batch();
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    }
+    const double cpu = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+    results.push_back({ name, iterations, elapsed * 1e9 / iterations, cpu * 1e9 / iterations });
+}
+
+static std::string hex(const char *format, const int &value)
+{
+    char s[24];
+    std::snprintf(s, sizeof(s), format, value);
+    return s;
+}
+
+// unused opcodes, which lock up the real CPU
+static bool valid(const int &opcode)
+{
+    for (int op : { 0xD3, 0xDB, 0xDD, 0xE3, 0xE4, 0xEB, 0xEC, 0xED, 0xF4, 0xFC, 0xFD })
+    {
+        if (op == opcode)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// CPU::instruction on the flat 64 KiB bus, operands pointing into RAM
+static void bench_instructions()
+{
+    const int batch = 1024;
+    for (int op = 0; op < 512; op++)
+    {
+        if (op < 0x100 && (!valid(op) || op == 0xCB))
+        {
+            continue;
+        }
+        const uint8_t b3 = op < 0x100 ? op : 0xCB;
+        const uint8_t b2 = op < 0x100 ? 0x10 : op & 0xFF;
+        const std::string name = op < 0x100 ? hex("instruction/%02X", op) : hex("instruction/CB%02X", op & 0xFF);
+
+        measure(name, [&]()
+        {
+            // start each batch from the same registers, so pushes and increments stay in range
+            CPU::reset();
+            for (int i = 0; i < batch; i++)
+            {
+                CPU::instruction(b3, b2, 0xC0, 0x00);
+            }
+            return batch;
+        });
+    }
+}
+
+static void bench_alu()
+{
+    const int batch = 4096;
+    auto binary = [&](const std::string &name, alu::alu_8b_f f)
+    {
+        measure("alu/" + name, [&]()
+        {
+            uint8_t x = 0x3C;
+            uint8_t flags = 0;
+            for (int i = 0; i < batch; i++)
+            {
+                f(x, static_cast<uint8_t>(i), flags);
+            }
+            sink = x + flags;
+            return batch;
+        });
+    };
+    auto unary = [&](const std::string &name, alu::rot_8b_f f)
+    {
+        measure("alu/" + name, [&]()
+        {
+            uint8_t x = 0x3C;
+            uint8_t flags = 0;
+            for (int i = 0; i < batch; i++)
+            {
+                f(x, flags);
+                x ^= static_cast<uint8_t>(i);
+            }
+            sink = x + flags;
+            return batch;
+        });
+    };
+
+    binary("add", static_cast<alu::alu_8b_f>(alu::add));
+    binary("adc", alu::adc);
+    binary("sub", alu::sub);
+    binary("sbc", alu::sbc);
+    binary("and", alu::_and);
+    binary("or", alu::_or);
+    binary("xor", alu::_xor);
+    binary("cp", alu::cp);
+    unary("inc", static_cast<alu::rot_8b_f>(alu::inc));
+    unary("dec", static_cast<alu::rot_8b_f>(alu::dec));
+    unary("rlc", alu::rlc);
+    unary("rl", alu::rl);
+    unary("rrc", alu::rrc);
+    unary("rr", alu::rr);
+    unary("sla", alu::sla);
+    unary("sra", alu::sra);
+    unary("srl", alu::srl);
+    unary("swap", alu::swap);
+    unary("daa", alu::daa);
+    unary("cpl", alu::cpl);
+
+    measure("alu/add16", [&]()
+    {
+        uint16_t x = 0x1234;
+        uint8_t flags = 0;
+        for (int i = 0; i < batch; i++)
+        {
+            alu::add(x, static_cast<uint16_t>(i * 0x101), flags);
+        }
+        sink = x + flags;
+        return batch;
+    });
+    measure("alu/add16_signed", [&]()
+    {
+        uint16_t x = 0x1234;
+        uint8_t flags = 0;
+        for (int i = 0; i < batch; i++)
+        {
+            alu::add(x, static_cast<uint8_t>(i), flags);
+        }
+        sink = x + flags;
+        return batch;
+    });
+}
+
+// latency of dependent reads, each address taken from the byte read before, and of writes
+static void bench_bus(const std::string &kind, const uint16_t &base, const uint8_t &mask)
+{
+    const int batch = 4096;
+
+    // a single cycle through the range, so every read depends on the one before
+    const int size = mask + 1;
+    std::vector<uint8_t> order(size);
+    for (int i = 0; i < size; i++)
+    {
+        order[i] = static_cast<uint8_t>((i * 167 + 13) & mask);
+    }
+    for (int i = 0; i < size; i++)
+    {
+        *Memory::get_8b(base | order[i]) = order[(i + 1) % size];
+    }
+
+    measure("bus/read_" + kind, [&]()
+    {
+        uint8_t next = order[0];
+        for (int i = 0; i < batch; i++)
+        {
+            next = Memory::read_8b(base | next);
+        }
+        sink = next;
+        return batch;
+    });
+    measure("bus/write_" + kind, [&]()
+    {
+        for (int i = 0; i < batch; i++)
+        {
+            Memory::write_8b(base | (i & mask), order[i & mask]);
+        }
+        return batch;
+    });
+}
+
+// places a guest loop in work RAM, which bulk copies and fused pairs may run from
+static void poke(const uint16_t &address, const std::vector<uint8_t> &code)
+{
+    for (size_t i = 0; i < code.size(); i++)
+    {
+        *Memory::get_8b(address + i) = code[i];
+    }
+}
+
+// CPU::step over a loop at 0xC000 that ends in JP 0xC000, with and without the fast paths GameBoy::step takes
+static void bench_loop(const std::string &name, const int &iterations)
+{
+    // no event due, so nothing limits a fused pair or a bulk copy
+    const uint64_t never = UINT64_MAX;
+
+    // JP 0xC000, leaving pc one past the opcode there
+    CPU::instruction(0xC3, 0x00, 0xC0, 0x00);
+
+    measure("step/plain_" + name, [&]()
+    {
+        do
+        {
+            CPU::step();
+        } while (CPU::get_registers().pc != 0xC001);
+        return iterations;
+    });
+    measure("step/fast_" + name, [&]()
+    {
+        do
+        {
+            const uint8_t opcode = *Memory::get_8b(CPU::get_registers().pc - 1);
+            if (opcode == 0x2A || opcode == 0x1A || opcode == 0x22)
+            {
+                CPU::bulk(never, never);
+            }
+            CPU::step(never);
+        } while (CPU::get_registers().pc != 0xC001);
+        return iterations;
+    });
+}
+
+static void bench_loops()
+{
+    // LD B,0; DEC B; JR NZ: 256 turns of a pair that is fused
+    poke(0xC000, { 0x06, 0x00, 0x05, 0x20, 0xFD, 0xC3, 0x00, 0xC0 });
+    bench_loop("dec_jr", 0x100);
+
+    // 1 KiB copy from C800 to D000 closed by LD A,B; OR C; JR NZ, run as one bulk operation
+    poke(0xC000, { 0x21, 0x00, 0xC8, 0x11, 0x00, 0xD0, 0x01, 0x00, 0x04,
+                   0x2A, 0x12, 0x13, 0x0B, 0x78, 0xB1, 0x20, 0xF8, 0xC3, 0x00, 0xC0 });
+    bench_loop("copy", 0x400);
+
+    // 256 byte fill of D000 with LD (HL+),A counted down in B
+    poke(0xC000, { 0x21, 0x00, 0xD0, 0x06, 0x00, 0xAF, 0x22, 0x05, 0x20, 0xFC, 0xC3, 0x00, 0xC0 });
+    bench_loop("fill", 0x100);
+}
+
+// whole frames of a synthetic program, LCD on as the boot ROM leaves it
+static void bench_frame(const std::string &name, assembler::Assembler &a)
+{
+    std::vector<uint8_t> image;
+    if (!a.build(image))
+    {
+        std::cerr << "frame/" << name << ": " << a.error() << std::endl;
+        return;
+    }
+    GameBoy::reset();
+    Memory::load_rom(image);
+
+    measure("frame/" + name, []()
+    {
+        GameBoy::run_frame();
+        return 1;
+    });
+}
+
+static void bench_frames()
+{
+    using namespace assembler;
+
+    // tight arithmetic loop
+    {
+        Assembler a;
+        Label top = a.mark();
+        a.ld(R8::B, static_cast<uint8_t>(0x40));
+        Label loop = a.mark();
+        a.inc(R8::A);
+        a.alu(Alu::ADD, R8::B);
+        a.alu(Alu::XOR, R8::C);
+        a.dec(R8::B);
+        a.jr(Cond::NZ, loop);
+        a.jr(top);
+        bench_frame("alu", a);
+    }
+
+    // 4 KiB block copy from C000 to D000, run again and again
+    {
+        Assembler a;
+        Label top = a.mark();
+        a.ld(R16::HL, static_cast<uint16_t>(0xC000));
+        a.ld(R16::DE, static_cast<uint16_t>(0xD000));
+        a.ld(R16::BC, static_cast<uint16_t>(0x1000));
+        Label loop = a.mark();
+        a.ld_a_hli();
+        a.ld_ind_a(R16::DE);
+        a.inc(R16::DE);
+        a.dec(R16::BC);
+        a.ld(R8::A, R8::B);
+        a.alu(Alu::OR, R8::C);
+        a.jr(Cond::NZ, loop);
+        a.jr(top);
+        bench_frame("copy", a);
+    }
+
+    // calls to a routine that saves and restores a register pair
+    {
+        Assembler a;
+        Label routine = a.label();
+        Label top = a.mark();
+        a.call(routine);
+        a.jr(top);
+        a.bind(routine);
+        a.push(R16Stack::BC);
+        a.pop(R16Stack::BC);
+        a.ret();
+        bench_frame("call", a);
+    }
+
+    // waiting for VBlank in HALT, the handler just returning
+    {
+        Assembler a;
+        a.ld(R8::A, static_cast<uint8_t>(0x01));
+        a.ldh_n_a(0xFF);
+        Label top = a.mark();
+        a.ei();
+        a.halt();
+        a.jr(top);
+        a.org(0x0040);
+        a.reti();
+        bench_frame("halt", a);
+    }
+
+    // polling LY until line 144
+    {
+        Assembler a;
+        Label top = a.mark();
+        a.ldh_a_n(0x44);
+        a.alu(Alu::CP, static_cast<uint8_t>(0x90));
+        a.jr(Cond::NZ, top);
+        a.jr(top);
+        bench_frame("poll", a);
+    }
+
+    // calls into each bank of an MBC1 cartridge in turn
+    {
+        Assembler a(8);
+        for (int bank = 1; bank < 8; bank++)
+        {
+            a.section(bank, 0x4000);
+            a.alu(Alu::ADD, static_cast<uint8_t>(bank));
+            a.ret();
+        }
+        a.section(0, 0x0100);
+        Label main = a.label();
+        a.jp(main);
+        a.org(0x0150);
+        a.bind(main);
+        Label top = a.mark();
+        a.ld(R8::B, static_cast<uint8_t>(1));
+        Label loop = a.mark();
+        a.ld(R8::A, R8::B);
+        a.ld_mem_a(0x2000);
+        a.call(a.at(0x4000));
+        a.inc(R8::B);
+        a.ld(R8::A, R8::B);
+        a.alu(Alu::CP, static_cast<uint8_t>(8));
+        a.jr(Cond::NZ, loop);
+        a.jr(top);
+        bench_frame("bank", a);
+    }
+}
+
+static void print_json()
+{
+    char date[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+    std::printf("{\n  \"context\": {\n");
+    std::printf("    \"date\": \"%s\",\n", date);
+    std::printf("    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+    std::printf("    \"min_time\": %g\n", min_seconds);
+    std::printf("  },\n  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result &r = results[i];
+        std::printf("    {\n      \"name\": \"%s\",\n      \"run_type\": \"iteration\",\n", r.name.c_str());
+        std::printf("      \"iterations\": %llu,\n", static_cast<unsigned long long>(r.iterations));
+        std::printf("      \"real_time\": %.4f,\n      \"cpu_time\": %.4f,\n", r.real_ns, r.cpu_ns);
+        std::printf("      \"time_unit\": \"ns\"\n    }%s\n", i + 1 < results.size() ? "," : "");
+    }
+    std::printf("  ]\n}\n");
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc >= 2 && std::string(argv[1]) == "-h")
+    {
+        std::cout << "usage: " << argv[0] << " [seconds per benchmark] [name filter]" << std::endl;
+        return 0;
+    }
+    min_seconds = argc >= 2 ? std::stod(argv[1]) : 0.1;
+    filter = argc >= 3 ? argv[2] : "";
+
+    APU::set_enabled(false);
+
+    // the bus is flat RAM until the first reset maps I/O, so instructions and plain RAM go first
+    bench_instructions();
+    bench_alu();
+    bench_bus("ram", 0xC000, 0xFF);
+
+    GameBoy::reset();
+    // high RAM shares its page with the I/O registers, so it takes the slow path
+    bench_bus("hram", 0xFF80, 0x3F);
+    bench_loops();
+    bench_frames();
+
+    print_json();
+    return 0;
+}
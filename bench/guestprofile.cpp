@@ -0,0 +1,53 @@
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "gameboy-emulator/core/apu.hpp"
+#include "gameboy-emulator/core/gameboy.hpp"
+#include "gameboy-emulator/core/guest_profiler.hpp"
+#include "gameboy-emulator/core/memory.hpp"
+
+using namespace emulator;
+
+// samples where a ROM spends emulated time, printing collapsed stacks for flamegraph.pl or speedscope
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cout << "usage: " << argv[0] << " <rom> [frames] [symbol file] [cycles per sample]" << std::endl;
+        return 1;
+    }
+    const int frames = argc >= 3 ? std::stoi(argv[2]) : 3600;
+    const uint32_t period = argc >= 5 ? static_cast<uint32_t>(std::stoul(argv[4])) : 1024;
+    if (period == 0)
+    {
+        std::cerr << "cycles per sample must be at least 1" << std::endl;
+        return 1;
+    }
+
+    if (argc >= 4 && !GuestProfiler::load_symbols(argv[3]))
+    {
+        std::cerr << "could not read " << argv[3] << std::endl;
+        return 1;
+    }
+
+    APU::set_enabled(false);
+    GameBoy::reset();
+    if (!Memory::load_rom(argv[1]))
+    {
+        std::cerr << "could not read " << argv[1] << std::endl;
+        return 1;
+    }
+
+    GuestProfiler::reset();
+    GuestProfiler::start(period);
+    for (int i = 0; i < frames; i++)
+    {
+        GameBoy::run_frame();
+    }
+    GuestProfiler::stop();
+
+    std::cerr << GuestProfiler::samples() << " samples in " << frames << " frames" << std::endl;
+    GuestProfiler::write_collapsed(std::cout);
+    return 0;
+}
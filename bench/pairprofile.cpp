@@ -0,0 +1,61 @@
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "gameboy-emulator/core/apu.hpp"
+#include "gameboy-emulator/core/gameboy.hpp"
+#include "gameboy-emulator/core/memory.hpp"
+#include "gameboy-emulator/core/opcode_profiler.hpp"
+#include "gameboy-emulator/core/pair_profiler.hpp"
+
+using namespace emulator;
+
+// opcode as printed in the table, CB-prefixed ones as CBxx
+static std::string name(const uint16_t &opcode)
+{
+    char s[8];
+    std::snprintf(s, sizeof(s), opcode & 0x100 ? "CB%02X" : "%02X", opcode & 0xFF);
+    return s;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cout << "usage: " << argv[0] << " <rom> [frames] [pairs]" << std::endl;
+        return 1;
+    }
+    const int frames = argc >= 3 ? std::stoi(argv[2]) : 3600;
+    const int pairs = argc >= 4 ? std::stoi(argv[3]) : 32;
+
+    APU::set_enabled(false);
+    GameBoy::reset();
+    if (!Memory::load_rom(argv[1]))
+    {
+        std::cout << "could not read " << argv[1] << std::endl;
+        return 1;
+    }
+
+    OpcodeProfiler::reset();
+    PairProfiler::reset();
+    PairProfiler::set_enabled(true);
+    for (int i = 0; i < frames; i++)
+    {
+        GameBoy::run_frame();
+    }
+    PairProfiler::set_enabled(false);
+
+    const uint64_t total = PairProfiler::instructions();
+    std::cout << total << " instructions in " << frames << " frames" << std::endl;
+    for (const PairProfiler::Pair &pair : PairProfiler::top(pairs))
+    {
+        std::printf("%-4s %-4s %12llu %6.2f%%\n", name(pair.first).c_str(), name(pair.second).c_str(),
+                    static_cast<unsigned long long>(pair.count), 100.0 * pair.count / total);
+    }
+
+    // and where the cycles went, opcode by opcode
+    std::cout << std::endl;
+    OpcodeProfiler::dump(std::cout);
+    return 0;
+}
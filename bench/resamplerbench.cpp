@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gameboy-emulator/core/apu.hpp"
+#include "gameboy-emulator/core/resampler.hpp"
+
+using namespace emulator;
+
+// resample one second of a 440 Hz tone over and over, returning output frames per second
+static double run(const uint32_t &output_rate, const double &seconds)
+{
+    std::vector<int16_t> input(APU::sample_rate * 2);
+    for (size_t i = 0; i < APU::sample_rate; i++)
+    {
+        int16_t s = static_cast<int16_t>(8000.0 * std::sin(2.0 * 3.14159265358979323846 * 440.0 * i / APU::sample_rate));
+        input[i * 2] = s;
+        input[i * 2 + 1] = -s;
+    }
+
+    std::unique_ptr<Resampler> resampler = std::make_unique<Resampler>(APU::sample_rate, output_rate);
+    int16_t output[1024 * 2];
+
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+    uint64_t frames = 0;
+    size_t offset = 0;
+    while (std::chrono::duration<double>(clock::now() - start).count() < seconds)
+    {
+        for (int block = 0; block < 64; block++)
+        {
+            // vary the ratio the way rate control does
+            resampler->set_fill((frames >> 10) % 2 ? 0.45 : 0.55);
+            size_t n = std::min(resampler->input_needed(1024), APU::sample_rate - offset);
+            resampler->write(&input[offset * 2], n);
+            offset = (offset + n) % APU::sample_rate;
+            frames += resampler->read(output, 1024);
+        }
+    }
+    return frames / std::chrono::duration<double>(clock::now() - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+    const double seconds = argc >= 2 ? std::stod(argv[1]) : 1.0;
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+
+    for (uint32_t rate : { 48000u, 44100u })
+    {
+        double single = run(rate, seconds);
+
+        // one resampler per core, as when recording many instances at once
+        std::vector<double> rates(cores);
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < cores; i++)
+        {
+            threads.emplace_back([&rates, i, rate, seconds] { rates[i] = run(rate, seconds); });
+        }
+        double total = 0.0;
+        for (unsigned i = 0; i < cores; i++)
+        {
+            threads[i].join();
+            total += rates[i];
+        }
+
+        std::cout << APU::sample_rate << " -> " << rate << " Hz stereo" << std::endl;
+        std::cout << "  1 thread:  " << static_cast<uint64_t>(single) << " frames/s ("
+                  << static_cast<uint64_t>(single / rate) << "x real time)" << std::endl;
+        std::cout << "  " << cores << " threads: " << static_cast<uint64_t>(total / cores) << " frames/s per core ("
+                  << static_cast<uint64_t>(total / cores / rate) << " instances per core)" << std::endl;
+    }
+}
@@ -0,0 +1,355 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gameboy-emulator/core/coverage.hpp"
+#include "gameboy-emulator/core/cpu.hpp"
+#include "gameboy-emulator/core/interrupts.hpp"
+#include "gameboy-emulator/core/memory.hpp"
+#include "gameboy-emulator/core/opcode_profiler.hpp"
+
+using namespace emulator;
+
+// differential fuzzing of the interpreter's fast paths against plain instruction stepping
+//
+// every input runs twice from the same state: once the way GameBoy::step drives the CPU,
+// with fused pairs and bulk block copies, and once one instruction at a time through
+// CPU::step() with no horizon, which only ever dispatches single instructions. The fast
+// run must pass through the same instruction boundaries with the same registers and
+// cycle count, and end with the same memory, opcode profile and coverage. Any divergence aborts, which libFuzzer
+// and AFL both report as a crash.
+//
+// input layout:
+//   0-7   A, F, B, C, D, E, H, L
+//   8-9   SP, little endian
+//   10-   code, placed at C000 and repeated through D000-DFFF as data
+
+static constexpr size_t header_size = 10;
+static constexpr size_t max_code = 0x1000;
+static constexpr uint16_t code_start = 0xC000;
+static constexpr uint64_t budget = 4096; // T-cycles run per input
+
+struct Checkpoint
+{
+    uint64_t cycles;
+    registers regs;
+    bool ime;
+};
+
+struct Run
+{
+    std::vector<Checkpoint> checkpoints;
+    std::vector<uint8_t> memory;
+    std::vector<uint64_t> profile; // count and cycles of each opcode
+    std::vector<uint8_t> coverage;
+    bool halted;
+};
+
+// the bus is flat RAM, as nothing here resets Memory and maps I/O
+static void setup(const uint8_t *data, const size_t &size)
+{
+    uint8_t *memory = Memory::get_8b(0x0000);
+    std::memset(memory, 0, 0x10000);
+
+    const size_t code = std::min(size - header_size, max_code);
+    std::memcpy(memory + code_start, data + header_size, code);
+    for (size_t i = 0; code > 0 && i < 0x1000; i++)
+    {
+        memory[0xD000 + i] = data[header_size + i % code];
+    }
+
+    CPU::reset();
+    Interrupts::reset();
+    OpcodeProfiler::reset();
+    Coverage::reset();
+    CPU::set_a(data[0]);
+    CPU::set_f(data[1] & 0xF0);
+    CPU::set_b(data[2]);
+    CPU::set_c(data[3]);
+    CPU::set_d(data[4]);
+    CPU::set_e(data[5]);
+    CPU::set_h(data[6]);
+    CPU::set_l(data[7]);
+    CPU::set_sp(static_cast<uint16_t>(data[8] | data[9] << 8));
+    CPU::set_pc(code_start + 1);
+}
+
+static void checkpoint(Run &run)
+{
+    run.checkpoints.push_back({ CPU::cycles, CPU::get_registers(), Interrupts::master_enabled() });
+}
+
+static void finish(Run &run)
+{
+    const uint8_t *memory = Memory::get_8b(0x0000);
+    run.memory.assign(memory, memory + 0x10000);
+    for (uint16_t op = 0; op < OpcodeProfiler::opcodes; op++)
+    {
+        run.profile.push_back(OpcodeProfiler::count(op));
+        run.profile.push_back(OpcodeProfiler::cycles(op));
+    }
+    run.coverage = Coverage::bitmap();
+    run.halted = CPU::halted;
+}
+
+// unused opcodes lock the CPU up, taking no cycles, so a step that takes none ends the run
+static bool locked_up(const Run &run)
+{
+    const size_t n = run.checkpoints.size();
+    return n >= 2 && run.checkpoints[n - 2].cycles == run.checkpoints[n - 1].cycles;
+}
+
+static bool running(const Run &run, const uint64_t &until)
+{
+    return CPU::cycles < until && !CPU::halted && !locked_up(run);
+}
+
+// one instruction per step, never fused, up to where the fast run ended
+static void run_reference(Run &run, const uint64_t &until, const bool &lock)
+{
+    do
+    {
+        CPU::step();
+        checkpoint(run);
+    } while (running(run, until));
+
+    // a fast run that locked up ran the unused opcode at the cycle the reference stops at, so run it too
+    if (lock && !locked_up(run) && !CPU::halted)
+    {
+        CPU::step();
+        checkpoint(run);
+    }
+    finish(run);
+}
+
+// as GameBoy::step does it, with the budget as the only horizon, though a fused pair may end past it
+static void run_fast(Run &run)
+{
+    do
+    {
+        const uint8_t opcode = *Memory::get_8b(CPU::get_registers().pc - 1);
+        if (opcode == 0x2A || opcode == 0x1A || opcode == 0x22)
+        {
+            CPU::bulk(budget, budget);
+        }
+        CPU::step(budget);
+        checkpoint(run);
+    } while (running(run, budget));
+    finish(run);
+}
+
+static void print(const char *name, const Checkpoint &c)
+{
+    std::fprintf(stderr, "%s: cycles %llu af %04X bc %04X de %04X hl %04X sp %04X pc %04X ime %d\n", name,
+                 static_cast<unsigned long long>(c.cycles), c.regs.af, c.regs.bc, c.regs.de, c.regs.hl, c.regs.sp,
+                 c.regs.pc, c.ime);
+}
+
+[[noreturn]] static void diverged(const std::string &what)
+{
+    std::fprintf(stderr, "divergence: %s\n", what.c_str());
+    std::abort();
+}
+
+static void compare(const Run &reference, const Run &fast)
+{
+    // every boundary the fast run stops at must be one the reference passed through, in the same state
+    size_t r = 0;
+    for (const Checkpoint &f : fast.checkpoints)
+    {
+        while (r < reference.checkpoints.size() && reference.checkpoints[r].cycles < f.cycles)
+        {
+            r++;
+        }
+        if (r == reference.checkpoints.size() || reference.checkpoints[r].cycles != f.cycles)
+        {
+            print("fast", f);
+            diverged("no instruction boundary in the reference at this cycle");
+        }
+
+        const Checkpoint &c = reference.checkpoints[r];
+        if (!(c.regs == f.regs) || c.ime != f.ime)
+        {
+            print("reference", c);
+            print("fast", f);
+            diverged("registers differ");
+        }
+    }
+
+    if (reference.checkpoints.size() != 0 && fast.checkpoints.size() != 0 &&
+        reference.checkpoints.back().cycles != fast.checkpoints.back().cycles)
+    {
+        print("reference", reference.checkpoints.back());
+        print("fast", fast.checkpoints.back());
+        diverged("runs end at different cycles");
+    }
+    if (reference.halted != fast.halted)
+    {
+        diverged("only one run halted");
+    }
+    for (size_t i = 0; i < 0x10000; i++)
+    {
+        if (reference.memory[i] != fast.memory[i])
+        {
+            std::fprintf(stderr, "%04zX: reference %02X fast %02X\n", i, reference.memory[i], fast.memory[i]);
+            diverged("memory differs");
+        }
+    }
+    for (size_t i = 0; i < reference.profile.size(); i++)
+    {
+        if (reference.profile[i] != fast.profile[i])
+        {
+            std::fprintf(stderr, "opcode %03zX %s: reference %llu fast %llu\n", i / 2, i % 2 ? "cycles" : "count",
+                         static_cast<unsigned long long>(reference.profile[i]),
+                         static_cast<unsigned long long>(fast.profile[i]));
+            diverged("opcode profiles differ");
+        }
+    }
+    for (size_t i = 0; i < reference.coverage.size(); i++)
+    {
+        if (reference.coverage[i] != fast.coverage[i])
+        {
+            std::fprintf(stderr, "%04zX: reference %02X fast %02X\n", i * 8, reference.coverage[i], fast.coverage[i]);
+            diverged("coverage differs");
+        }
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (size < header_size)
+    {
+        return 0;
+    }
+
+    Run fast;
+    setup(data, size);
+    run_fast(fast);
+
+    Run reference;
+    setup(data, size);
+    run_reference(reference, fast.checkpoints.back().cycles, locked_up(fast));
+
+    compare(reference, fast);
+    return 0;
+}
+
+#ifndef GAMEBOY_LIBFUZZER
+
+// instruction sequences the fast paths look for, so random inputs reach them often
+static const std::vector<std::vector<uint8_t>> idioms = {
+    { 0x2A, 0x12, 0x13, 0x0B, 0x78, 0xB1, 0x20, 0xF8 }, // LD A,(HL+) / LD (DE),A / INC DE / DEC BC / LD A,B / OR C / JR NZ
+    { 0x1A, 0x22, 0x13, 0x0B, 0x78, 0xB1, 0x20, 0xF8 }, // LD A,(DE) / LD (HL+),A / ... / JR NZ
+    { 0x2A, 0x12, 0x13, 0x05, 0x20, 0xFA },             // LD A,(HL+) / LD (DE),A / INC DE / DEC B / JR NZ
+    { 0x1A, 0x22, 0x13, 0x0D, 0x20, 0xFA },             // LD A,(DE) / LD (HL+),A / INC DE / DEC C / JR NZ
+    { 0x22, 0x05, 0x20, 0xFC },                         // LD (HL+),A / DEC B / JR NZ
+    { 0x22, 0x0D, 0x20, 0xFC },                         // LD (HL+),A / DEC C / JR NZ
+    { 0x78, 0xB1, 0x20, 0x02 },                         // LD A,B / OR C / JR NZ
+    { 0x05, 0x20, 0xFD },                               // DEC B / JR NZ
+    { 0xFE, 0x10, 0x38, 0x01 },                         // CP n / JR C
+    { 0xE6, 0x0F, 0x28, 0xFE },                         // AND n / JR Z
+    { 0x3C, 0x18, 0x00 },                               // INC A / JR
+};
+
+// bodies of the same loops closed by JP NZ,head, which random_input follows with the address it places them at
+static const std::vector<std::vector<uint8_t>> jp_idioms = {
+    { 0x2A, 0x12, 0x13, 0x0B, 0x78, 0xB1 }, // LD A,(HL+) / LD (DE),A / INC DE / DEC BC / LD A,B / OR C
+    { 0x1A, 0x22, 0x13, 0x05 },             // LD A,(DE) / LD (HL+),A / INC DE / DEC B
+    { 0x22, 0x05 },                         // LD (HL+),A / DEC B
+    { 0x22, 0x0D },                         // LD (HL+),A / DEC C
+};
+
+// a random input: registers pointing into RAM, code spliced from idioms and random bytes
+static std::vector<uint8_t> random_input(std::mt19937 &rng)
+{
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<uint8_t> input(header_size);
+    for (uint8_t &b : input)
+    {
+        b = static_cast<uint8_t>(byte(rng));
+    }
+
+    // small counters in B and C, sources and destinations in work RAM, the stack up high
+    input[2] = static_cast<uint8_t>(byte(rng) & 0x1F);
+    input[3] = static_cast<uint8_t>(byte(rng) & 0x3F);
+    input[4] = static_cast<uint8_t>(0xC8 + (byte(rng) & 0x07));
+    input[6] = static_cast<uint8_t>(0xD0 + (byte(rng) & 0x0F));
+    input[8] = 0xFE;
+    input[9] = 0xDF;
+
+    const int pieces = 1 + byte(rng) % 8;
+    for (int i = 0; i < pieces; i++)
+    {
+        if (byte(rng) & 1)
+        {
+            const size_t pick = byte(rng) % (idioms.size() + jp_idioms.size());
+            if (pick < idioms.size())
+            {
+                input.insert(input.end(), idioms[pick].begin(), idioms[pick].end());
+            }
+            else
+            {
+                // code is placed at code_start, so the head is where the body lands in it
+                const uint16_t head = static_cast<uint16_t>(code_start + input.size() - header_size);
+                const std::vector<uint8_t> &body = jp_idioms[pick - idioms.size()];
+                input.insert(input.end(), body.begin(), body.end());
+                input.insert(input.end(), { 0xC2, static_cast<uint8_t>(head), static_cast<uint8_t>(head >> 8) });
+            }
+        }
+        else
+        {
+            for (int n = byte(rng) % 6; n > 0; n--)
+            {
+                input.push_back(static_cast<uint8_t>(byte(rng)));
+            }
+        }
+    }
+    return input;
+}
+
+// without libFuzzer: run each file given, stdin for AFL, or --random N [seed] as a smoke test
+int main(int argc, char* argv[])
+{
+    if (argc >= 3 && std::string(argv[1]) == "--random")
+    {
+        const int count = std::stoi(argv[2]);
+        std::mt19937 rng(argc >= 4 ? std::stoul(argv[3]) : 1);
+        for (int i = 0; i < count; i++)
+        {
+            std::vector<uint8_t> input = random_input(rng);
+            LLVMFuzzerTestOneInput(input.data(), input.size());
+        }
+        std::cout << count << " random inputs agreed" << std::endl;
+        return 0;
+    }
+
+    if (argc < 2)
+    {
+        std::vector<uint8_t> input((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+        return 0;
+    }
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::ifstream f(argv[i], std::ios::binary);
+        if (!f)
+        {
+            std::cout << "could not read " << argv[i] << std::endl;
+            return 1;
+        }
+        std::vector<uint8_t> input((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+    return 0;
+}
+
+#endif
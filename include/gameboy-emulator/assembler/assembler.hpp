@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+namespace emulator::assembler
+{
+
+// operand tables in decoding order, so an operand's value is its index in the table
+
+enum class R8 : uint8_t { B, C, D, E, H, L, IND_HL, A }; // r, IND_HL being (HL)
+enum class R16 : uint8_t { BC, DE, HL, SP };             // rp
+enum class R16Stack : uint8_t { BC, DE, HL, AF };        // rp2
+enum class Cond : uint8_t { NZ, Z, NC, C };              // cc
+enum class Alu : uint8_t { ADD, ADC, SUB, SBC, AND, XOR, OR, CP };
+enum class Rot : uint8_t { RLC, RRC, RL, RR, SLA, SRA, SWAP, SRL };
+
+/**@brief Opcode with the given fields, the inverse of CPU::get_opcode_values.
+ */
+constexpr uint8_t encode(const uint8_t &x, const uint8_t &y, const uint8_t &z)
+{
+    return static_cast<uint8_t>(x << 6 | y << 3 | z);
+}
+
+/**@brief Opcode with the given fields, y split into p and q.
+ */
+constexpr uint8_t encode(const uint8_t &x, const uint8_t &p, const uint8_t &q, const uint8_t &z)
+{
+    return encode(x, static_cast<uint8_t>(p << 1 | q), z);
+}
+
+struct Label
+{
+    int id = -1;
+};
+
+/**@brief Builds SM83 ROM images in-process, for synthetic test and benchmark programs.
+ *
+ * Code is placed at an address in a ROM bank: bank 0 at 0000-3FFF, any other
+ * bank at 4000-7FFF. Images of more than two banks get an MBC1 cartridge header.
+ * Jumps and calls take labels, which may be bound before or after use.
+ */
+class Assembler
+{
+private:
+    enum class Fixup : uint8_t { ABSOLUTE, RELATIVE };
+
+    struct Binding
+    {
+        bool bound;
+        uint16_t address;
+    };
+
+    struct Reference
+    {
+        Fixup kind;
+        int label;
+        size_t offset;  // of the operand in the image
+        uint16_t next;  // address after the instruction, which relative jumps count from
+    };
+
+    std::vector<uint8_t> rom;
+    std::vector<bool> written;
+    std::vector<Binding> labels;
+    std::vector<Reference> references;
+    std::string message;
+
+    int current_bank = 0;
+    uint16_t address = 0x0100;
+
+    void emit(const uint8_t &b);
+    void emit(const uint8_t &b, const uint8_t &n);
+    void emit(const uint8_t &b, const uint16_t &nn);
+    void emit(const uint8_t &b, const Fixup &kind, const Label &l);
+    void fail(const std::string &m);
+
+public:
+    /**@brief Start an empty image, every byte 0xFF as in an erased ROM.
+     *
+     *@param banks Number of 16 KiB ROM banks, a power of two from 2 to 128
+     */
+    explicit Assembler(const int &banks = 2);
+
+    /**@brief Place the following code at an address in the current bank.
+     */
+    void org(const uint16_t &a);
+
+    /**@brief Place the following code in another bank.
+     *
+     *@param bank ROM bank
+     *@param a Address, 0000-3FFF for bank 0 and 4000-7FFF for any other
+     */
+    void section(const int &bank, const uint16_t &a);
+
+    /**@brief Address the next instruction is placed at.
+     */
+    uint16_t here() const;
+
+    /**@brief A new label, to be bound later.
+     */
+    Label label();
+
+    /**@brief Bind a label to the next instruction.
+     */
+    void bind(const Label &l);
+
+    /**@brief A new label bound to the next instruction, for jumping back to.
+     */
+    Label mark();
+
+    /**@brief A label bound to a fixed address, such as a routine in RAM.
+     */
+    Label at(const uint16_t &a);
+
+    void db(const std::initializer_list<uint8_t> &bytes);
+    void dw(const uint16_t &w);
+
+    void nop();
+    void stop();
+    void halt();
+    void di();
+    void ei();
+    void rlca();
+    void rrca();
+    void rla();
+    void rra();
+    void daa();
+    void cpl();
+    void scf();
+    void ccf();
+
+    void ld(const R8 &dst, const R8 &src);
+    void ld(const R8 &dst, const uint8_t &n);
+    void ld(const R16 &dst, const uint16_t &nn);
+    void ld(const R16 &dst, const Label &l);
+    void ld_ind_a(const R16 &rp);   // LD (BC),A / LD (DE),A
+    void ld_a_ind(const R16 &rp);   // LD A,(BC) / LD A,(DE)
+    void ld_hli_a();                // LD (HL+),A
+    void ld_hld_a();                // LD (HL-),A
+    void ld_a_hli();                // LD A,(HL+)
+    void ld_a_hld();                // LD A,(HL-)
+    void ld_mem_a(const uint16_t &nn); // LD (nn),A
+    void ld_a_mem(const uint16_t &nn); // LD A,(nn)
+    void ldh_n_a(const uint8_t &n);    // LD (FF00+n),A
+    void ldh_a_n(const uint8_t &n);    // LD A,(FF00+n)
+    void ld_c_a();                  // LD (FF00+C),A
+    void ld_a_c();                  // LD A,(FF00+C)
+    void ld_mem_sp(const uint16_t &nn); // LD (nn),SP
+    void ld_sp_hl();
+    void ld_hl_sp(const int8_t &d);     // LD HL,SP+d
+    void add_sp(const int8_t &d);
+
+    void alu(const Alu &op, const R8 &r);
+    void alu(const Alu &op, const uint8_t &n);
+    void inc(const R8 &r);
+    void dec(const R8 &r);
+    void inc(const R16 &rp);
+    void dec(const R16 &rp);
+    void add_hl(const R16 &rp);
+
+    void push(const R16Stack &rp);
+    void pop(const R16Stack &rp);
+
+    void jp(const Label &l);
+    void jp(const Cond &cc, const Label &l);
+    void jp_hl();
+    void jr(const Label &l);
+    void jr(const Cond &cc, const Label &l);
+    void call(const Label &l);
+    void call(const Cond &cc, const Label &l);
+    void ret();
+    void ret(const Cond &cc);
+    void reti();
+    void rst(const uint8_t &vector);
+
+    void rot(const Rot &op, const R8 &r);
+    void bit(const int &b, const R8 &r);
+    void res(const int &b, const R8 &r);
+    void set(const int &b, const R8 &r);
+
+    /**@brief Resolve labels and write out the finished image.
+     *
+     * Images with an MBC1 get its cartridge type, ROM size and header checksum
+     * written at 0147-014D, so code there must jump over the header.
+     *
+     *@param image Set to the ROM image
+     *@return False if a label was never bound, a relative jump is out of range,
+     *        code was placed outside its bank or over the header; see error()
+     */
+    bool build(std::vector<uint8_t> &image);
+
+    /**@brief What went wrong, for the first error found.
+     */
+    const std::string &error() const;
+};
+
+} // namespace emulator::assembler
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+
+#include "gameboy-emulator/core/blip_buffer.hpp"
+#include "gameboy-emulator/core/ring_buffer.hpp"
+
+namespace emulator
+{
+
+class APU
+{
+public:
+    static constexpr uint32_t clock_rate = 4194304;
+    static constexpr uint32_t sample_rate = clock_rate / BlipBuffer::clocks_per_sample;
+
+    // interleaved stereo samples waiting for the audio thread
+    typedef RingBuffer<int16_t, 32768> Output;
+
+    // sound registers:
+    // address  name  description
+    // ---------------------------------------------
+    // FF10     NR10  Channel 1 sweep
+    // FF11     NR11  Channel 1 duty, length
+    // FF12     NR12  Channel 1 envelope
+    // FF13     NR13  Channel 1 period low
+    // FF14     NR14  Channel 1 trigger, length enable, period high
+    // FF16     NR21  Channel 2 duty, length
+    // FF17     NR22  Channel 2 envelope
+    // FF18     NR23  Channel 2 period low
+    // FF19     NR24  Channel 2 trigger, length enable, period high
+    // FF1A     NR30  Channel 3 DAC enable
+    // FF1B     NR31  Channel 3 length
+    // FF1C     NR32  Channel 3 output level
+    // FF1D     NR33  Channel 3 period low
+    // FF1E     NR34  Channel 3 trigger, length enable, period high
+    // FF20     NR41  Channel 4 length
+    // FF21     NR42  Channel 4 envelope
+    // FF22     NR43  Channel 4 frequency, randomness
+    // FF23     NR44  Channel 4 trigger, length enable
+    // FF24     NR50  Master volume
+    // FF25     NR51  Panning
+    // FF26     NR52  Power, channel status
+    // FF30     FF3F  Wave RAM
+
+private:
+    struct Channel
+    {
+        bool enabled;
+        bool dac;
+
+        uint16_t period;      // 11-bit period value from NRx3/NRx4
+        uint8_t phase;        // position in the duty pattern or wave RAM
+        uint64_t next;        // cycle of the next waveform step
+
+        uint16_t length;
+        bool length_enable;
+
+        uint8_t volume;       // envelope volume, or the wave output level shift
+        uint8_t env_period;
+        uint8_t env_timer;
+        bool env_increase;
+
+        uint8_t amplitude;    // current digital output, 0-15
+        int32_t left;         // contribution currently in the left mix
+        int32_t right;        // contribution currently in the right mix
+    };
+
+    static Channel channels[4];
+
+    // channel 1 sweep
+    static bool sweep_enabled;
+    static uint8_t sweep_timer;
+    static uint16_t sweep_shadow;
+
+    // channel 4 linear feedback shift register
+    static uint16_t lfsr;
+
+    // when false the APU is only register storage
+    static bool enabled;
+
+    static bool power;
+    static uint8_t sequencer_step;
+    static uint64_t sequencer_next;
+
+    // master clock cycle the APU has caught up to
+    static uint64_t now;
+
+    static BlipBuffer left;
+    static BlipBuffer right;
+    static Output output_buffer;
+
+    static uint32_t step_period(const int &i);
+    static uint8_t current_amplitude(const int &i);
+    static void refresh(const int &i);
+    static void step_waveform(const int &i);
+    static void step_sequencer();
+    static uint16_t sweep_target();
+    static void trigger(const int &i);
+    static void disable(const int &i);
+    static void catch_up();
+
+public:
+    /**@brief Power the APU up as the boot ROM leaves it, discarding any buffered sound.
+     */
+    static void reset();
+
+    /**@brief Turn sound generation on or off.
+     *
+     * A disabled APU keeps its registers readable and writable but never runs
+     * its channels or produces samples, so emulating it costs nothing.
+     *
+     *@param on True to generate sound
+     */
+    static void set_enabled(const bool &on);
+
+    /**@brief Read a sound register or wave RAM as the CPU sees it, first catching up to the master clock.
+     *
+     *@param address Address in FF10-FF3F
+     */
+    static uint8_t read(const uint16_t &address);
+
+    /**@brief Write a sound register or wave RAM, first catching up to the master clock.
+     *
+     *@param address Address in FF10-FF3F
+     *@param b Byte to write
+     */
+    static void write(const uint16_t &address, const uint8_t &b);
+
+    /**@brief Catch up to the master clock and move every completed sample into the output ring buffer.
+     *
+     * The APU is not clocked per instruction; it only runs when its registers
+     * are accessed and when the frame loop, or anything else wanting samples, calls this.
+     */
+    static void end_frame();
+
+    /**@brief Ring buffer of interleaved stereo samples at sample_rate, drained by the audio thread.
+     */
+    static Output &output();
+};
+
+} // namespace emulator
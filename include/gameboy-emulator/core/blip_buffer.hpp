@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+
+namespace emulator
+{
+
+/**@brief Band-limited step synthesis buffer.
+ *
+ * Instead of being sampled every clock, a waveform is described by the
+ * amplitude changes (deltas) at the clocks where it changes. Each delta is
+ * added as a band-limited step, so the output is free of aliasing, and the
+ * cost only depends on how often the waveform changes.
+ */
+class BlipBuffer
+{
+public:
+    static constexpr int clocks_per_sample = 64;
+    static constexpr int taps = 16;
+    static constexpr int phases = 32;
+    static constexpr int size = 8192;
+
+private:
+    // impulses added so far, one slot per output sample
+    int32_t buffer[size + taps];
+
+    // absolute sample index of buffer[0]
+    uint64_t base;
+
+    int64_t integrator;
+
+public:
+    BlipBuffer();
+
+    /**@brief Discard all samples and restart at a clock.
+     *
+     *@param time Absolute clock of the first sample
+     */
+    void clear(const uint64_t &time);
+
+    /**@brief Add an amplitude change at a clock.
+     *
+     *@param time Absolute clock of the change, not earlier than the first unread sample
+     *@param delta Change in amplitude
+     */
+    void add_delta(const uint64_t &time, const int32_t &delta);
+
+    /**@brief Number of samples complete once every delta before a clock has been added.
+     *
+     *@param time Absolute clock up to which all deltas have been added
+     */
+    int samples_available(const uint64_t &time) const;
+
+    /**@brief Remove completed samples from the buffer.
+     *
+     *@param out Destination of the samples
+     *@param count Number of samples to read, at most samples_available
+     *@param stride Distance between consecutive samples in out, 2 for interleaved stereo
+     */
+    void read_samples(int16_t *out, const int &count, const int &stride);
+};
+
+} // namespace emulator
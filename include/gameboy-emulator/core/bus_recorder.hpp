@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace emulator
+{
+
+/**@brief Records the reads and writes the CPU makes over the bus, in order.
+ *
+ * Only built in when GAMEBOY_BUS_RECORDER is defined; otherwise Memory::read_8b
+ * and Memory::write_8b carry no hook at all. Events go into a fixed buffer,
+ * so recording never allocates. Operand bytes the CPU is handed directly,
+ * and block copies run by CPU::bulk, do not go over the bus and are not recorded.
+ */
+class BusRecorder
+{
+public:
+    // longest instruction sequence worth recording at once
+    static constexpr size_t capacity = 64;
+
+    enum Kind : uint8_t
+    {
+        READ = 1,
+        WRITE = 2
+    };
+
+    struct Event
+    {
+        uint16_t address;
+        uint8_t value;
+        uint8_t kind;
+    };
+
+private:
+    static thread_local bool enabled;
+    static thread_local size_t recorded;
+    static thread_local Event events[capacity];
+
+public:
+    /**@brief Clear what was recorded and start recording.
+     */
+    static void start();
+
+    /**@brief Stop recording, keeping what was recorded.
+     */
+    static void stop();
+
+    /**@brief Record one bus access, dropping it if the buffer is full.
+     *
+     *@param address Address accessed
+     *@param value Byte read or written
+     *@param kind READ or WRITE
+     */
+    static void record(const uint16_t &address, const uint8_t &value, const Kind &kind)
+    {
+        if (enabled)
+        {
+            if (recorded < capacity)
+            {
+                events[recorded] = { address, value, kind };
+            }
+            recorded++;
+        }
+    }
+
+    /**@brief Number of accesses recorded since start, including any dropped.
+     */
+    static size_t count();
+
+    /**@brief True if more accesses were made than the buffer holds.
+     */
+    static bool overflowed();
+
+    /**@brief A recorded access, in the order it was made.
+     *
+     *@param i Index below count and capacity
+     */
+    static const Event &event(const size_t &i);
+};
+
+} // namespace emulator
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace emulator
+{
+
+/**@brief Bitmap of every address run as an opcode, with each ROM bank kept apart.
+ *
+ * Bits are laid out by ROM offset for 0000-7FFF, bank by bank, followed by one bit
+ * per address of 8000-FFFF. A per-page table gives each page's first bit, and bank
+ * switches update the pages of 4000-7FFF, so marking an opcode is a single OR.
+ * Marking is always on and per thread; fused pairs and bulk copies mark every
+ * instruction they replace.
+ *
+ * Dump file layout, little endian: "GBCV", u16 version, u16 ROM banks, then the
+ * bitmap, the lowest address in the lowest bit of each byte.
+ */
+class Coverage
+{
+public:
+    static constexpr uint16_t version = 1;
+    static constexpr size_t header_size = 8;
+
+private:
+    static thread_local std::vector<uint8_t> bits;
+    static thread_local std::array<uint32_t, 256> page_bits;
+    static thread_local uint16_t banks;
+
+public:
+    /**@brief Lay the bitmap out for a cartridge, with bank 1 mapped, and clear it; called by Memory::load_rom.
+     *
+     *@param rom_banks Number of 16 KiB ROM banks
+     */
+    static void layout(const uint16_t &rom_banks);
+
+    /**@brief Point 4000-7FFF at a bank's bits; called by Memory when the bank changes.
+     */
+    static void map_bank(const uint16_t &bank);
+
+    /**@brief Clear the bitmap.
+     */
+    static void reset();
+
+    /**@brief Mark an opcode as run.
+     *
+     *@param address Address of the opcode
+     */
+    static void mark(const uint16_t &address)
+    {
+        const uint32_t bit = page_bits[address >> 8] + (address & 0xFF);
+        bits[bit >> 3] |= static_cast<uint8_t>(1 << (bit & 7));
+    }
+
+    /**@brief Mark a run of bytes, as for the body of a loop.
+     *
+     *@param address First address
+     *@param length Number of bytes, within one bank
+     */
+    static void mark(const uint16_t &address, const uint16_t &length);
+
+    /**@brief True if an opcode was run at an address.
+     *
+     *@param bank ROM bank, ignored outside 4000-7FFF
+     *@param address Address
+     */
+    static bool covered(const uint16_t &bank, const uint16_t &address);
+
+    /**@brief Number of addresses run as an opcode, over every bank.
+     */
+    static uint64_t count();
+
+    /**@brief The bitmap, laid out as in a dump.
+     */
+    static const std::vector<uint8_t> &bitmap();
+
+    /**@brief Write the bitmap to a file.
+     *
+     *@param path File to write, replaced if it exists
+     *@return False if the file could not be written
+     */
+    static bool dump(const std::string &path);
+};
+
+} // namespace emulator
@@ -1,8 +1,9 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
-
-#include "gameboy-emulator/core/alu.hpp"
+#include <utility>
 
 namespace emulator {
 
@@ -14,44 +15,115 @@ struct opcode_values {
     uint8_t q;
 };
 
+struct registers {
+    uint16_t af;
+    uint16_t bc;
+    uint16_t de;
+    uint16_t hl;
+    uint16_t sp;
+    uint16_t pc;
+
+    bool operator==(const registers &o) const
+    {
+        return af == o.af && bc == o.bc && de == o.de && hl == o.hl && sp == o.sp && pc == o.pc;
+    }
+};
+
 class CPU {
 private:
-    static uint16_t af; // lower 8 bits flags register
-    static uint16_t bc;
-    static uint16_t de;
-    static uint16_t hl;
-    static uint16_t sp; // stack pointer
-    static uint16_t pc; // program counter
+    // 8-bit registers, indexed like r[z] in the opcode tables with F in the slot of (HL)
+    static constexpr int B = 0;
+    static constexpr int C = 1;
+    static constexpr int D = 2;
+    static constexpr int E = 3;
+    static constexpr int H = 4;
+    static constexpr int L = 5;
+    static constexpr int F = 6;
+    static constexpr int A = 7;
+
+    // register pairs are assembled from these, high byte first, so nothing depends on host byte order
+    static thread_local uint8_t reg[8];
+    static thread_local uint16_t sp; // stack pointer
+    static thread_local uint16_t pc; // program counter
+
+    /**@brief Read r[z] of the opcode tables, where z == 6 reads (HL) over the bus.
+     */
+    template <int Z> static uint8_t read_r();
+
+    /**@brief Write r[z] of the opcode tables, where z == 6 writes (HL) over the bus.
+     */
+    template <int Z> static void write_r(const uint8_t &b);
+
+    /**@brief Read rp[p] of the opcode tables: BC, DE, HL, SP.
+     */
+    template <int P> static uint16_t read_rp();
+
+    /**@brief Write rp[p] of the opcode tables: BC, DE, HL, SP.
+     */
+    template <int P> static void write_rp(const uint16_t &v);
+
+    /**@brief Read rp2[p] of the opcode tables: BC, DE, HL, AF.
+     */
+    template <int P> static uint16_t read_rp2();
+
+    /**@brief Write rp2[p] of the opcode tables: BC, DE, HL, AF. The low nibble of F always reads 0.
+     */
+    template <int P> static void write_rp2(const uint16_t &v);
 
-    // 8-bit register table
-    static uint8_t *r[8];
+    // alu[y] on a: ADD, ADC, SUB, SBC, AND, XOR, OR, CP
+    template <int Y> static void alu_a(const uint8_t &b);
 
-    // register pairs featuring sp
-    static uint16_t *rp[4];
+    // rot[y]: RLC, RRC, RL, RR, SLA, SRA, SWAP, SRL
+    template <int Y> static void rotate(uint8_t &x);
 
-    // register pairs featuring af
-    static uint16_t *rf[4];
+    // cc[y]: NZ, Z, NC, C
+    template <int Y> static bool condition();
 
-    // arithmetic/logic operations
-    static alu::alu_8b_f al[8];
+    // one handler per opcode, instantiated from the opcode's x, y, z, p and q
+    typedef void (*handler)(const uint8_t &b2, const uint8_t &b1);
+    typedef void (*cb_handler)();
 
-    // rotation/shift operations
-    static alu::rot_8b_f rot[8];
+    template <uint8_t Op> static void execute(const uint8_t &b2, const uint8_t &b1);
+    template <uint8_t Op> static void execute_cb();
 
-    // wrapper functions for alu functions on a
-    static void adda(uint8_t &_, const uint8_t &b, uint8_t &flags);
-    static void adca(uint8_t &_, const uint8_t &b, uint8_t &flags);
-    static void suba(uint8_t &_, const uint8_t &b, uint8_t &flags);
-    static void sbca(uint8_t &_, const uint8_t &b, uint8_t &flags);
-    static void anda(uint8_t &_, const uint8_t &b, uint8_t &flags);
-    static void xora(uint8_t &_, const uint8_t &b, uint8_t &flags);
-    static void ora(uint8_t &_, const uint8_t &b, uint8_t &flags);
-    static void cpa(uint8_t &_, const uint8_t &b, uint8_t &flags);
+    template <std::size_t... I> static constexpr std::array<handler, sizeof...(I)> handler_table(std::index_sequence<I...>);
+    template <std::size_t... I> static constexpr std::array<cb_handler, sizeof...(I)> cb_handler_table(std::index_sequence<I...>);
 
-    static struct opcode_values get_opcode_values(const uint8_t &opcode);
+    static const std::array<handler, 256> handlers;
+    static const std::array<cb_handler, 256> cb_handlers;
+
+    // HALT with IME clear and an interrupt pending: the next opcode is read twice
+    static thread_local bool halt_bug;
+
+    // run a frequent pair of instructions at pc as one, if the first ends before horizon
+    static bool fuse(const uint64_t &horizon);
+
+    // second half of a fused pair: JR or JR cc at pc
+    static void branch(const uint8_t &opcode, const uint8_t &offset);
 
 public:
-    static uint16_t t;
+    /**@brief Split an opcode into the x, y, z, p and q fields the decoding tables are indexed by.
+     *
+     * The assembler encodes instructions from the same fields, so both agree on every table.
+     *
+     *@param opcode Opcode, or the second byte of a CB-prefixed one
+     */
+    static constexpr struct opcode_values get_opcode_values(const uint8_t &opcode)
+    {
+        return {
+            static_cast<uint8_t>((opcode >> 6)),
+            static_cast<uint8_t>((opcode >> 3) & 0b111),
+            static_cast<uint8_t>(opcode & 0b111),
+            static_cast<uint8_t>((opcode >> 4) & 0b11),
+            static_cast<uint8_t>((opcode >> 3) & 0b1)
+        };
+    }
+
+    // master clock: T-cycles executed since reset, which every other component synchronises to
+    static thread_local uint64_t cycles;
+
+    // set by HALT and STOP until an interrupt is pending
+    static thread_local bool halted;
 
     /**@brief Emulate a GameBoy Z80 instruction.
      *
@@ -62,6 +134,50 @@ public:
      */
     static void instruction(const uint8_t &b3, const uint8_t &b2, const uint8_t &b1, const uint8_t &b0);
 
+    /**@brief Current register values, pc pointing one past the next opcode.
+     */
+    static struct registers get_registers()
+    {
+        return { static_cast<uint16_t>(reg[A] << 8 | reg[F]), static_cast<uint16_t>(reg[B] << 8 | reg[C]),
+                 static_cast<uint16_t>(reg[D] << 8 | reg[E]), static_cast<uint16_t>(reg[H] << 8 | reg[L]), sp, pc };
+    }
+
+    /**@brief Push the program counter and jump to an interrupt vector, taking 20 T-cycles.
+     *
+     *@param vector Address of the interrupt handler
+     */
+    static void interrupt(const uint16_t &vector);
+
+    /**@brief Fetch the instruction at the program counter from memory and emulate it.
+     *
+     * Frequent pairs, such as CP n followed by JR cc or DEC r followed by
+     * JR NZ, run as one super-instruction with the same result and cycle
+     * total as the two instructions. That is only done if the first one ends
+     * before the horizon, so nothing could have needed to run between them.
+     *
+     *@param horizon Master clock cycle of the next event, interrupt or PPU mode change; 0 never fuses
+     */
+    static void step(const uint64_t &horizon = 0);
+
+    /**@brief Run a block copy or fill loop at the program counter as one bulk operation.
+     *
+     * Recognises the usual LD A,(HL+)/LD (DE),A/INC DE/DEC BC/LD A,B/OR C/JR NZ
+     * copy and its variants with DE as source, an 8-bit B or C counter, a fill
+     * with LD (HL+),A, or JP NZ closing the loop. Whole iterations are done
+     * at once, leaving registers, flags and cycles exactly as running them
+     * would, and the CPU back at the loop head with the last iteration still
+     * to run. Nothing is done if either range touches I/O or ROM.
+     *
+     *@param horizon Master clock cycle no iteration may end after
+     *@param render Cycle of the next rendered line, a stricter horizon for copies into VRAM or OAM
+     *@return Number of iterations run, 0 if there was no loop or no room for it
+     */
+    static uint32_t bulk(const uint64_t &horizon, const uint64_t &render);
+
+    /**@brief Load the register values the DMG boot ROM leaves behind, ready to run a cartridge at 0x0100.
+     */
+    static void reset();
+
 #ifdef CMAKE_BUILD_TESTING
     /**@brief Helper function for testing to directly set a
      *
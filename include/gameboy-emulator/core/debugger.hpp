@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+namespace emulator
+{
+
+/**@brief Execution breakpoints and memory watchpoints, costing nothing on pages without one.
+ *
+ * Each point flags its page in the Memory page table. GameBoy::step only looks up
+ * the exact address when the opcode's page has a breakpoint, and watched pages take
+ * the bus slow path, which reports accesses to watched addresses. While any point is
+ * set, instructions run one at a time, without fused pairs, block copies or idle loop
+ * skipping, so none can run past a point. Addresses are matched whatever ROM bank is mapped.
+ *
+ * A breakpoint stops before its instruction runs, and GameBoy::step keeps stopping
+ * there until resume() is called; a watchpoint stops after the instruction making
+ * the access. GameBoy::run_frame returns as soon as either is hit, and straight
+ * away while stopped.
+ */
+class Debugger
+{
+public:
+    // kinds of point, combined as a mask
+    static constexpr uint8_t BREAK = 0x01;
+    static constexpr uint8_t READ = 0x02;
+    static constexpr uint8_t WRITE = 0x04;
+
+    struct Hit
+    {
+        uint8_t kind;     // BREAK, READ or WRITE
+        uint16_t address; // breakpoint, or address accessed
+        uint8_t value;    // byte read or written
+    };
+
+private:
+    static thread_local std::map<uint16_t, uint8_t> points;
+    static thread_local bool paused;
+    static thread_local Hit last;
+
+    // the breakpoint stopped at, which lets the instruction run once resumed
+    static thread_local bool resuming;
+    static thread_local uint16_t resume_address;
+
+    static void set(const uint16_t &address, const uint8_t &kinds, const bool &on);
+    static void update_page(const uint8_t &page);
+
+public:
+    /**@brief Stop before the instruction at an address runs.
+     */
+    static void add_breakpoint(const uint16_t &address);
+
+    static void remove_breakpoint(const uint16_t &address);
+
+    /**@brief Stop after an instruction reads or writes an address over the bus.
+     *
+     *@param address Address to watch
+     *@param kinds READ, WRITE or both
+     */
+    static void add_watchpoint(const uint16_t &address, const uint8_t &kinds);
+
+    static void remove_watchpoint(const uint16_t &address, const uint8_t &kinds);
+
+    /**@brief Remove every breakpoint and watchpoint, and resume.
+     */
+    static void clear();
+
+    /**@brief True if any breakpoint or watchpoint is set.
+     */
+    static bool active()
+    {
+        return !points.empty();
+    }
+
+    /**@brief True once a point was hit, until resume().
+     */
+    static bool stopped()
+    {
+        return paused;
+    }
+
+    /**@brief The point hit last.
+     */
+    static const Hit &hit();
+
+    /**@brief Carry on, running the instruction at a breakpoint that was stopped at.
+     */
+    static void resume();
+
+    /**@brief Check for a breakpoint before running an instruction, on pages flagged page_break.
+     *
+     *@param address Address of the opcode
+     *@return True if execution stops here
+     */
+    static bool breakpoint(const uint16_t &address);
+
+    /**@brief Check an access for a watchpoint, on pages flagged page_watch_read or page_watch_write.
+     *
+     *@param address Address accessed
+     *@param value Byte read or written
+     *@param kind READ or WRITE
+     */
+    static void access(const uint16_t &address, const uint8_t &value, const uint8_t &kind);
+};
+
+} // namespace emulator
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+namespace emulator
+{
+
+// every component except the APU keeps its state per thread, so each thread that calls reset() runs its own machine
+class GameBoy
+{
+private:
+    // master clock cycle the PPU has been run up to
+    static thread_local uint64_t ppu_cycles;
+
+    // first cycle at which an event, vblank or the limit could interrupt straight-line execution
+    static uint64_t horizon(const uint64_t &limit);
+
+public:
+    // 154 lines of 456 dots
+    static constexpr uint32_t cycles_per_frame = 70224;
+
+    /**@brief Put the CPU, timer, interrupt controller, PPU, APU and I/O registers into their post boot ROM state.
+     */
+    static void reset();
+
+    /**@brief Run one instruction, or a fused pair of them, then every event that became due.
+     *
+     * A halted CPU instead skips the master clock ahead to the next scheduled
+     * event or vblank, whichever comes first, but not past the limit. Idle
+     * polling loops are skipped the same way, and block copy or fill loops
+     * run in bulk up to the same point. Nothing runs if there is a Debugger
+     * breakpoint on the next instruction.
+     *
+     *@param limit Master clock cycle a halted CPU, idle loop or bulk copy may skip ahead to at most
+     *@return True if the PPU completed a frame
+     */
+    static bool step(const uint64_t &limit = ~0ull);
+
+    /**@brief Run until the PPU completes a frame, or a frame's worth of cycles if the LCD is off.
+     *
+     * Returns early if a Debugger breakpoint or watchpoint is hit.
+     *
+     *@return True if a frame was completed
+     */
+    static bool run_frame();
+};
+
+} // namespace emulator
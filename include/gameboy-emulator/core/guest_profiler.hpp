@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace emulator
+{
+
+/**@brief Samples the guest's call stack at a fixed interval of emulated time, to find where guest code spends it.
+ *
+ * A sample is taken every period T-cycles through the Scheduler, so time spent
+ * halted or in skipped idle loops is sampled where the CPU sits. Call stacks are
+ * followed through CALL, RST, interrupts and RET as GameBoy::step runs them, with
+ * each frame dropped once the stack pointer has moved above its return address,
+ * so routines that return by other means do not pile up. Locations are a ROM bank
+ * and an address, named from an RGBDS symbol file if one is loaded.
+ */
+class GuestProfiler
+{
+private:
+    struct Frame
+    {
+        uint32_t caller; // location of the call, bank << 16 | address
+        uint16_t sp;     // where the return address was pushed
+    };
+
+    static constexpr size_t max_depth = 64;
+
+    static thread_local bool enabled;
+    static thread_local uint32_t period;
+    static thread_local std::vector<Frame> frames;
+    static thread_local std::map<std::vector<uint32_t>, uint64_t> stacks;
+    static thread_local uint64_t total;
+    static thread_local std::map<uint32_t, std::string> symbols;
+
+    static void sample(const uint64_t &deadline);
+    static void call(const uint16_t &caller);
+    static void unwind(const uint16_t &sp);
+
+public:
+    /**@brief Start sampling on the calling thread, from the current cycle.
+     *
+     * GameBoy::reset cancels the sampling event, so start after it.
+     *
+     *@param cycles T-cycles between samples
+     *@return False, without starting, if cycles is zero
+     */
+    static bool start(const uint32_t &cycles);
+
+    /**@brief Stop sampling, keeping the samples taken.
+     */
+    static void stop();
+
+    /**@brief True while sampling.
+     */
+    static bool active()
+    {
+        return enabled;
+    }
+
+    /**@brief Clear every sample and the call stack.
+     */
+    static void reset();
+
+    /**@brief Follow the call stack through the instruction GameBoy::step just ran.
+     *
+     *@param opcode Opcode of the instruction
+     *@param before pc before it ran, one past the opcode
+     */
+    static void observe(const uint8_t &opcode, const uint16_t &before);
+
+    /**@brief Push a frame for an interrupt being taken, called by CPU::interrupt.
+     *
+     *@param interrupted pc of the instruction the handler returns to
+     */
+    static void interrupt(const uint16_t &interrupted);
+
+    /**@brief Load names from an RGBDS symbol file, lines of "BB:AAAA name".
+     *
+     *@param path Path of the .sym file
+     *@return False if the file could not be read
+     */
+    static bool load_symbols(const std::string &path);
+
+    /**@brief Name of a location: the nearest symbol at or before it in the same memory region,
+     *        or the bank and address in hex.
+     *
+     *@param bank ROM bank, 0 outside 4000-7FFF
+     *@param address Address
+     */
+    static std::string name(const uint16_t &bank, const uint16_t &address);
+
+    /**@brief Number of samples taken.
+     */
+    static uint64_t samples();
+
+    /**@brief Write the samples as collapsed stacks, "outer;inner count" per line, as flamegraph tools read.
+     *
+     *@param out Stream to write to
+     */
+    static void write_collapsed(std::ostream &out);
+};
+
+} // namespace emulator
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+
+#include "gameboy-emulator/core/cpu.hpp"
+
+namespace emulator
+{
+
+/**@brief Detects busy-wait loops and lets the run loop skip them.
+ *
+ * A taken backward branch marks a candidate loop head. The next iteration is
+ * run with the bus monitored. If it made no writes, read nothing but memory,
+ * IF/IE and LCD registers, and came back to the head with every register
+ * unchanged, then every later iteration is identical until something it
+ * reads can change: an event, vblank, or for loops polling LY or STAT the
+ * next line or PPU mode change. Whole iterations up to that point can be skipped with
+ * the same observable result.
+ */
+class IdleLoop
+{
+private:
+    static constexpr int max_steps = 32;
+    static constexpr int rejected_size = 64;
+
+    static thread_local bool enabled;
+
+    // loop being watched
+    static thread_local bool watching;
+    static thread_local uint16_t head;
+    static thread_local int steps;
+    static thread_local struct registers entry;
+    static thread_local uint64_t entry_cycles;
+
+    // confirmed loop
+    static thread_local uint32_t period;
+    static thread_local uint8_t accesses;
+
+    // heads found not to be idle, not watched again until forget()
+    static thread_local uint16_t rejected[rejected_size];
+
+    static thread_local uint64_t skipped;
+
+    static void reject();
+
+public:
+    /**@brief Stop watching and clear the statistic.
+     */
+    static void reset();
+
+    /**@brief Turn detection on or off.
+     *
+     *@param on True to detect and skip idle loops
+     */
+    static void set_enabled(const bool &on);
+
+    /**@brief Look at the instruction just run and report a confirmed idle loop.
+     *
+     *@param before Program counter before the instruction
+     *@return Cycles per iteration of a confirmed idle loop the CPU is at the head of, 0 otherwise
+     */
+    static uint32_t observe(const uint16_t &before);
+
+    /**@brief Kinds of access the confirmed loop made, Memory::access_* flags.
+     */
+    static uint8_t reads();
+
+    /**@brief Skip whole iterations of the confirmed loop, stopping at least one iteration before a cycle.
+     *
+     *@param horizon Earliest master clock cycle at which something the loop reads may change
+     */
+    static void skip(const uint64_t &horizon);
+
+    /**@brief Allow rejected loop heads to be watched again, in case the code changed.
+     */
+    static void forget();
+
+    /**@brief Number of cycles skipped since reset.
+     */
+    static uint64_t skipped_cycles();
+};
+
+} // namespace emulator
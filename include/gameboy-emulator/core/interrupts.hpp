@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+
+namespace emulator
+{
+
+class Interrupts
+{
+private:
+    // interrupt registers:
+    // address  name  description
+    // ---------------------------------------------
+    // FF0F     IF    Interrupt flags, requested interrupts
+    // FFFF     IE    Interrupt enable
+
+    // interrupt master enable
+    static thread_local bool ime;
+
+    // set by EI, IME follows once the next instruction has run
+    static thread_local bool ime_delayed;
+
+    static uint8_t pending();
+    static void update();
+    static void service(const uint64_t &deadline);
+
+public:
+    // interrupt sources, in order of priority
+    static constexpr uint8_t vblank = 0x01;
+    static constexpr uint8_t stat = 0x02;
+    static constexpr uint8_t timer = 0x04;
+    static constexpr uint8_t serial = 0x08;
+    static constexpr uint8_t joypad = 0x10;
+
+    /**@brief Clear IME, as at the end of the boot ROM.
+     */
+    static void reset();
+
+    /**@brief Request interrupts by setting their IF bits.
+     *
+     *@param mask Interrupt sources to request
+     */
+    static void request(const uint8_t &mask);
+
+    /**@brief Set IME after the next instruction, as EI does.
+     */
+    static void enable();
+
+    /**@brief Set IME immediately, as RETI does.
+     */
+    static void enable_now();
+
+    /**@brief Clear IME, as DI does.
+     */
+    static void disable();
+
+    /**@brief True if IME is set.
+     */
+    static bool master_enabled();
+
+    /**@brief True if an enabled interrupt is requested, whatever IME is.
+     */
+    static bool requested();
+
+    /**@brief Read IF or IE.
+     *
+     *@param address FF0F or FFFF
+     */
+    static uint8_t read(const uint16_t &address);
+
+    /**@brief Write IF or IE.
+     *
+     *@param address FF0F or FFFF
+     *@param b Byte to write
+     */
+    static void write(const uint16_t &address, const uint8_t &b);
+};
+
+} // namespace emulator
@@ -1,6 +1,12 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
+#include <vector>
+
+#ifdef GAMEBOY_BUS_RECORDER
+#include "gameboy-emulator/core/bus_recorder.hpp"
+#endif
 
 namespace emulator
 {
@@ -24,12 +30,162 @@ private:
     // FF80     FFFE     High RAM
     // FFFF     FFFF     Interrupt enable register
 
-    static uint8_t registers[65536];
+    static thread_local uint8_t registers[65536];
+
+    // per 256 byte page, non-zero if accesses need to go through read_slow/write_slow
+    static thread_local uint8_t page_flags[256];
+
+    // accesses seen while monitoring
+    static thread_local uint8_t monitored_accesses;
+
+    // whole cartridge ROM, with the selected bank copied into 4000-7FFF
+    static thread_local std::vector<uint8_t> rom;
+    static thread_local bool mbc1;             // the cartridge banks its ROM through an MBC1
+    static thread_local uint8_t rom_bank_low;  // MBC1 2000-3FFF, 5 bits
+    static thread_local uint8_t rom_bank_high; // MBC1 4000-5FFF, 2 bits
+    static thread_local uint16_t rom_bank;     // bank mapped at 4000-7FFF
+
+    static void monitor_access(const uint16_t &address, const bool &write);
+    static void write_mbc(const uint16_t &address, const uint8_t &b);
+    static void map_rom_bank();
+    static uint8_t read_slow(const uint16_t &address);
+    static void write_slow(const uint16_t &address, const uint8_t &b);
 
 public:
+    // page flags
+    static constexpr uint8_t page_io = 0x01;      // page holds memory mapped I/O registers
+    static constexpr uint8_t page_monitor = 0x02; // accesses to the page are being recorded
+    static constexpr uint8_t page_mbc = 0x04;     // the page is cartridge ROM, writes go to its bank controller if any
+    static constexpr uint8_t page_watch_read = 0x08;  // the page holds a read watchpoint
+    static constexpr uint8_t page_watch_write = 0x10; // the page holds a write watchpoint
+    static constexpr uint8_t page_break = 0x20;       // the page holds an execution breakpoint
+
+    // page flags that send reads down the slow path, reads of ROM stay fast under a bank controller
+    static constexpr uint8_t page_read = page_io | page_monitor | page_watch_read;
+
+    // page flags the Debugger owns, kept across resets
+    static constexpr uint8_t page_debug = page_watch_read | page_watch_write | page_break;
+
+    // kinds of access recorded by monitor
+    static constexpr uint8_t access_write = 0x01; // any write
+    static constexpr uint8_t access_ram = 0x02;   // read of memory or a register only the CPU and events change
+    static constexpr uint8_t access_ly = 0x04;    // read of LY, which changes every line
+    static constexpr uint8_t access_stat = 0x08;  // read of STAT, which changes every PPU mode
+    static constexpr uint8_t access_io = 0x10;    // read of any other I/O register
+
     static uint8_t *get_8b(const uint16_t &address);
     static uint16_t *get_16b(const uint16_t &address);
 
+    // read_8b and write_8b are defined here so the plain memory path inlines into the CPU
+
+    /**@brief Read a byte over the bus, as the CPU does, going through I/O handlers where mapped.
+     *
+     *@param address Address to read
+     */
+    static uint8_t read_8b(const uint16_t &address)
+    {
+#ifdef GAMEBOY_BUS_RECORDER
+        const uint8_t b = (page_flags[address >> 8] & page_read) ? read_slow(address) : registers[address];
+        BusRecorder::record(address, b, BusRecorder::READ);
+        return b;
+#else
+        if (page_flags[address >> 8] & page_read)
+        {
+            return read_slow(address);
+        }
+        return registers[address];
+#endif
+    }
+
+    /**@brief Write a byte over the bus, as the CPU does, going through I/O handlers where mapped.
+     *
+     *@param address Address to write
+     *@param b Byte to write
+     */
+    static void write_8b(const uint16_t &address, const uint8_t &b)
+    {
+#ifdef GAMEBOY_BUS_RECORDER
+        BusRecorder::record(address, b, BusRecorder::WRITE);
+#endif
+        if (page_flags[address >> 8])
+        {
+            write_slow(address, b);
+            return;
+        }
+        registers[address] = b;
+    }
+
+    /**@brief True if an address's page has any of a set of page flags.
+     *
+     *@param address Any address in the page
+     *@param flags page_* flags
+     */
+    static bool flagged(const uint16_t &address, const uint8_t &flags)
+    {
+        return page_flags[address >> 8] & flags;
+    }
+
+    /**@brief Set or clear page flags of a page.
+     *
+     *@param page Page number, the high byte of its addresses
+     *@param flags page_* flags
+     *@param on True to set them
+     */
+    static void set_flags(const uint8_t &page, const uint8_t &flags, const bool &on);
+
+    /**@brief True if a range of addresses is plain memory, with no I/O mapped and nothing monitoring it.
+     *
+     * ROM under a bank controller counts as plain, since only writes to it are trapped.
+     * Watched pages are not plain, as every access to them has to be seen.
+     *
+     *@param address First address of the range
+     *@param length Number of bytes, the range must not wrap past FFFF
+     */
+    static bool plain(const uint16_t &address, const uint32_t &length);
+
+    /**@brief Start or stop recording the kinds of data access made over the bus.
+     *
+     * While recording every access takes the slow path, so this is only meant
+     * to be switched on for a few instructions at a time.
+     *
+     *@param on True to start recording, clearing what was recorded before
+     */
+    static void monitor(const bool &on);
+
+    /**@brief Kinds of access recorded since monitoring started, access_* flags.
+     */
+    static uint8_t monitored();
+
+    /**@brief Load a cartridge ROM image into the ROM area of the memory map.
+     *
+     *@param path Path of the ROM file
+     *@return False if the file could not be read
+     */
+    static bool load_rom(const std::string &path);
+
+    /**@brief Load a cartridge ROM image held in memory, such as one built by the assembler.
+     *
+     * Cartridges whose header (0147) names an MBC1 get its ROM banking: bank 1
+     * is mapped at 4000-7FFF and writes to 2000-5FFF select another. External
+     * RAM is left as plain, always enabled RAM, and the banking mode at
+     * 6000-7FFF is ignored. Any other cartridge is a flat 32 KiB ROM. Writes to
+     * 0000-7FFF never change the ROM, whatever the cartridge.
+     *
+     *@param image Whole ROM image, a multiple of 16 KiB
+     *@return False if the image is empty
+     */
+    static bool load_rom(const std::vector<uint8_t> &image);
+
+    /**@brief ROM bank mapped at 4000-7FFF.
+     */
+    static uint16_t bank();
+
+    /**@brief Set the I/O registers to the values the DMG boot ROM leaves behind and map I/O handlers.
+     *
+     * Until this is called the bus is a flat 64 KiB of RAM, which is what the CPU tests expect.
+     */
+    static void reset();
+
 #ifdef CMAKE_BUILD_TESTING
     static void write(const uint8_t &b, const uint16_t &address);
     static void write(const uint16_t &b, const uint16_t &address);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+namespace emulator::oam
+{
+
+// object attribute memory holds 40 objects of 4 bytes each:
+// byte  description
+// ---------------------------------------------
+// 0     Y position plus 16
+// 1     X position plus 8
+// 2     Tile index
+// 3     Attributes (priority, y flip, x flip, palette)
+
+/**@brief Find the objects of OAM that overlap a scanline, as the OAM scan of mode 2 does.
+ *
+ *@param oam Pointer to the 160 bytes of object attribute memory
+ *@param ly Scanline to test against
+ *@param size Object height, 8 or 16
+ *@return Bitmask with bit i set if object i overlaps the line
+ */
+uint64_t scan(const uint8_t *oam, const uint8_t &ly, const uint8_t &size);
+
+/**@brief Select the (at most 10) objects drawn on a scanline, ordered by drawing priority.
+ *
+ * Lower x positions take priority, ties going to the lower OAM index.
+ *
+ *@param oam Pointer to the 160 bytes of object attribute memory
+ *@param ly Scanline to select objects for
+ *@param size Object height, 8 or 16
+ *@param selected Array of 10 receiving the OAM indices of the selected objects
+ *@return Number of objects selected
+ */
+int select(const uint8_t *oam, const uint8_t &ly, const uint8_t &size, uint8_t *selected);
+
+} // namespace emulator::oam
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace emulator
+{
+
+/**@brief Counts how often each opcode runs and the T-cycles it takes, to find where emulated time goes.
+ *
+ * Opcodes are numbered as in PairProfiler: 0x000-0x0FF, and 0x100-0x1FF for
+ * CB-prefixed ones. Counting is always on and costs two increments of a
+ * per-thread array, so the counts are of the instructions run on the calling
+ * thread. Fused pairs and bulk block copies count the instructions they stand in for;
+ * polling loops IdleLoop skips do not, their cycles are in IdleLoop::skipped_cycles().
+ */
+class OpcodeProfiler
+{
+public:
+    static constexpr int opcodes = 512;
+
+    struct Entry
+    {
+        uint16_t opcode;
+        uint64_t count;
+        uint64_t cycles;
+    };
+
+private:
+    static thread_local uint64_t counts[opcodes];
+    static thread_local uint64_t times[opcodes];
+
+public:
+    /**@brief Clear every count on the calling thread.
+     */
+    static void reset();
+
+    /**@brief Record instructions run.
+     *
+     *@param opcode Opcode, or 0x100 plus the second byte for CB-prefixed instructions
+     *@param cycles T-cycles they took in total
+     *@param n Number of times the instruction ran
+     */
+    static void record(const uint16_t &opcode, const uint64_t &cycles, const uint64_t &n = 1)
+    {
+        counts[opcode] += n;
+        times[opcode] += cycles;
+    }
+
+    /**@brief Number of times an opcode ran.
+     */
+    static uint64_t count(const uint16_t &opcode);
+
+    /**@brief T-cycles spent running an opcode.
+     */
+    static uint64_t cycles(const uint16_t &opcode);
+
+    /**@brief Number of instructions recorded.
+     */
+    static uint64_t instructions();
+
+    /**@brief The opcodes that took the most cycles, most first.
+     *
+     *@param n Number of opcodes to return at most
+     */
+    static std::vector<Entry> top(const size_t &n);
+
+    /**@brief Print every opcode that ran, the most cycles first, as a table.
+     *
+     *@param out Stream to print to
+     */
+    static void dump(std::ostream &out);
+};
+
+} // namespace emulator
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace emulator
+{
+
+/**@brief Counts how often each opcode follows each other opcode, to find pairs worth fusing.
+ *
+ * Opcodes are numbered 0x000-0x0FF, and 0x100-0x1FF for CB-prefixed ones.
+ * While profiling, GameBoy::step records every instruction and runs pairs
+ * and block copies unfused, so the counts are of the plain instruction stream.
+ * Profiling and counts are per thread, like the rest of the emulator state.
+ */
+class PairProfiler
+{
+public:
+    static constexpr int opcodes = 512;
+
+    struct Pair
+    {
+        uint16_t first;
+        uint16_t second;
+        uint64_t count;
+    };
+
+private:
+    static thread_local bool enabled;
+    static thread_local uint16_t previous;
+    static thread_local uint64_t total;
+
+    // opcodes * opcodes counts, allocated once a thread first profiles
+    static thread_local std::vector<uint32_t> counts;
+
+public:
+    /**@brief Clear every count.
+     */
+    static void reset();
+
+    /**@brief Start or stop profiling, without clearing the counts.
+     *
+     *@param on True to record instructions
+     */
+    static void set_enabled(const bool &on);
+
+    /**@brief True while profiling.
+     */
+    static bool active()
+    {
+        return enabled;
+    }
+
+    /**@brief Record the next instruction run.
+     *
+     *@param opcode Opcode, or 0x100 plus the second byte for CB-prefixed instructions
+     */
+    static void record(const uint16_t &opcode)
+    {
+        counts[previous * opcodes + opcode]++;
+        previous = opcode;
+        total++;
+    }
+
+    /**@brief Number of times one opcode was directly followed by another.
+     *
+     *@param first Opcode run first
+     *@param second Opcode run right after it
+     */
+    static uint64_t count(const uint16_t &first, const uint16_t &second);
+
+    /**@brief Number of instructions recorded, which is also the number of pairs.
+     */
+    static uint64_t instructions();
+
+    /**@brief The most frequent pairs, most frequent first.
+     *
+     *@param n Number of pairs to return at most
+     */
+    static std::vector<Pair> top(const size_t &n);
+};
+
+} // namespace emulator
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+
+namespace emulator
+{
+
+class PPU
+{
+public:
+    static constexpr int width = 160;
+    static constexpr int height = 144;
+
+    // lcd registers:
+    // address  name  description
+    // ---------------------------------------------
+    // FF40     LCDC  LCD control
+    // FF41     STAT  LCD status
+    // FF42     SCY   Background viewport y
+    // FF43     SCX   Background viewport x
+    // FF44     LY    Current scanline
+    // FF45     LYC   Scanline compare
+    // FF47     BGP   Background palette
+    // FF48     OBP0  Object palette 0
+    // FF49     OBP1  Object palette 1
+    // FF4A     WY    Window y
+    // FF4B     WX    Window x plus 7
+
+    // each pixel is stored as (palette << 2) | colour index, palette being
+    // 0 for BGP, 1 for OBP0 and 2 for OBP1
+    static thread_local uint8_t framebuffer[height][width];
+
+    // BGP, OBP0, OBP1 as they were when each line was drawn
+    static thread_local uint8_t palettes[height][3];
+
+private:
+    static thread_local uint32_t dot;
+    static thread_local uint8_t window_line;
+
+    // per-line hash of the previous frame, used to detect changed lines
+    static thread_local uint64_t line_hash[height];
+
+    // lines of the last completed frame that differ from the frame before
+    static thread_local std::bitset<height> dirty;
+
+    // lines changed so far in the frame being drawn
+    static thread_local std::bitset<height> pending;
+
+    static uint64_t hash_line(const uint8_t &ly);
+    static void end_frame();
+
+public:
+    /**@brief Restart the PPU at the beginning of line 0, with every line marked as changed.
+     */
+    static void reset();
+
+    /**@brief Advance the PPU by a number of T-cycles, drawing any scanlines completed.
+     *
+     *@param t Number of T-cycles elapsed
+     *@return True if a frame was completed
+     */
+    static bool tick(const uint32_t &t);
+
+    /**@brief Number of T-cycles until the PPU next requests an interrupt, the start of vblank.
+     *
+     * Nothing the PPU does before then can wake a halted CPU.
+     */
+    static uint32_t cycles_to_vblank();
+
+    /**@brief Number of T-cycles until LY next changes.
+     */
+    static uint32_t cycles_to_line_change();
+
+    /**@brief Number of T-cycles until STAT's mode or LY next changes.
+     */
+    static uint32_t cycles_to_mode_change();
+
+    /**@brief Draw background, window and objects of a scanline into the framebuffer.
+     *
+     *@param ly Scanline to draw
+     */
+    static void render_line(const uint8_t &ly);
+
+    /**@brief Check if a line of the last completed frame differs from the frame before it.
+     *
+     *@param ly Scanline to check
+     */
+    static bool line_dirty(const uint8_t &ly);
+
+    /**@brief Get every line of the last completed frame that differs from the frame before it.
+     */
+    static const std::bitset<height> &dirty_lines();
+
+    /**@brief Mark every line as changed, e.g. after the consumer lost its copy of the frame.
+     */
+    static void invalidate();
+};
+
+} // namespace emulator
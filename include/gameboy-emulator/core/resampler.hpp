@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace emulator
+{
+
+/**@brief Stereo polyphase windowed-sinc resampler with dynamic rate control.
+ *
+ * Converts interleaved int16 stereo from one rate to another. The conversion
+ * ratio can be nudged by a fraction of a percent around its nominal value so
+ * a consumer can keep its input queue at a target fill level; such small
+ * pitch changes are inaudible but stop the queue from slowly draining or
+ * overflowing when the two clocks drift.
+ */
+class Resampler
+{
+public:
+    static constexpr int taps = 16;
+    static constexpr int phases = 256;
+    static constexpr size_t capacity = 4096;
+
+    // largest relative change of the ratio rate control may apply
+    static constexpr double max_adjust = 0.005;
+
+private:
+    // filter coefficients of each phase, every tap duplicated for the left and right channel
+    alignas(16) float kernel[phases][taps * 2];
+
+    // interleaved input not yet consumed
+    alignas(16) float history[(capacity + taps) * 2];
+    size_t count;
+
+    // position of the next output frame in history, 32.32 fixed point input frames
+    uint64_t position;
+
+    // nominal and current input frames per output frame, 32.32 fixed point
+    uint64_t nominal_step;
+    uint64_t step;
+
+public:
+    /**@brief Set up a resampler.
+     *
+     *@param input_rate Sample rate of the input
+     *@param output_rate Sample rate of the output
+     */
+    Resampler(const uint32_t &input_rate, const uint32_t &output_rate);
+
+    /**@brief Discard all buffered input and return to the nominal ratio.
+     */
+    void clear();
+
+    /**@brief Adjust the ratio from the fill level of the queue feeding the resampler.
+     *
+     * A queue more than half full is consumed slightly faster than nominal,
+     * one less than half full slightly slower.
+     *
+     *@param fill Fill level of the queue, 0 to 1
+     */
+    void set_fill(const double &fill);
+
+    /**@brief Add input frames.
+     *
+     *@param in Interleaved stereo input
+     *@param frames Number of stereo frames
+     *@return Number of frames accepted
+     */
+    size_t write(const int16_t *in, const size_t &frames);
+
+    /**@brief Produce output frames from the buffered input.
+     *
+     *@param out Interleaved stereo output
+     *@param frames Maximum number of stereo frames
+     *@return Number of frames produced
+     */
+    size_t read(int16_t *out, const size_t &frames);
+
+    /**@brief Number of input frames needed before read can produce a number of output frames.
+     *
+     *@param frames Number of output frames wanted
+     */
+    size_t input_needed(const size_t &frames) const;
+};
+
+} // namespace emulator
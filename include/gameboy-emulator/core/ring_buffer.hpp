@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace emulator
+{
+
+/**@brief Lock-free single producer, single consumer ring buffer of N elements.
+ *
+ * N must be a power of two. Indices run freely and are masked on access, so
+ * the full capacity is usable.
+ */
+template <typename T, size_t N>
+class RingBuffer
+{
+private:
+    static_assert((N & (N - 1)) == 0, "capacity must be a power of two");
+
+    T data[N];
+
+    // kept on separate cache lines so producer and consumer don't contend
+    alignas(64) std::atomic<size_t> head{0}; // next element to write, owned by the producer
+    alignas(64) std::atomic<size_t> tail{0}; // next element to read, owned by the consumer
+
+public:
+    /**@brief Append elements, as many as fit.
+     *
+     *@param src Elements to append
+     *@param n Number of elements
+     *@return Number of elements written
+     */
+    size_t write(const T *src, const size_t &n)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t free = N - (h - tail.load(std::memory_order_acquire));
+        size_t count = n < free ? n : free;
+        for (size_t i = 0; i < count; i++)
+        {
+            data[(h + i) & (N - 1)] = src[i];
+        }
+        head.store(h + count, std::memory_order_release);
+        return count;
+    }
+
+    /**@brief Remove elements from the front, as many as are available.
+     *
+     *@param dst Destination of the elements
+     *@param n Maximum number of elements
+     *@return Number of elements read
+     */
+    size_t read(T *dst, const size_t &n)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t used = head.load(std::memory_order_acquire) - t;
+        size_t count = n < used ? n : used;
+        for (size_t i = 0; i < count; i++)
+        {
+            dst[i] = data[(t + i) & (N - 1)];
+        }
+        tail.store(t + count, std::memory_order_release);
+        return count;
+    }
+
+    /**@brief Number of elements waiting to be read.
+     */
+    size_t size() const
+    {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    /**@brief Maximum number of elements held.
+     */
+    static constexpr size_t capacity() { return N; }
+};
+
+} // namespace emulator
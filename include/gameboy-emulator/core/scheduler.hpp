@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+
+namespace emulator
+{
+
+class Scheduler
+{
+public:
+    // components with events at an exact master clock cycle
+    enum class Event
+    {
+        TIMER,      // TIMA overflow reload
+        INTERRUPT,  // an interrupt can be taken, or IME is about to be set
+        PROFILE,    // GuestProfiler takes a sample
+        COUNT
+    };
+
+    /**@brief Called once the master clock has reached an event.
+     *
+     *@param deadline Cycle the event was scheduled for, which may be slightly in the past
+     */
+    typedef void (*Handler)(const uint64_t &deadline);
+
+    static constexpr uint64_t never = ~0ull;
+
+private:
+    static thread_local uint64_t deadlines[static_cast<int>(Event::COUNT)];
+    static thread_local Handler handlers[static_cast<int>(Event::COUNT)];
+
+    // earliest of all deadlines
+    static thread_local uint64_t next;
+
+    static void update();
+
+public:
+    /**@brief Cancel every event.
+     */
+    static void reset();
+
+    /**@brief Schedule an event, replacing any earlier schedule of the same event.
+     *
+     *@param event Event to schedule
+     *@param cycle Master clock cycle the event happens at
+     *@param handler Function called when the event is due
+     */
+    static void schedule(const Event &event, const uint64_t &cycle, const Handler &handler);
+
+    /**@brief Cancel an event.
+     *
+     *@param event Event to cancel
+     */
+    static void cancel(const Event &event);
+
+    /**@brief Cycle of the earliest scheduled event, or never.
+     */
+    static uint64_t deadline()
+    {
+        return next;
+    }
+
+    /**@brief Run the handlers of every event due by a cycle, earliest first.
+     *
+     *@param cycle Current master clock cycle
+     */
+    static void dispatch(const uint64_t &cycle);
+};
+
+} // namespace emulator
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+namespace emulator
+{
+
+class Timer
+{
+private:
+    // timer registers:
+    // address  name  description
+    // ---------------------------------------------
+    // FF04     DIV   Upper 8 bits of the 16-bit system counter
+    // FF05     TIMA  Timer counter
+    // FF06     TMA   Timer modulo, reloaded into TIMA on overflow
+    // FF07     TAC   Timer enable and clock select
+
+    // master clock cycle at which the system counter was 0
+    static thread_local uint64_t div_base;
+
+    // TIMA as of tima_base, 256 between an overflow and the reload 4 cycles later
+    static thread_local uint16_t tima;
+    static thread_local uint64_t tima_base;
+
+    static thread_local uint8_t tma;
+    static thread_local uint8_t tac;
+
+    static uint16_t counter(const uint64_t &cycle);
+    static int edge_shift();
+    static bool input(const uint64_t &cycle);
+    static void sync(const uint64_t &cycle);
+    static void increment(const uint64_t &cycle);
+    static void schedule_overflow();
+    static void overflow(const uint64_t &deadline);
+
+public:
+    /**@brief Set the timer registers to their post boot ROM state at the current master clock cycle.
+     */
+    static void reset();
+
+    /**@brief Read a timer register, computed from the master clock.
+     *
+     *@param address Address in FF04-FF07
+     */
+    static uint8_t read(const uint16_t &address);
+
+    /**@brief Write a timer register.
+     *
+     * Writes that make the selected counter bit fall, by resetting DIV or
+     * changing TAC, increment TIMA as they do on hardware.
+     *
+     *@param address Address in FF04-FF07
+     *@param b Byte to write
+     */
+    static void write(const uint16_t &address, const uint8_t &b);
+};
+
+} // namespace emulator
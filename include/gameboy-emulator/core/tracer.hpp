@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "gameboy-emulator/core/cpu.hpp"
+
+namespace emulator
+{
+
+/**@brief One executed instruction, with the machine state before it ran.
+ */
+struct TraceRecord
+{
+    uint64_t cycle;
+    uint16_t pc;       // address of the opcode
+    uint8_t bytes[3];  // opcode and the two bytes after it, whether operands or not
+    uint16_t af, bc, de, hl, sp;
+};
+
+/**@brief Records every instruction run on this thread into a binary trace file.
+ *
+ * CPU::instruction only calls record() when built with GAMEBOY_TRACE defined, and
+ * otherwise has no hook at all. Records go into a lock-free ring buffer owned by the
+ * tracing thread and are written out by a background thread, so the emulation thread
+ * never formats or writes anything. While tracing, GameBoy::step runs instructions one at a
+ * time, without fused pairs or bulk copies, so every instruction is recorded.
+ *
+ * File layout, little endian: "GBTR", u16 version, u16 record size, then records of
+ * u64 cycle, u16 pc, u8 bytes[3], u8 reserved, u16 af, bc, de, hl, sp.
+ */
+class Tracer
+{
+public:
+    static constexpr uint16_t version = 1;
+    static constexpr size_t header_size = 8;
+    static constexpr size_t record_size = 24;
+
+    struct Session;
+
+private:
+    static thread_local Session *session;
+
+    static void append(const TraceRecord &record);
+
+public:
+    /**@brief Start tracing instructions run on the calling thread.
+     *
+     *@param path File to write, replaced if it exists
+     *@return False if the file could not be opened or this thread is already tracing
+     */
+    static bool start(const std::string &path);
+
+    /**@brief Stop tracing on the calling thread, writing out every record first.
+     */
+    static void stop();
+
+    /**@brief True while the calling thread is tracing.
+     */
+    static bool active()
+    {
+        return session != nullptr;
+    }
+
+    /**@brief Record an instruction about to run, if tracing.
+     *
+     *@param cycle Master clock cycle the instruction starts at
+     *@param pc Address of the opcode
+     *@param b3 Opcode
+     *@param b2 Byte after the opcode
+     *@param b1 Byte after that
+     *@param regs Registers before the instruction
+     */
+    static void record(const uint64_t &cycle, const uint16_t &pc, const uint8_t &b3, const uint8_t &b2,
+                       const uint8_t &b1, const registers &regs)
+    {
+        if (session != nullptr)
+        {
+            append({ cycle, pc, { b3, b2, b1 }, regs.af, regs.bc, regs.de, regs.hl, regs.sp });
+        }
+    }
+
+    /**@brief Decode a record as written to the file.
+     *
+     *@param p record_size bytes
+     */
+    static TraceRecord decode(const uint8_t *p);
+};
+
+} // namespace emulator
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+
+#include "gameboy-emulator/core/ppu.hpp"
+
+namespace emulator::video
+{
+
+enum class PixelFormat
+{
+    RGBA8888, // 4 bytes per pixel, r g b a in memory order
+    RGB565,   // 2 bytes per pixel, native endian
+    GRAY8,    // 1 byte per pixel, 0xFF white
+    INDEX2    // 2 bits per pixel holding the colour index 0-3 before BGP/OBP, leftmost pixel in the msbs
+};
+
+/**@brief Number of bytes a scanline of 160 pixels takes up in a pixel format.
+ *
+ *@param format Output pixel format
+ */
+size_t line_size(const PixelFormat &format);
+
+/**@brief Set the RGB colours the four DMG shades are displayed as, rebuilding the lookup tables.
+ *
+ *@param rgb Four 0xRRGGBB colours from lightest to darkest shade
+ */
+void set_colours(const uint32_t rgb[4]);
+
+/**@brief Convert one scanline of the PPU framebuffer into a pixel format.
+ *
+ *@param format Output pixel format
+ *@param ly Scanline to convert
+ *@param dst Destination of line_size(format) bytes
+ */
+void convert_line(const PixelFormat &format, const uint8_t &ly, uint8_t *dst);
+
+/**@brief Convert a set of scanlines of the PPU framebuffer into a pixel format.
+ *
+ *@param format Output pixel format
+ *@param dst Start of the destination image
+ *@param pitch Distance in bytes between consecutive lines of the destination
+ *@param lines Lines to convert, e.g. PPU::dirty_lines()
+ *@return Number of lines converted
+ */
+int convert(const PixelFormat &format, uint8_t *dst, const size_t &pitch, const std::bitset<PPU::height> &lines);
+
+} // namespace emulator::video
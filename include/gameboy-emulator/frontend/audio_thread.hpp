@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+namespace emulator::frontend
+{
+
+/**@brief Receives one period of interleaved stereo samples at the rate given to AudioThread::start.
+ *
+ *@param samples Interleaved left/right samples
+ *@param frames Number of stereo frames
+ *@param user Pointer passed to AudioThread::start
+ */
+typedef void (*AudioSink)(const int16_t *samples, const size_t &frames, void *user);
+
+class AudioThread
+{
+private:
+    static constexpr size_t max_period = 4096;
+
+    static std::thread thread;
+    static std::atomic<bool> running;
+
+    static AudioSink sink;
+    static void *sink_user;
+    static uint32_t rate;
+    static size_t period;
+
+    static std::atomic<uint64_t> periods;
+    static std::atomic<uint64_t> underruns;
+
+    static void run();
+
+public:
+    /**@brief Start draining the APU output ring on its own thread, one period at a time in real time.
+     *
+     * Samples are resampled to the requested rate. The resampling ratio follows
+     * the ring's fill level to hold it near a few periods of latency, and
+     * periods the emulator could not fill in time are completed with silence.
+     *
+     *@param s Sink receiving every period
+     *@param user Pointer passed on to the sink
+     *@param output_rate Sample rate of the sink, such as 48000 or 44100
+     *@param frames Stereo frames per period, at most 4096
+     */
+    static void start(const AudioSink &s, void *user, const uint32_t &output_rate, const size_t &frames);
+
+    /**@brief Stop the audio thread and wait for it to exit.
+     */
+    static void stop();
+
+    /**@brief Number of periods handed to the sink.
+     */
+    static uint64_t period_count();
+
+    /**@brief Number of periods that had to be padded with silence.
+     */
+    static uint64_t underrun_count();
+};
+
+} // namespace emulator::frontend
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <thread>
+
+#include "gameboy-emulator/core/ppu.hpp"
+#include "gameboy-emulator/core/video.hpp"
+#include "gameboy-emulator/frontend/triple_buffer.hpp"
+
+namespace emulator::frontend
+{
+
+struct Frame
+{
+    video::PixelFormat format;
+    size_t pitch;
+    uint64_t number;
+
+    // lines that differ from the previously presented frame
+    std::bitset<PPU::height> dirty;
+
+    uint8_t pixels[PPU::height * PPU::width * 4];
+};
+
+class EmulationThread
+{
+private:
+    static std::thread thread;
+    static std::atomic<bool> running;
+
+    static video::PixelFormat output_format;
+    static bool paced;
+
+    static TripleBuffer<Frame> buffer;
+
+    // lines each buffer is missing since it was last written
+    static std::bitset<PPU::height> stale[3];
+
+    static void run(const std::string &rom, const std::string &trace, const bool &profile, const std::string &coverage,
+                    std::promise<bool> loaded);
+
+public:
+    /**@brief Start running the emulator on its own thread, publishing every completed frame.
+     *
+     * Emulator state is per thread, so the machine is reset and the cartridge
+     * loaded on the emulation thread itself.
+     *
+     *@param rom Path of the ROM file to run
+     *@param format Pixel format of published frames
+     *@param throttle Pace emulation to the DMG frame rate instead of running flat out
+     *@param trace File to write an execution trace to, if built with GAMEBOY_TRACE; empty for none
+     *@param profile Print the opcode profile to standard error when the thread stops
+     *@param coverage File to dump the execution coverage bitmap to when the thread stops; empty for none
+     *@return False if the ROM could not be read, in which case no thread is left running
+     */
+    static bool start(const std::string &rom, const video::PixelFormat &format, const bool &throttle,
+                      const std::string &trace = "", const bool &profile = false, const std::string &coverage = "");
+
+    /**@brief Stop the emulation thread and wait for it to exit.
+     */
+    static void stop();
+
+    /**@brief Frames published by the emulation thread, to be consumed by a single presentation thread.
+     */
+    static TripleBuffer<Frame> &frames();
+};
+
+} // namespace emulator::frontend
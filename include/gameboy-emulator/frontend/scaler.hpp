@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+#include <thread>
+
+#include "gameboy-emulator/core/ppu.hpp"
+#include "gameboy-emulator/frontend/triple_buffer.hpp"
+
+namespace emulator::frontend
+{
+
+enum class Filter
+{
+    NEAREST,  // integer nearest neighbour, factor 1-4
+    SCALE2X,  // AdvMAME2x edge interpolation, factor 2
+    SCALE3X,  // AdvMAME3x edge interpolation, factor 3
+    LCD_GRID  // nearest neighbour with darkened cell borders, factor 2-4
+};
+
+struct ScaledFrame
+{
+    static constexpr int max_factor = 4;
+
+    Filter filter;
+    int factor;
+    uint64_t number;
+
+    // source lines whose scaled rows differ from the previously presented frame
+    std::bitset<PPU::height> dirty;
+
+    // RGBA8888, factor * 160 pixels per row
+    uint32_t pixels[PPU::height * max_factor * PPU::width * max_factor];
+};
+
+/**@brief Scale factor a filter ends up using for a requested factor.
+ *
+ *@param filter Filter to apply
+ *@param factor Requested factor
+ */
+int filter_factor(const Filter &filter, const int &factor);
+
+/**@brief Upscale lines of a 160x144 RGBA8888 image.
+ *
+ *@param filter Filter to apply
+ *@param factor Scale factor, as returned by filter_factor
+ *@param src Source image, 640 bytes per line
+ *@param dst Destination image, factor * 160 pixels per row
+ *@param lines Source lines to scale
+ */
+void scale(const Filter &filter, const int &factor, const uint8_t *src, uint32_t *dst, const std::bitset<PPU::height> &lines);
+
+class ScalerThread
+{
+private:
+    static std::thread thread;
+    static std::atomic<bool> running;
+
+    static Filter filter;
+    static int factor;
+
+    static TripleBuffer<ScaledFrame> buffer;
+
+    // source lines each buffer is missing since it was last written
+    static std::bitset<PPU::height> stale[3];
+
+    static void run();
+
+public:
+    /**@brief Start upscaling frames published by the EmulationThread on a worker thread.
+     *
+     * The scaler becomes the consumer of EmulationThread::frames(), which must be
+     * producing RGBA8888; presentation or capture then reads ScalerThread::frames().
+     *
+     *@param f Filter to apply
+     *@param n Requested scale factor
+     */
+    static void start(const Filter &f, const int &n);
+
+    /**@brief Stop the scaler thread and wait for it to exit.
+     */
+    static void stop();
+
+    /**@brief Upscaled frames, to be consumed by a single presentation or capture thread.
+     */
+    static TripleBuffer<ScaledFrame> &frames();
+};
+
+} // namespace emulator::frontend
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace emulator::frontend
+{
+
+/**@brief Lock-free single producer, single consumer triple buffer.
+ *
+ * The producer always has a buffer to write into and never waits on the consumer.
+ * The consumer always reads the newest published buffer; buffers published
+ * before the consumer got to them are counted as dropped, and consumer updates
+ * that found nothing new are counted as duplicated.
+ */
+template <typename T>
+class TripleBuffer
+{
+private:
+    static constexpr uint8_t fresh = 0x4;
+
+    T buffers[3];
+
+    // owned by the producer and consumer respectively
+    uint8_t back = 0;
+    uint8_t front = 1;
+
+    // buffer in flight between the two, with the fresh bit set when it has not been consumed yet
+    std::atomic<uint8_t> middle{2};
+
+    std::atomic<uint64_t> published{0};
+    std::atomic<uint64_t> dropped_count{0};
+    std::atomic<uint64_t> duplicated_count{0};
+
+public:
+    /**@brief Buffer the producer is filling.
+     */
+    T &write_buffer() { return buffers[back]; }
+
+    /**@brief Index (0-2) of the buffer the producer is filling.
+     */
+    int write_index() const { return back; }
+
+    /**@brief Hand the write buffer over to the consumer and take back a free buffer.
+     *
+     *@return True if the previously published buffer was never consumed, the new write buffer then holds it
+     */
+    bool publish()
+    {
+        uint8_t old = middle.exchange(back | fresh, std::memory_order_acq_rel);
+        back = old & 0x3;
+        published.fetch_add(1, std::memory_order_relaxed);
+        if (old & fresh)
+        {
+            dropped_count.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    /**@brief True if a buffer was published since the consumer last switched, without counting a duplicate.
+     *
+     * For consumers that poll for frames rather than present at a fixed rate.
+     */
+    bool ready() const
+    {
+        return middle.load(std::memory_order_relaxed) & fresh;
+    }
+
+    /**@brief Switch the read buffer to the newest published buffer, if there is one.
+     *
+     *@return True if the read buffer changed
+     */
+    bool update()
+    {
+        if (!(middle.load(std::memory_order_relaxed) & fresh))
+        {
+            duplicated_count.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        uint8_t old = middle.exchange(front, std::memory_order_acq_rel);
+        front = old & 0x3;
+        return true;
+    }
+
+    /**@brief Buffer the consumer is reading.
+     */
+    const T &read_buffer() const { return buffers[front]; }
+
+    /**@brief Number of buffers published by the producer.
+     */
+    uint64_t frames() const { return published.load(std::memory_order_relaxed); }
+
+    /**@brief Number of published buffers replaced before the consumer read them.
+     */
+    uint64_t dropped() const { return dropped_count.load(std::memory_order_relaxed); }
+
+    /**@brief Number of consumer updates that found no new buffer.
+     */
+    uint64_t duplicated() const { return duplicated_count.load(std::memory_order_relaxed); }
+};
+
+} // namespace emulator::frontend
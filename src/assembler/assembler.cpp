@@ -0,0 +1,552 @@
+#include "gameboy-emulator/assembler/assembler.hpp"
+
+#include "gameboy-emulator/core/cpu.hpp"
+
+namespace emulator::assembler
+{
+
+// every opcode must decode back to the fields it is encoded from, so encodings follow the CPU's tables
+static constexpr bool round_trips()
+{
+    for (int op = 0; op < 256; op++)
+    {
+        const opcode_values v = CPU::get_opcode_values(static_cast<uint8_t>(op));
+        if (encode(v.x, v.y, v.z) != op || encode(v.x, v.p, v.q, v.z) != op)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(round_trips(), "encode must be the inverse of CPU::get_opcode_values");
+
+static uint8_t index(const R8 &r)
+{
+    return static_cast<uint8_t>(r);
+}
+
+static uint8_t index(const R16 &rp)
+{
+    return static_cast<uint8_t>(rp);
+}
+
+static uint8_t index(const R16Stack &rp)
+{
+    return static_cast<uint8_t>(rp);
+}
+
+static uint8_t index(const Cond &cc)
+{
+    return static_cast<uint8_t>(cc);
+}
+
+static uint8_t index(const Alu &op)
+{
+    return static_cast<uint8_t>(op);
+}
+
+static uint8_t index(const Rot &op)
+{
+    return static_cast<uint8_t>(op);
+}
+
+Assembler::Assembler(const int &banks)
+    : rom(static_cast<size_t>(banks > 0 ? banks : 0) * 0x4000, 0xFF), written(rom.size(), false)
+{
+    if (banks < 2 || banks > 128 || (banks & (banks - 1)) != 0)
+    {
+        fail("bank count must be a power of two from 2 to 128");
+    }
+}
+
+void Assembler::fail(const std::string &m)
+{
+    if (message.empty())
+    {
+        message = m;
+    }
+}
+
+void Assembler::emit(const uint8_t &b)
+{
+    const bool inside = current_bank == 0 ? address < 0x4000 : (address >= 0x4000 && address < 0x8000);
+    if (!inside)
+    {
+        fail("code placed outside bank " + std::to_string(current_bank));
+        return;
+    }
+
+    const size_t offset = current_bank * 0x4000 + (address & 0x3FFF);
+    rom[offset] = b;
+    written[offset] = true;
+    address++;
+}
+
+void Assembler::emit(const uint8_t &b, const uint8_t &n)
+{
+    emit(b);
+    emit(n);
+}
+
+void Assembler::emit(const uint8_t &b, const uint16_t &nn)
+{
+    emit(b);
+    emit(static_cast<uint8_t>(nn & 0xFF));
+    emit(static_cast<uint8_t>(nn >> 8));
+}
+
+void Assembler::emit(const uint8_t &b, const Fixup &kind, const Label &l)
+{
+    emit(b);
+    const size_t offset = current_bank * 0x4000 + (address & 0x3FFF);
+    const int length = kind == Fixup::RELATIVE ? 1 : 2;
+    references.push_back({ kind, l.id, offset, static_cast<uint16_t>(address + length) });
+    for (int i = 0; i < length; i++)
+    {
+        emit(static_cast<uint8_t>(0x00));
+    }
+}
+
+void Assembler::org(const uint16_t &a)
+{
+    address = a;
+}
+
+void Assembler::section(const int &bank, const uint16_t &a)
+{
+    if (bank < 0 || static_cast<size_t>(bank) * 0x4000 >= rom.size())
+    {
+        fail("no bank " + std::to_string(bank));
+        return;
+    }
+    current_bank = bank;
+    address = a;
+}
+
+uint16_t Assembler::here() const
+{
+    return address;
+}
+
+Label Assembler::label()
+{
+    labels.push_back({ false, 0 });
+    return { static_cast<int>(labels.size()) - 1 };
+}
+
+void Assembler::bind(const Label &l)
+{
+    if (l.id < 0 || l.id >= static_cast<int>(labels.size()) || labels[l.id].bound)
+    {
+        fail("label bound twice or not made by this assembler");
+        return;
+    }
+    labels[l.id] = { true, address };
+}
+
+Label Assembler::mark()
+{
+    Label l = label();
+    bind(l);
+    return l;
+}
+
+Label Assembler::at(const uint16_t &a)
+{
+    labels.push_back({ true, a });
+    return { static_cast<int>(labels.size()) - 1 };
+}
+
+void Assembler::db(const std::initializer_list<uint8_t> &bytes)
+{
+    for (uint8_t b : bytes)
+    {
+        emit(b);
+    }
+}
+
+void Assembler::dw(const uint16_t &w)
+{
+    emit(static_cast<uint8_t>(w & 0xFF));
+    emit(static_cast<uint8_t>(w >> 8));
+}
+
+// x = 0
+
+void Assembler::nop()
+{
+    emit(encode(0, 0, 0));
+}
+
+void Assembler::ld_mem_sp(const uint16_t &nn)
+{
+    emit(encode(0, 1, 0), nn);
+}
+
+void Assembler::stop()
+{
+    emit(encode(0, 2, 0), static_cast<uint8_t>(0x00));
+}
+
+void Assembler::jr(const Label &l)
+{
+    emit(encode(0, 3, 0), Fixup::RELATIVE, l);
+}
+
+void Assembler::jr(const Cond &cc, const Label &l)
+{
+    emit(encode(0, 4 + index(cc), 0), Fixup::RELATIVE, l);
+}
+
+void Assembler::ld(const R16 &dst, const uint16_t &nn)
+{
+    emit(encode(0, index(dst), 0, 1), nn);
+}
+
+void Assembler::ld(const R16 &dst, const Label &l)
+{
+    emit(encode(0, index(dst), 0, 1), Fixup::ABSOLUTE, l);
+}
+
+void Assembler::add_hl(const R16 &rp)
+{
+    emit(encode(0, index(rp), 1, 1));
+}
+
+void Assembler::ld_ind_a(const R16 &rp)
+{
+    if (rp != R16::BC && rp != R16::DE)
+    {
+        fail("LD (rp),A only takes BC or DE");
+    }
+    emit(encode(0, index(rp), 0, 2));
+}
+
+void Assembler::ld_a_ind(const R16 &rp)
+{
+    if (rp != R16::BC && rp != R16::DE)
+    {
+        fail("LD A,(rp) only takes BC or DE");
+    }
+    emit(encode(0, index(rp), 1, 2));
+}
+
+void Assembler::ld_hli_a()
+{
+    emit(encode(0, 2, 0, 2));
+}
+
+void Assembler::ld_hld_a()
+{
+    emit(encode(0, 3, 0, 2));
+}
+
+void Assembler::ld_a_hli()
+{
+    emit(encode(0, 2, 1, 2));
+}
+
+void Assembler::ld_a_hld()
+{
+    emit(encode(0, 3, 1, 2));
+}
+
+void Assembler::inc(const R16 &rp)
+{
+    emit(encode(0, index(rp), 0, 3));
+}
+
+void Assembler::dec(const R16 &rp)
+{
+    emit(encode(0, index(rp), 1, 3));
+}
+
+void Assembler::inc(const R8 &r)
+{
+    emit(encode(0, index(r), 4));
+}
+
+void Assembler::dec(const R8 &r)
+{
+    emit(encode(0, index(r), 5));
+}
+
+void Assembler::ld(const R8 &dst, const uint8_t &n)
+{
+    emit(encode(0, index(dst), 6), n);
+}
+
+void Assembler::rlca()
+{
+    emit(encode(0, 0, 7));
+}
+
+void Assembler::rrca()
+{
+    emit(encode(0, 1, 7));
+}
+
+void Assembler::rla()
+{
+    emit(encode(0, 2, 7));
+}
+
+void Assembler::rra()
+{
+    emit(encode(0, 3, 7));
+}
+
+void Assembler::daa()
+{
+    emit(encode(0, 4, 7));
+}
+
+void Assembler::cpl()
+{
+    emit(encode(0, 5, 7));
+}
+
+void Assembler::scf()
+{
+    emit(encode(0, 6, 7));
+}
+
+void Assembler::ccf()
+{
+    emit(encode(0, 7, 7));
+}
+
+// x = 1 and 2
+
+void Assembler::ld(const R8 &dst, const R8 &src)
+{
+    if (dst == R8::IND_HL && src == R8::IND_HL)
+    {
+        fail("LD (HL),(HL) is HALT");
+    }
+    emit(encode(1, index(dst), index(src)));
+}
+
+void Assembler::halt()
+{
+    emit(encode(1, 6, 6));
+}
+
+void Assembler::alu(const Alu &op, const R8 &r)
+{
+    emit(encode(2, index(op), index(r)));
+}
+
+// x = 3
+
+void Assembler::ret(const Cond &cc)
+{
+    emit(encode(3, index(cc), 0));
+}
+
+void Assembler::ldh_n_a(const uint8_t &n)
+{
+    emit(encode(3, 4, 0), n);
+}
+
+void Assembler::add_sp(const int8_t &d)
+{
+    emit(encode(3, 5, 0), static_cast<uint8_t>(d));
+}
+
+void Assembler::ldh_a_n(const uint8_t &n)
+{
+    emit(encode(3, 6, 0), n);
+}
+
+void Assembler::ld_hl_sp(const int8_t &d)
+{
+    emit(encode(3, 7, 0), static_cast<uint8_t>(d));
+}
+
+void Assembler::pop(const R16Stack &rp)
+{
+    emit(encode(3, index(rp), 0, 1));
+}
+
+void Assembler::ret()
+{
+    emit(encode(3, 0, 1, 1));
+}
+
+void Assembler::reti()
+{
+    emit(encode(3, 1, 1, 1));
+}
+
+void Assembler::jp_hl()
+{
+    emit(encode(3, 2, 1, 1));
+}
+
+void Assembler::ld_sp_hl()
+{
+    emit(encode(3, 3, 1, 1));
+}
+
+void Assembler::jp(const Cond &cc, const Label &l)
+{
+    emit(encode(3, index(cc), 2), Fixup::ABSOLUTE, l);
+}
+
+void Assembler::ld_c_a()
+{
+    emit(encode(3, 4, 2));
+}
+
+void Assembler::ld_mem_a(const uint16_t &nn)
+{
+    emit(encode(3, 5, 2), nn);
+}
+
+void Assembler::ld_a_c()
+{
+    emit(encode(3, 6, 2));
+}
+
+void Assembler::ld_a_mem(const uint16_t &nn)
+{
+    emit(encode(3, 7, 2), nn);
+}
+
+void Assembler::jp(const Label &l)
+{
+    emit(encode(3, 0, 3), Fixup::ABSOLUTE, l);
+}
+
+void Assembler::di()
+{
+    emit(encode(3, 6, 3));
+}
+
+void Assembler::ei()
+{
+    emit(encode(3, 7, 3));
+}
+
+void Assembler::call(const Cond &cc, const Label &l)
+{
+    emit(encode(3, index(cc), 4), Fixup::ABSOLUTE, l);
+}
+
+void Assembler::push(const R16Stack &rp)
+{
+    emit(encode(3, index(rp), 0, 5));
+}
+
+void Assembler::call(const Label &l)
+{
+    emit(encode(3, 0, 1, 5), Fixup::ABSOLUTE, l);
+}
+
+void Assembler::alu(const Alu &op, const uint8_t &n)
+{
+    emit(encode(3, index(op), 6), n);
+}
+
+void Assembler::rst(const uint8_t &vector)
+{
+    if (vector & ~0x38)
+    {
+        fail("RST vectors are multiples of 8 up to 38");
+    }
+    emit(encode(3, (vector >> 3) & 7, 7));
+}
+
+// CB prefixed, the second byte decoded like an opcode
+
+void Assembler::rot(const Rot &op, const R8 &r)
+{
+    emit(encode(3, 1, 3), encode(0, index(op), index(r)));
+}
+
+void Assembler::bit(const int &b, const R8 &r)
+{
+    emit(encode(3, 1, 3), encode(1, static_cast<uint8_t>(b & 7), index(r)));
+}
+
+void Assembler::res(const int &b, const R8 &r)
+{
+    emit(encode(3, 1, 3), encode(2, static_cast<uint8_t>(b & 7), index(r)));
+}
+
+void Assembler::set(const int &b, const R8 &r)
+{
+    emit(encode(3, 1, 3), encode(3, static_cast<uint8_t>(b & 7), index(r)));
+}
+
+bool Assembler::build(std::vector<uint8_t> &image)
+{
+    for (const Reference &ref : references)
+    {
+        if (ref.label < 0 || ref.label >= static_cast<int>(labels.size()) || !labels[ref.label].bound)
+        {
+            fail("jump to a label that was never bound");
+            break;
+        }
+
+        const uint16_t target = labels[ref.label].address;
+        if (ref.kind == Fixup::ABSOLUTE)
+        {
+            rom[ref.offset] = static_cast<uint8_t>(target & 0xFF);
+            rom[ref.offset + 1] = static_cast<uint8_t>(target >> 8);
+            continue;
+        }
+
+        const int distance = target - ref.next;
+        if (distance < -128 || distance > 127)
+        {
+            fail("relative jump out of range at " + std::to_string(ref.next - 2));
+            break;
+        }
+        rom[ref.offset] = static_cast<uint8_t>(distance);
+    }
+
+    // the bank controller is only there if the cartridge header says so
+    const size_t banks = rom.size() / 0x4000;
+    if (banks > 2 && message.empty())
+    {
+        for (size_t i = 0x0134; i <= 0x014D; i++)
+        {
+            if (written[i])
+            {
+                fail("code placed over the cartridge header");
+                break;
+            }
+        }
+
+        rom[0x0147] = 0x01; // MBC1
+        uint8_t size = 0;
+        while ((2u << size) < banks)
+        {
+            size++;
+        }
+        rom[0x0148] = size;
+
+        uint8_t checksum = 0;
+        for (size_t i = 0x0134; i <= 0x014C; i++)
+        {
+            checksum = static_cast<uint8_t>(checksum - rom[i] - 1);
+        }
+        rom[0x014D] = checksum;
+    }
+
+    if (!message.empty())
+    {
+        return false;
+    }
+    image = rom;
+    return true;
+}
+
+const std::string &Assembler::error() const
+{
+    return message;
+}
+
+} // namespace emulator::assembler
@@ -0,0 +1,525 @@
+#include "gameboy-emulator/core/apu.hpp"
+
+#include <initializer_list>
+
+#include "gameboy-emulator/core/cpu.hpp"
+#include "gameboy-emulator/core/memory.hpp"
+
+namespace emulator
+{
+
+APU::Channel APU::channels[4] = {};
+
+bool APU::sweep_enabled = false;
+uint8_t APU::sweep_timer = 0;
+uint16_t APU::sweep_shadow = 0;
+
+uint16_t APU::lfsr = 0x7FFF;
+
+bool APU::enabled = true;
+bool APU::power = false;
+uint8_t APU::sequencer_step = 0;
+uint64_t APU::sequencer_next = 0;
+
+uint64_t APU::now = 0;
+
+BlipBuffer APU::left;
+BlipBuffer APU::right;
+APU::Output APU::output_buffer;
+
+// no waveform event pending
+static constexpr uint64_t never = ~0ull;
+
+// bits read back as 1 from FF10-FF2F, write-only and unused bits
+static const uint8_t read_masks[0x20] = {
+    0x80, 0x3F, 0x00, 0xFF, 0xBF, 0xFF, 0x3F, 0x00, 0xFF, 0xBF, 0x7F, 0xFF, 0x9F, 0xFF, 0xBF, 0xFF,
+    0xFF, 0x00, 0x00, 0xBF, 0x00, 0x00, 0x70, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+static const uint8_t duty_patterns[4] = { 0b00000001, 0b10000001, 0b10000111, 0b01111110 };
+
+static const uint8_t noise_divisors[8] = { 8, 16, 32, 48, 64, 80, 96, 112 };
+
+// first register of each channel, NRx0
+static const uint16_t channel_base[4] = { 0xFF10, 0xFF15, 0xFF1A, 0xFF1F };
+
+static uint8_t reg(const uint16_t &address)
+{
+    return *Memory::get_8b(address);
+}
+
+uint32_t APU::step_period(const int &i)
+{
+    switch (i)
+    {
+    case 0:
+    case 1:
+        return (2048 - channels[i].period) * 4;
+    case 2:
+        return (2048 - channels[i].period) * 2;
+    default:
+    {
+        uint8_t nr43 = reg(0xFF22);
+        return static_cast<uint32_t>(noise_divisors[nr43 & 0x07]) << (nr43 >> 4);
+    }
+    }
+}
+
+uint8_t APU::current_amplitude(const int &i)
+{
+    const Channel &c = channels[i];
+    switch (i)
+    {
+    case 0:
+    case 1:
+    {
+        uint8_t duty = duty_patterns[reg(channel_base[i] + 1) >> 6];
+        return ((duty >> (7 - c.phase)) & 1) ? c.volume : 0;
+    }
+    case 2:
+    {
+        // output level 0 mutes, 1-3 shift the sample right by 0-2
+        uint8_t level = (reg(0xFF1C) >> 5) & 0x03;
+        if (level == 0)
+        {
+            return 0;
+        }
+        uint8_t b = reg(0xFF30 + c.phase / 2);
+        uint8_t sample = (c.phase & 1) ? (b & 0x0F) : (b >> 4);
+        return sample >> (level - 1);
+    }
+    default:
+        return (lfsr & 1) ? 0 : c.volume;
+    }
+}
+
+void APU::refresh(const int &i)
+{
+    Channel &c = channels[i];
+    c.amplitude = (c.enabled && c.dac) ? current_amplitude(i) : 0;
+
+    // only changes in a channel's contribution reach the blip buffers
+    uint8_t nr50 = reg(0xFF24);
+    uint8_t nr51 = reg(0xFF25);
+    int32_t l = (nr51 & (0x10 << i)) ? c.amplitude * (((nr50 >> 4) & 0x07) + 1) * 64 : 0;
+    int32_t r = (nr51 & (0x01 << i)) ? c.amplitude * ((nr50 & 0x07) + 1) * 64 : 0;
+
+    left.add_delta(now, l - c.left);
+    right.add_delta(now, r - c.right);
+    c.left = l;
+    c.right = r;
+}
+
+void APU::step_waveform(const int &i)
+{
+    Channel &c = channels[i];
+    switch (i)
+    {
+    case 0:
+    case 1:
+        c.phase = (c.phase + 1) & 0x07;
+        break;
+    case 2:
+        c.phase = (c.phase + 1) & 0x1F;
+        break;
+    default:
+    {
+        uint16_t x = (lfsr ^ (lfsr >> 1)) & 1;
+        lfsr = static_cast<uint16_t>((lfsr >> 1) | (x << 14));
+        if (reg(0xFF22) & 0x08)
+        {
+            lfsr = static_cast<uint16_t>((lfsr & ~(1 << 6)) | (x << 6));
+        }
+        break;
+    }
+    }
+
+    c.next += step_period(i);
+    refresh(i);
+}
+
+uint16_t APU::sweep_target()
+{
+    uint8_t nr10 = reg(0xFF10);
+    uint16_t delta = sweep_shadow >> (nr10 & 0x07);
+    return (nr10 & 0x08) ? sweep_shadow - delta : sweep_shadow + delta;
+}
+
+void APU::step_sequencer()
+{
+    sequencer_next += 8192;
+
+    // length counters on steps 0, 2, 4 and 6
+    if ((sequencer_step & 1) == 0)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            Channel &c = channels[i];
+            if (c.length_enable && c.length > 0 && --c.length == 0)
+            {
+                disable(i);
+            }
+        }
+    }
+
+    // frequency sweep on steps 2 and 6
+    if (sequencer_step == 2 || sequencer_step == 6)
+    {
+        uint8_t nr10 = reg(0xFF10);
+        uint8_t period = (nr10 >> 4) & 0x07;
+        if (sweep_timer > 0 && --sweep_timer == 0)
+        {
+            sweep_timer = period ? period : 8;
+            if (sweep_enabled && period)
+            {
+                uint16_t target = sweep_target();
+                if (target > 2047)
+                {
+                    disable(0);
+                }
+                else if (nr10 & 0x07)
+                {
+                    sweep_shadow = target;
+                    channels[0].period = target;
+                    *Memory::get_8b(0xFF13) = target & 0xFF;
+                    *Memory::get_8b(0xFF14) = (reg(0xFF14) & 0xF8) | (target >> 8);
+                    if (sweep_target() > 2047)
+                    {
+                        disable(0);
+                    }
+                }
+            }
+        }
+    }
+
+    // volume envelopes on step 7
+    if (sequencer_step == 7)
+    {
+        for (int i : { 0, 1, 3 })
+        {
+            Channel &c = channels[i];
+            if (c.env_period == 0 || --c.env_timer > 0)
+            {
+                continue;
+            }
+
+            c.env_timer = c.env_period;
+            if (c.env_increase && c.volume < 15)
+            {
+                c.volume++;
+                refresh(i);
+            }
+            else if (!c.env_increase && c.volume > 0)
+            {
+                c.volume--;
+                refresh(i);
+            }
+        }
+    }
+
+    sequencer_step = (sequencer_step + 1) & 0x07;
+}
+
+void APU::trigger(const int &i)
+{
+    Channel &c = channels[i];
+    c.enabled = c.dac;
+    if (c.length == 0)
+    {
+        c.length = (i == 2) ? 256 : 64;
+    }
+
+    uint8_t nrx2 = reg(channel_base[i] + 2);
+    c.volume = nrx2 >> 4;
+    c.env_increase = nrx2 & 0x08;
+    c.env_period = nrx2 & 0x07;
+    c.env_timer = c.env_period;
+
+    if (i == 2)
+    {
+        c.phase = 0;
+    }
+    if (i == 3)
+    {
+        lfsr = 0x7FFF;
+    }
+    if (i == 0)
+    {
+        uint8_t nr10 = reg(0xFF10);
+        uint8_t period = (nr10 >> 4) & 0x07;
+        sweep_shadow = c.period;
+        sweep_timer = period ? period : 8;
+        sweep_enabled = period || (nr10 & 0x07);
+        if ((nr10 & 0x07) && sweep_target() > 2047)
+        {
+            c.enabled = false;
+        }
+    }
+
+    c.next = c.enabled ? now + step_period(i) : never;
+    refresh(i);
+}
+
+void APU::disable(const int &i)
+{
+    channels[i].enabled = false;
+    channels[i].next = never;
+    refresh(i);
+}
+
+void APU::reset()
+{
+    // DMG values after the boot ROM
+    static const uint8_t boot[0x17] = {
+        0x80, 0xBF, 0xF3, 0xFF, 0xBF, 0xFF, 0x3F, 0x00, 0xFF, 0xBF, 0x7F, 0xFF,
+        0x9F, 0xFF, 0xBF, 0xFF, 0xFF, 0x00, 0x00, 0xBF, 0x77, 0xF3, 0xF1
+    };
+    for (int i = 0; i < 0x17; i++)
+    {
+        *Memory::get_8b(0xFF10 + i) = boot[i];
+    }
+
+    now = CPU::cycles;
+    left.clear(now);
+    right.clear(now);
+    int16_t discard[256];
+    while (output_buffer.read(discard, 256) > 0)
+    {
+    }
+
+    for (Channel &c : channels)
+    {
+        c = Channel{};
+        c.next = never;
+    }
+    channels[0].period = 0x7FF;
+    channels[0].dac = true;
+    channels[0].enabled = true; // the boot chime has faded to volume 0
+    channels[1].period = 0x7FF;
+    channels[2].period = 0x7FF;
+    channels[3].length = 64;
+
+    sweep_enabled = false;
+    sweep_timer = 0;
+    sweep_shadow = 0;
+    lfsr = 0x7FFF;
+
+    power = true;
+    sequencer_step = 0;
+    sequencer_next = 8192;
+}
+
+void APU::set_enabled(const bool &on)
+{
+    if (on && !enabled)
+    {
+        // nothing ran while disabled, so pick up from here in silence
+        now = CPU::cycles;
+        left.clear(now);
+        right.clear(now);
+        for (Channel &c : channels)
+        {
+            c.enabled = false;
+            c.next = never;
+            c.amplitude = 0;
+            c.left = 0;
+            c.right = 0;
+        }
+        sequencer_next = now + 8192;
+    }
+    enabled = on;
+}
+
+uint8_t APU::read(const uint16_t &address)
+{
+    catch_up();
+    if (address >= 0xFF30)
+    {
+        return reg(address);
+    }
+    if (enabled && address == 0xFF26)
+    {
+        uint8_t status = power ? 0x80 : 0x00;
+        for (int i = 0; i < 4; i++)
+        {
+            status |= channels[i].enabled ? (1 << i) : 0;
+        }
+        return status | read_masks[0x16];
+    }
+    return reg(address) | read_masks[address - 0xFF10];
+}
+
+void APU::write(const uint16_t &address, const uint8_t &b)
+{
+    if (!enabled)
+    {
+        *Memory::get_8b(address) = b;
+        return;
+    }
+
+    // channel 3 reads wave RAM as it plays, so the steps already due play the old samples
+    catch_up();
+    if (address >= 0xFF30)
+    {
+        *Memory::get_8b(address) = b;
+        return;
+    }
+
+    if (address == 0xFF26)
+    {
+        bool on = b & 0x80;
+        if (power && !on)
+        {
+            // powering off clears every sound register
+            for (uint16_t a = 0xFF10; a <= 0xFF25; a++)
+            {
+                *Memory::get_8b(a) = 0;
+            }
+            for (int i = 0; i < 4; i++)
+            {
+                channels[i].dac = false;
+                channels[i].length = 0;
+                disable(i);
+            }
+        }
+        else if (!power && on)
+        {
+            sequencer_step = 0;
+            sequencer_next = now + 8192;
+        }
+        power = on;
+        *Memory::get_8b(address) = b & 0x80;
+        return;
+    }
+
+    if (!power || address > 0xFF25)
+    {
+        return; // registers are read-only while powered off
+    }
+
+    *Memory::get_8b(address) = b;
+
+    if (address == 0xFF24 || address == 0xFF25)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            refresh(i);
+        }
+        return;
+    }
+
+    int i = (address - 0xFF10) / 5;
+    Channel &c = channels[i];
+    switch ((address - 0xFF10) % 5)
+    {
+    case 0: // NR30 on the wave channel
+        if (i == 2)
+        {
+            c.dac = b & 0x80;
+            if (!c.dac)
+            {
+                disable(i);
+            }
+        }
+        break;
+    case 1:
+        c.length = (i == 2) ? 256 - b : 64 - (b & 0x3F);
+        if (i != 3)
+        {
+            refresh(i); // duty change
+        }
+        break;
+    case 2:
+        if (i == 2)
+        {
+            refresh(i); // output level change
+        }
+        else
+        {
+            c.dac = (b & 0xF8) != 0;
+            if (!c.dac)
+            {
+                disable(i);
+            }
+        }
+        break;
+    case 3:
+        if (i != 3)
+        {
+            c.period = (c.period & 0x0700) | b;
+        }
+        break;
+    case 4:
+        if (i != 3)
+        {
+            c.period = (c.period & 0x00FF) | ((b & 0x07) << 8);
+        }
+        c.length_enable = b & 0x40;
+        if (b & 0x80)
+        {
+            trigger(i);
+        }
+        break;
+    }
+}
+
+void APU::catch_up()
+{
+    const uint64_t target = CPU::cycles;
+    if (!enabled || !power)
+    {
+        now = target;
+        return;
+    }
+
+    // jump from event to event; between them every channel output is constant
+    while (true)
+    {
+        uint64_t next = sequencer_next;
+        for (const Channel &c : channels)
+        {
+            next = c.next < next ? c.next : next;
+        }
+        if (next > target)
+        {
+            break;
+        }
+
+        now = next;
+        if (sequencer_next == now)
+        {
+            step_sequencer();
+        }
+        for (int i = 0; i < 4; i++)
+        {
+            if (channels[i].next == now)
+            {
+                step_waveform(i);
+            }
+        }
+    }
+    now = target;
+}
+
+void APU::end_frame()
+{
+    static int16_t samples[BlipBuffer::size * 2];
+
+    catch_up();
+    if (!enabled)
+    {
+        return;
+    }
+
+    int n = left.samples_available(now);
+    left.read_samples(samples, n, 2);
+    right.read_samples(samples + 1, n, 2);
+    output_buffer.write(samples, n * 2);
+}
+
+APU::Output &APU::output()
+{
+    return output_buffer;
+}
+
+} // namespace emulator
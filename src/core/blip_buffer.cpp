@@ -0,0 +1,101 @@
+#include "gameboy-emulator/core/blip_buffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace emulator
+{
+
+// band-limited impulse for each sub-sample position of a step, every phase summing to 1 << 14
+static int16_t kernel[BlipBuffer::phases][BlipBuffer::taps];
+
+static bool build_kernel()
+{
+    const double pi = 3.14159265358979323846;
+    const double cutoff = 0.45; // fraction of the sample rate
+    const int half = BlipBuffer::taps / 2;
+
+    for (int p = 0; p < BlipBuffer::phases; p++)
+    {
+        double frac = static_cast<double>(p) / BlipBuffer::phases;
+        double k[BlipBuffer::taps];
+        double sum = 0.0;
+        for (int i = 0; i < BlipBuffer::taps; i++)
+        {
+            double x = i - (half - 1) - frac;
+            double sinc = (x == 0.0) ? 2.0 * cutoff : std::sin(2.0 * pi * cutoff * x) / (pi * x);
+            double window = 0.42 + 0.5 * std::cos(pi * x / half) + 0.08 * std::cos(2.0 * pi * x / half);
+            k[i] = sinc * window;
+            sum += k[i];
+        }
+
+        // spread the rounding error so every phase sums exactly, keeping steps exact
+        int total = 0;
+        for (int i = 0; i < BlipBuffer::taps; i++)
+        {
+            kernel[p][i] = static_cast<int16_t>(std::lround(k[i] / sum * (1 << 14)));
+            total += kernel[p][i];
+        }
+        kernel[p][half - 1] += static_cast<int16_t>((1 << 14) - total);
+    }
+    return true;
+}
+
+static const bool kernel_built = build_kernel();
+
+BlipBuffer::BlipBuffer()
+{
+    clear(0);
+}
+
+void BlipBuffer::clear(const uint64_t &time)
+{
+    std::memset(buffer, 0, sizeof(buffer));
+    base = time / clocks_per_sample;
+    integrator = 0;
+}
+
+void BlipBuffer::add_delta(const uint64_t &time, const int32_t &delta)
+{
+    if (delta == 0)
+    {
+        return;
+    }
+
+    int64_t i = static_cast<int64_t>(time / clocks_per_sample) - static_cast<int64_t>(base);
+    if (i < 0 || i >= size)
+    {
+        return; // already read, or the buffer was not drained in time
+    }
+
+    const int16_t *k = kernel[(time % clocks_per_sample) * phases / clocks_per_sample];
+    int32_t *out = &buffer[i];
+    for (int j = 0; j < taps; j++)
+    {
+        out[j] += delta * k[j];
+    }
+}
+
+int BlipBuffer::samples_available(const uint64_t &time) const
+{
+    int64_t n = static_cast<int64_t>(time / clocks_per_sample) - static_cast<int64_t>(base);
+    return static_cast<int>(std::clamp<int64_t>(n, 0, size));
+}
+
+void BlipBuffer::read_samples(int16_t *out, const int &count, const int &stride)
+{
+    for (int i = 0; i < count; i++)
+    {
+        // integrate the impulses back into steps, leaking slowly to remove dc
+        integrator += buffer[i] - (integrator >> 9);
+        int32_t sample = static_cast<int32_t>(integrator >> 14);
+        out[i * stride] = static_cast<int16_t>(std::clamp(sample, -32768, 32767));
+    }
+
+    std::memmove(buffer, buffer + count, (size + taps - count) * sizeof(int32_t));
+    std::memset(buffer + size + taps - count, 0, count * sizeof(int32_t));
+    base += count;
+}
+
+} // namespace emulator
@@ -0,0 +1,36 @@
+#include "gameboy-emulator/core/bus_recorder.hpp"
+
+namespace emulator
+{
+
+thread_local bool BusRecorder::enabled = false;
+thread_local size_t BusRecorder::recorded = 0;
+thread_local BusRecorder::Event BusRecorder::events[BusRecorder::capacity] = {};
+
+void BusRecorder::start()
+{
+    recorded = 0;
+    enabled = true;
+}
+
+void BusRecorder::stop()
+{
+    enabled = false;
+}
+
+size_t BusRecorder::count()
+{
+    return recorded;
+}
+
+bool BusRecorder::overflowed()
+{
+    return recorded > capacity;
+}
+
+const BusRecorder::Event &BusRecorder::event(const size_t &i)
+{
+    return events[i];
+}
+
+} // namespace emulator
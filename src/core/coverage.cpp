@@ -0,0 +1,122 @@
+#include "gameboy-emulator/core/coverage.hpp"
+
+#include <bitset>
+#include <cstdio>
+
+namespace emulator
+{
+
+// bits of every ROM bank, then of 8000-FFFF
+static size_t bitmap_bits(const uint16_t &rom_banks)
+{
+    return static_cast<size_t>(rom_banks) * 0x4000 + 0x8000;
+}
+
+// before a cartridge is loaded the bus is flat, and each page's bits sit at its own address
+static constexpr std::array<uint32_t, 256> flat_pages()
+{
+    std::array<uint32_t, 256> pages = {};
+    for (uint32_t page = 0; page < 256; page++)
+    {
+        pages[page] = page << 8;
+    }
+    return pages;
+}
+
+thread_local std::vector<uint8_t> Coverage::bits(bitmap_bits(2) / 8);
+thread_local std::array<uint32_t, 256> Coverage::page_bits = flat_pages();
+thread_local uint16_t Coverage::banks = 2;
+
+void Coverage::layout(const uint16_t &rom_banks)
+{
+    // a new cartridge starts from nothing, even one the same size as the last
+    banks = rom_banks;
+    bits.assign(bitmap_bits(banks) / 8, 0);
+
+    const uint32_t ram = static_cast<uint32_t>(banks) * 0x4000;
+    for (uint32_t page = 0x00; page < 0x40; page++)
+    {
+        page_bits[page] = page << 8;
+    }
+    for (uint32_t page = 0x80; page < 0x100; page++)
+    {
+        page_bits[page] = ram + ((page - 0x80) << 8);
+    }
+    map_bank(1);
+}
+
+void Coverage::map_bank(const uint16_t &bank)
+{
+    for (uint32_t page = 0x40; page < 0x80; page++)
+    {
+        page_bits[page] = static_cast<uint32_t>(bank) * 0x4000 + ((page - 0x40) << 8);
+    }
+}
+
+void Coverage::reset()
+{
+    bits.assign(bits.size(), 0);
+}
+
+void Coverage::mark(const uint16_t &address, const uint16_t &length)
+{
+    for (uint32_t i = 0; i < length; i++)
+    {
+        mark(static_cast<uint16_t>(address + i));
+    }
+}
+
+bool Coverage::covered(const uint16_t &bank, const uint16_t &address)
+{
+    uint32_t bit;
+    if (address < 0x4000)
+    {
+        bit = address;
+    }
+    else if (address < 0x8000)
+    {
+        if (bank >= banks)
+        {
+            return false;
+        }
+        bit = static_cast<uint32_t>(bank) * 0x4000 + (address - 0x4000);
+    }
+    else
+    {
+        bit = static_cast<uint32_t>(banks) * 0x4000 + (address - 0x8000);
+    }
+    return bits[bit >> 3] & (1 << (bit & 7));
+}
+
+uint64_t Coverage::count()
+{
+    uint64_t n = 0;
+    for (uint8_t b : bits)
+    {
+        n += std::bitset<8>(b).count();
+    }
+    return n;
+}
+
+const std::vector<uint8_t> &Coverage::bitmap()
+{
+    return bits;
+}
+
+bool Coverage::dump(const std::string &path)
+{
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    const uint8_t header[header_size] = { 'G', 'B', 'C', 'V', static_cast<uint8_t>(version),
+                                          static_cast<uint8_t>(version >> 8), static_cast<uint8_t>(banks),
+                                          static_cast<uint8_t>(banks >> 8) };
+    bool written = std::fwrite(header, 1, header_size, file) == header_size &&
+                   std::fwrite(bits.data(), 1, bits.size(), file) == bits.size();
+    return std::fclose(file) == 0 && written;
+}
+
+} // namespace emulator
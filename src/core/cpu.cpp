@@ -1,62 +1,174 @@
 #include "gameboy-emulator/core/cpu.hpp"
 
+#include <algorithm>
+#include <cstring>
+
+#include "gameboy-emulator/core/alu.hpp"
 #include "gameboy-emulator/core/bytelib.hpp"
+#include "gameboy-emulator/core/coverage.hpp"
+#include "gameboy-emulator/core/guest_profiler.hpp"
 #include "gameboy-emulator/core/instructions.hpp"
+#include "gameboy-emulator/core/interrupts.hpp"
 #include "gameboy-emulator/core/memory.hpp"
+#include "gameboy-emulator/core/opcode_profiler.hpp"
+
+#ifdef GAMEBOY_TRACE
+#include "gameboy-emulator/core/tracer.hpp"
+#endif
 
 namespace emulator {
 
-uint16_t CPU::af = 0x0000;
-uint16_t CPU::bc = 0x0000;
-uint16_t CPU::de = 0x0000;
-uint16_t CPU::hl = 0x0000;
-uint16_t CPU::sp = 0xFFFF;
-uint16_t CPU::pc = 0x0000;
-
-uint8_t *CPU::r[8] = {
-    reinterpret_cast<uint8_t *>(&bc)+1, reinterpret_cast<uint8_t *>(&bc), 
-    reinterpret_cast<uint8_t *>(&de)+1, reinterpret_cast<uint8_t *>(&de), 
-    reinterpret_cast<uint8_t *>(&hl)+1, reinterpret_cast<uint8_t *>(&hl), 
-    nullptr, reinterpret_cast<uint8_t *>(&af)+1
-};
+thread_local uint8_t CPU::reg[8] = {};
+thread_local uint16_t CPU::sp = 0xFFFF;
+thread_local uint16_t CPU::pc = 0x0000;
 
-uint16_t *CPU::rp[4] = {
-    &bc, &de, &hl, &sp
-};
+thread_local uint64_t CPU::cycles = 0;
+thread_local bool CPU::halted = false;
+thread_local bool CPU::halt_bug = false;
 
-uint16_t *CPU::rf[4] = {
-    &bc, &de, &hl, &af
-};
+// operands of the loops bulk() recognises
+static constexpr uint8_t bulk_a = 0;
+static constexpr uint8_t bulk_hl = 1; // (HL+)
+static constexpr uint8_t bulk_de = 2; // (DE) followed by INC DE
+static constexpr uint8_t bulk_bc = 0; // DEC BC; LD A,B; OR C
+static constexpr uint8_t bulk_b = 1;  // DEC B
+static constexpr uint8_t bulk_c = 2;  // DEC C
 
-alu::alu_8b_f CPU::al[8] = {
-    CPU::adda, CPU::adca, CPU::suba, CPU::sbca, CPU::anda, CPU::xora, CPU::ora, CPU::cpa
+struct bulk_loop
+{
+    uint8_t code[6];   // loop body, the closing JR NZ or JP NZ is matched separately
+    uint8_t length;
+    uint8_t cycles[6]; // T-cycles of each instruction of the body
+    uint8_t source;
+    uint8_t destination;
+    uint8_t counter;
 };
 
-alu::rot_8b_f CPU::rot[8] = {
-    alu::rlc, alu::rrc, alu::rl, alu::rr, alu::sla, alu::sra, alu::swap, alu::srl
+static const bulk_loop bulk_loops[] = {
+    { { 0x2A, 0x12, 0x13, 0x0B, 0x78, 0xB1 }, 6, { 8, 8, 8, 8, 4, 4 }, bulk_hl, bulk_de, bulk_bc },
+    { { 0x1A, 0x22, 0x13, 0x0B, 0x78, 0xB1 }, 6, { 8, 8, 8, 8, 4, 4 }, bulk_de, bulk_hl, bulk_bc },
+    { { 0x2A, 0x12, 0x13, 0x05 }, 4, { 8, 8, 8, 4 }, bulk_hl, bulk_de, bulk_b },
+    { { 0x2A, 0x12, 0x13, 0x0D }, 4, { 8, 8, 8, 4 }, bulk_hl, bulk_de, bulk_c },
+    { { 0x1A, 0x22, 0x13, 0x05 }, 4, { 8, 8, 8, 4 }, bulk_de, bulk_hl, bulk_b },
+    { { 0x1A, 0x22, 0x13, 0x0D }, 4, { 8, 8, 8, 4 }, bulk_de, bulk_hl, bulk_c },
+    { { 0x22, 0x05 }, 2, { 8, 4 }, bulk_a, bulk_hl, bulk_b },
+    { { 0x22, 0x0D }, 2, { 8, 4 }, bulk_a, bulk_hl, bulk_c },
 };
 
-void CPU::adda(uint8_t &_, const uint8_t &b, uint8_t &flags) { uint8_t *a = reinterpret_cast<uint8_t *>(&af)+1; alu::add(*a, b, flags); }
-void CPU::adca(uint8_t &_, const uint8_t &b, uint8_t &flags) { uint8_t *a = reinterpret_cast<uint8_t *>(&af)+1; alu::adc(*a, b, flags); }
-void CPU::suba(uint8_t &_, const uint8_t &b, uint8_t &flags) { uint8_t *a = reinterpret_cast<uint8_t *>(&af)+1; alu::sub(*a, b, flags); }
-void CPU::sbca(uint8_t &_, const uint8_t &b, uint8_t &flags) { uint8_t *a = reinterpret_cast<uint8_t *>(&af)+1; alu::sbc(*a, b, flags); }
-void CPU::anda(uint8_t &_, const uint8_t &b, uint8_t &flags) { uint8_t *a = reinterpret_cast<uint8_t *>(&af)+1; alu::_and(*a, b, flags); }
-void CPU::xora(uint8_t &_, const uint8_t &b, uint8_t &flags) { uint8_t *a = reinterpret_cast<uint8_t *>(&af)+1; alu::_xor(*a, b, flags); }
-void CPU::ora(uint8_t &_, const uint8_t &b, uint8_t &flags) { uint8_t *a = reinterpret_cast<uint8_t *>(&af)+1; alu::_or(*a, b, flags); }
-void CPU::cpa(uint8_t &_, const uint8_t &b, uint8_t &flags) { uint8_t *a = reinterpret_cast<uint8_t *>(&af)+1; alu::cp(*a, b, flags); }
+template <int Z>
+uint8_t CPU::read_r()
+{
+    if constexpr (Z == 6)
+    {
+        return Memory::read_8b(read_rp<2>());
+    }
+    else
+    {
+        return reg[Z];
+    }
+}
+
+template <int Z>
+void CPU::write_r(const uint8_t &b)
+{
+    if constexpr (Z == 6)
+    {
+        Memory::write_8b(read_rp<2>(), b);
+    }
+    else
+    {
+        reg[Z] = b;
+    }
+}
+
+template <int P>
+uint16_t CPU::read_rp()
+{
+    if constexpr (P == 3)
+    {
+        return sp;
+    }
+    else
+    {
+        return static_cast<uint16_t>(reg[P * 2] << 8 | reg[P * 2 + 1]);
+    }
+}
+
+template <int P>
+void CPU::write_rp(const uint16_t &v)
+{
+    if constexpr (P == 3)
+    {
+        sp = v;
+    }
+    else
+    {
+        reg[P * 2] = static_cast<uint8_t>(v >> 8);
+        reg[P * 2 + 1] = static_cast<uint8_t>(v);
+    }
+}
+
+template <int P>
+uint16_t CPU::read_rp2()
+{
+    if constexpr (P == 3)
+    {
+        return static_cast<uint16_t>(reg[A] << 8 | reg[F]);
+    }
+    else
+    {
+        return read_rp<P>();
+    }
+}
+
+template <int P>
+void CPU::write_rp2(const uint16_t &v)
+{
+    if constexpr (P == 3)
+    {
+        reg[A] = static_cast<uint8_t>(v >> 8);
+        reg[F] = static_cast<uint8_t>(v & 0xF0);
+    }
+    else
+    {
+        write_rp<P>(v);
+    }
+}
+
+template <int Y>
+void CPU::alu_a(const uint8_t &b)
+{
+    if constexpr (Y == 0) { alu::add(reg[A], b, reg[F]); }
+    else if constexpr (Y == 1) { alu::adc(reg[A], b, reg[F]); }
+    else if constexpr (Y == 2) { alu::sub(reg[A], b, reg[F]); }
+    else if constexpr (Y == 3) { alu::sbc(reg[A], b, reg[F]); }
+    else if constexpr (Y == 4) { alu::_and(reg[A], b, reg[F]); }
+    else if constexpr (Y == 5) { alu::_xor(reg[A], b, reg[F]); }
+    else if constexpr (Y == 6) { alu::_or(reg[A], b, reg[F]); }
+    else { alu::cp(reg[A], b, reg[F]); }
+}
 
-opcode_values CPU::get_opcode_values(const uint8_t &opcode)
+template <int Y>
+void CPU::rotate(uint8_t &x)
 {
-    return {
-        .x = static_cast<uint8_t>((opcode >> 6)),
-        .y = static_cast<uint8_t>((opcode >> 3) & 0b111),
-        .z = static_cast<uint8_t>(opcode & 0b111),
-        .p = static_cast<uint8_t>((opcode >> 4) & 0b11),
-        .q = static_cast<uint8_t>((opcode >> 3) & 0b1)
-    };
+    if constexpr (Y == 0) { alu::rlc(x, reg[F]); }
+    else if constexpr (Y == 1) { alu::rrc(x, reg[F]); }
+    else if constexpr (Y == 2) { alu::rl(x, reg[F]); }
+    else if constexpr (Y == 3) { alu::rr(x, reg[F]); }
+    else if constexpr (Y == 4) { alu::sla(x, reg[F]); }
+    else if constexpr (Y == 5) { alu::sra(x, reg[F]); }
+    else if constexpr (Y == 6) { alu::swap(x, reg[F]); }
+    else { alu::srl(x, reg[F]); }
 }
 
-uint16_t CPU::t = 0;
+template <int Y>
+bool CPU::condition()
+{
+    if constexpr (Y == 0) { return !(reg[F] & 0x80); }
+    else if constexpr (Y == 1) { return reg[F] & 0x80; }
+    else if constexpr (Y == 2) { return !(reg[F] & 0x10); }
+    else { return reg[F] & 0x10; }
+}
 
 // instruction set meaning:
 // 4 byte opcodes (bracketed items may or may not be present)
@@ -82,994 +194,825 @@ uint16_t CPU::t = 0;
 //
 // further reading for how to use this information: https://archive.gbdev.io/salvage/decoding_gbz80_opcodes/Decoding%20Gamboy%20Z80%20Opcodes.html
 // opcode lookup table: https://clrhome.org/table/
-void CPU::instruction(const uint8_t &b3, const uint8_t &b2, const uint8_t &b1, const uint8_t &b0)
+template <uint8_t Op>
+void CPU::execute(const uint8_t &b2, const uint8_t &b1)
 {
-    uint8_t *f = reinterpret_cast<uint8_t *>(&af); // get flags
-    
-    // prefixed opcodes
-    if (b3 == 0xcb)
+    constexpr opcode_values ocv = get_opcode_values(Op);
+    uint8_t &f = reg[F];
+    uint8_t &a = reg[A];
+
+    if constexpr (ocv.x == 0)
     {
-        opcode_values ocv = get_opcode_values(b2);
-        uint8_t* target;
-        if (ocv.z == 0x6 || ocv.z == 0xE)
+        if constexpr (ocv.z == 0)
         {
-            target = Memory::get_8b(hl);
-            t = 16;
+            if constexpr (ocv.y == 0)
+            {
+                // NOP
+                nop();
+                cycles += 4;
+                pc += 1;
+            }
+            else if constexpr (ocv.y == 1)
+            {
+                // LD (nn), SP
+                uint16_t nn = bytes_to_16b(b1, b2);
+                Memory::write_8b(nn, static_cast<uint8_t>(sp & 0xFF));
+                Memory::write_8b(nn + 1, static_cast<uint8_t>(sp >> 8));
+                cycles += 20;
+                pc += 3;
+            }
+            else if constexpr (ocv.y == 2)
+            {
+                // STOP
+                // there is no joypad to wake from, so it sleeps like HALT
+                stop();
+                halted = true;
+                cycles += 4;
+                pc += 1;
+            }
+            else if constexpr (ocv.y == 3)
+            {
+                // JR d
+                jr(pc, b2);
+                cycles += 12;
+                pc += 2;
+            }
+            else
+            {
+                // JR cc[y-4], d
+                if (condition<ocv.y - 4>())
+                {
+                    jr(pc, b2);
+                    cycles += 12;
+                }
+                else
+                {
+                    cycles += 8;
+                }
+                pc += 2;
+            }
+        }
+        else if constexpr (ocv.z == 1)
+        {
+            if constexpr (ocv.q == 0)
+            {
+                // LD rp[p], nn
+                write_rp<ocv.p>(bytes_to_16b(b1, b2));
+                cycles += 12;
+                pc += 3;
+            }
+            else
+            {
+                // ADD HL, rp[p]
+                uint8_t _f = f;
+                uint16_t hl = read_rp<2>();
+                alu::add(hl, read_rp<ocv.p>(), f);
+                write_rp<2>(hl);
+                f = (f & 0x7F) | (_f & 0x80); // different adding rules for HL
+                cycles += 8;
+                pc += 1;
+            }
+        }
+        else if constexpr (ocv.z == 2)
+        {
+            // LD (BC), A; LD (DE), A; LD (HL+), A; LD (HL-), A and the same loads into a
+            uint16_t address = read_rp<(ocv.p == 3) ? 2 : ocv.p>();
+            if constexpr (ocv.q == 0)
+            {
+                Memory::write_8b(address, a);
+            }
+            else
+            {
+                ld(a, Memory::read_8b(address));
+            }
+
+            if constexpr (ocv.p == 2)
+            {
+                write_rp<2>(address + 1);
+            }
+            else if constexpr (ocv.p == 3)
+            {
+                write_rp<2>(address - 1);
+            }
+            cycles += 8;
+            pc += 1;
+        }
+        else if constexpr (ocv.z == 3)
+        {
+            // INC rp[p], DEC rp[p]
+            write_rp<ocv.p>((ocv.q == 0) ? read_rp<ocv.p>() + 1 : read_rp<ocv.p>() - 1);
+            cycles += 8;
+            pc += 1;
+        }
+        else if constexpr (ocv.z == 4 || ocv.z == 5)
+        {
+            // INC r[y], DEC r[y]
+            uint8_t v = read_r<ocv.y>();
+            if constexpr (ocv.z == 4)
+            {
+                alu::inc(v, f);
+            }
+            else
+            {
+                alu::dec(v, f);
+            }
+            write_r<ocv.y>(v);
+            cycles += (ocv.y == 6) ? 12 : 4;
+            pc += 1;
+        }
+        else if constexpr (ocv.z == 6)
+        {
+            // LD r[y], n
+            write_r<ocv.y>(b2);
+            cycles += (ocv.y == 6) ? 12 : 8;
+            pc += 2;
         }
         else
         {
-            target = r[ocv.z];
-            t = 8;
+            if constexpr (ocv.y < 4)
+            {
+                // RLCA, RRCA, RLA, RRA
+                rotate<ocv.y>(a);
+                f = f & 0x1F;
+            }
+            else if constexpr (ocv.y == 4)
+            {
+                // DAA
+                alu::daa(a, f);
+            }
+            else if constexpr (ocv.y == 5)
+            {
+                // CPL
+                alu::cpl(a, f);
+            }
+            else if constexpr (ocv.y == 6)
+            {
+                // SCF
+                alu::scf(f);
+            }
+            else
+            {
+                // CCF
+                alu::ccf(f);
+            }
+            cycles += 4;
+            pc += 1;
         }
-        switch (ocv.x)
+    }
+    else if constexpr (ocv.x == 1)
+    {
+        if constexpr (ocv.z == 6 && ocv.y == 6)
         {
-        case 0:
-            // rot[y] r[z]
-            rot[ocv.y](*target, *f);
-            break;
-        case 1:
-            // BIT y, r[z]
-            alu::bit(ocv.y, *target, *f);
-            break;
-        case 2:
-            // RES y, r[z]
-            reset_bit(ocv.y, *target);
-            break;
-        case 3:
-            // SET y, r[z]
-            set_bit(ocv.y, *target);
-            break;
-        default:
-            break;
+            // HALT
+            if (!Interrupts::master_enabled() && Interrupts::requested())
+            {
+                // halt exits at once, but pc fails to advance past the next opcode
+                halt_bug = true;
+            }
+            else
+            {
+                halted = true;
+            }
+            cycles += 4;
+            pc += 1;
+        }
+        else
+        {
+            // LD r[y], r[z]
+            write_r<ocv.y>(read_r<ocv.z>());
+            cycles += (ocv.y == 6 || ocv.z == 6) ? 8 : 4;
+            pc += 1;
         }
-        pc += 2;
     }
-    else if (b3 == 0xdd || b3 == 0xed || b3 == 0xfd)
+    else if constexpr (ocv.x == 2)
     {
-        // not implemented by gameboy
+        // ALU [y] r[z]
+        alu_a<ocv.y>(read_r<ocv.z>());
+        cycles += (ocv.z == 6) ? 8 : 4;
+        pc += 1;
     }
-    // unprefixed opcode
     else
     {
-        opcode_values ocv = get_opcode_values(b3);
-        switch (ocv.x)
+        if constexpr (ocv.z == 0)
         {
-        case 0:
-            switch (ocv.z)
+            if constexpr (ocv.y < 4)
             {
-            case 0:
-                switch (ocv.y)
-                {
-                case 0:
-                    // NOP
-                    nop();
-                    t = 4;
-                    pc += 1;
-                    break;
-                case 1:
-                    // LD (nn), SP
-                    {
-                        uint16_t nn = bytes_to_16b(b1, b2);
-                        uint16_t *reg = Memory::get_16b(nn);
-                        ld(*reg, sp);
-                        t = 20;
-                        pc += 3;
-                    }
-                    break;
-                case 2:
-                    // STOP
-                    stop();
-                    t = 4;
-                    pc += 1;
-                    break;
-                case 3:
-                    // JR d
-                    {
-                        jr(pc, b2);
-                        t = 12;
-                        pc += 2;
-                    }
-                    break;
-                case 4:
-                    // JR nz, d
-                    {
-                        bool z = *f >> 7;
-                        if (!z)
-                        {
-                            jr(pc, b2);
-                            t = 12;
-                        }
-                        else 
-                        {
-                            t = 8;
-                        }
-                        pc += 2;
-                    }
-                    break;
-                case 5:
-                    // JR z, d
-                    {
-                        bool z = *f >> 7;
-                        if (z)
-                        {
-                            jr(pc, b2);
-                            t = 12;
-                        }
-                        else 
-                        {
-                            t = 8;
-                        }
-                        pc += 2;
-                    }
-                    break;
-                case 6:
-                    // JR nc, d
-                    {
-                        bool c = (*f >> 4) & 1;
-                        if (!c)
-                        {
-                            jr(pc, b2);
-                            t = 12;
-                        }
-                        else 
-                        {
-                            t = 8;
-                        }
-                        pc += 2;
-                    }
-                    break;
-                case 7:
-                    // JR c, d
-                    {
-                        bool c = (*f >> 4) & 1;
-                        if (c)
-                        {
-                            jr(pc, b2);
-                            t = 12;
-                        }
-                        else 
-                        {
-                            t = 8;
-                        }
-                        pc += 2;
-                    }
-                    break;
-                default:
-                    break;
-                }
-                break;
-            case 1:
-                switch (ocv.q)
-                {
-                case 0:
-                    // LD rp[p], nn
-                    {
-                        uint16_t nn = bytes_to_16b(b1, b2);
-                        ld(*rp[ocv.p], nn);
-                        t = 12;
-                        pc += 3;
-                    }
-                    break;
-                case 1:
-                    // ADD HL, rp[p]
-                    {
-                        uint8_t _f = *f;
-                        alu::add(hl, *rp[ocv.p], *f);
-                        *f = (*f & 0x7F) | (_f & 0x80); // different adding rules for HL
-                        t = 8;
-                        pc += 1;
-                    }
-                    break;
-                default:
-                    break;
-                }
-                break;
-            case 2:
-                {
-                    uint8_t *a = reinterpret_cast<uint8_t *>(&af)+1;
-                    switch (ocv.q)
-                    {
-                    case 0:
-                        switch (ocv.p)
-                        {
-                        case 0:
-                            // ld (bc), a
-                            {
-                                uint8_t *reg = Memory::get_8b(bc);
-                                ld(*reg, *a);
-                                t = 8;
-                                pc += 1;
-                            }
-                            break;
-                        case 1:
-                            // ld (de), a
-                            {
-                                uint8_t *reg = Memory::get_8b(de);
-                                ld(*reg, *a);
-                                t = 8;
-                                pc += 1;
-                            }
-                            break;
-                        case 2:
-                            // ld (hl+), a
-                            {
-                                uint8_t *reg = Memory::get_8b(hl);
-                                ld(*reg, *a);
-                                alu::inc(hl, *f);
-                                t = 8;
-                                pc += 1;
-                            }
-                            break;
-                        case 3:
-                            // ld (hl-), a
-                            {
-                                uint8_t *reg = Memory::get_8b(hl);
-                                ld(*reg, *a);
-                                alu::dec(hl, *f);
-                                t = 8;
-                                pc += 1;
-                            }
-                            break;
-                        default:
-                            break;
-                        }
-                        break;
-                    case 1:
-                        switch (ocv.p)
-                        {
-                        case 0:
-                            // ld a, (bc)
-                            {
-                                uint8_t *reg = Memory::get_8b(bc);
-                                ld(*a, *reg);
-                                t = 8;
-                                pc += 1;
-                            }
-                            break;
-                        case 1:
-                            // ld a, (de)
-                            {
-                                uint8_t *reg = Memory::get_8b(de);
-                                ld(*a, *reg);
-                                t = 8;
-                                pc += 1;
-                            }
-                            break;
-                        case 2:
-                            // ld a, (hl+)
-                            {
-                                uint8_t *reg = Memory::get_8b(hl);
-                                ld(*a, *reg);
-                                alu::inc(hl, *f);
-                                t = 8;
-                                pc += 1;
-                            }
-                            break;
-                        case 3:
-                            // ld a, (hl-)
-                            {
-                                uint8_t *reg = Memory::get_8b(hl);
-                                ld(*a, *reg);
-                                alu::dec(hl, *f);
-                                t = 8;
-                                pc += 1;
-                            }
-                            break;
-                        default:
-                            break;
-                        }
-                        break;
-                    default:
-                        break;
-                    }
-                }
-                break;
-            case 3:
-                switch (ocv.q)
-                {
-                case 0:
-                    // INC rp[p]
-                    {
-                        uint8_t _ = 0x00;
-                        alu::inc(*rp[ocv.p], _);
-                        t = 8;
-                        pc += 1;
-                    }
-                    break;
-                case 1:
-                    // DEC rp[p]
-                    {
-                        uint8_t _ = 0x00;
-                        alu::dec(*rp[ocv.p], _);
-                        t = 8;
-                        pc += 1;
-                    }
-                    break;
-                default:
-                    break;
-                }
-                break;
-            case 4:
-                // INC r[y]
-                {
-                    uint8_t *target;
-                    if (ocv.y == 6)
-                    {
-                        target = Memory::get_8b(hl);
-                        t = 12;
-                    }
-                    else 
-                    {
-                        target = r[ocv.y];
-                        t = 4;
-                    }
-                    alu::inc(*target, *f);
-                    pc += 1;
-                }
-                break;
-            case 5:
-                // DEC r[y]
-                {
-                    uint8_t *target;
-                    if (ocv.y == 6)
-                    {
-                        target = Memory::get_8b(hl);
-                        t = 12;
-                    }
-                    else 
-                    {
-                        target = r[ocv.y];
-                        t = 4;
-                    }
-                    alu::dec(*target, *f);
-                    pc += 1;
-                }
-                break;
-            case 6:
-                // LD r[y], n
+                // RET cc[y]
+                if (condition<ocv.y>())
                 {
-                    uint8_t *target;
-                    if (ocv.y == 6)
-                    {
-                        target = Memory::get_8b(hl);
-                        t = 12;
-                    }
-                    else 
-                    {
-                        target = r[ocv.y];
-                        t = 8;
-                    }
-                    ld(*target, b2);
-                    pc += 2;
+                    ret(pc, sp);
+                    cycles += 20;
                 }
-                break;
-            case 7:
+                else
                 {
-                    uint8_t *a = reinterpret_cast<uint8_t *>(&af)+1;
-                    switch (ocv.y) 
-                    {
-                    case 0:
-                        // RLCA
-                        alu::rlc(*a, *f);
-                        *f = *f & 0x1F;
-                        t = 4;
-                        pc += 1;
-                        break;
-                    case 1:
-                        // RRCA
-                        alu::rrc(*a, *f);
-                        *f = *f & 0x1F;
-                        t = 4;
-                        pc += 1;
-                        break;
-                    case 2:
-                        // RLA
-                        alu::rl(*a, *f);
-                        *f = *f & 0x1F;
-                        t = 4;
-                        pc += 1;
-                        break;
-                    case 3:
-                        // RRA
-                        alu::rr(*a, *f);
-                        *f = *f & 0x1F;
-                        t = 4;
-                        pc += 1;
-                        break;
-                    case 4:
-                        // DAA
-                        alu::daa(*a, *f);
-                        t = 4;
-                        pc += 1;
-                        break;
-                    case 5:
-                        // CPL
-                        alu::cpl(*a, *f);
-                        t = 4;
-                        pc += 1;
-                        break;
-                    case 6:
-                        // SCF
-                        alu::scf(*f);
-                        t = 4;
-                        pc += 1;
-                        break;
-                    case 7:
-                        // CCF
-                        alu::ccf(*f);
-                        t = 4;
-                        pc += 1;
-                        break;
-                    default:
-                        break;
-                    }
+                    cycles += 8;
                 }
-                break;
-            default:
-                break;
+                pc += 1;
             }
-            break;
-        case 1:
-            if (ocv.z == 6 && ocv.y == 6)
+            else if constexpr (ocv.y == 4)
             {
-                // exception
+                // LD (0xFF00 + n), a
+                Memory::write_8b(0xFF00 + static_cast<uint16_t>(b2), a);
+                cycles += 12;
+                pc += 2;
             }
-            else 
+            else if constexpr (ocv.y == 5)
             {
-                // LD r[y], r[z]
-                uint8_t *target;
-                if (ocv.y == 6)
-                {
-                    target = Memory::get_8b(hl);
-                }
-                else 
-                {
-                    target = r[ocv.y];
-                }
-
-                uint8_t *val;
-                if (ocv.z == 6)
+                // ADD SP, d
+                alu::add(sp, b2, f);
+                cycles += 16;
+                pc += 2;
+            }
+            else if constexpr (ocv.y == 6)
+            {
+                // LD A, (0xFF00 + n)
+                ld(a, Memory::read_8b(0xFF00 + static_cast<uint16_t>(b2)));
+                cycles += 12;
+                pc += 2;
+            }
+            else
+            {
+                // LD HL, SP + d
+                uint16_t _sp = sp;
+                alu::add(_sp, b2, f);
+                write_rp<2>(_sp);
+                cycles += 12;
+                pc += 2;
+            }
+        }
+        else if constexpr (ocv.z == 1)
+        {
+            if constexpr (ocv.q == 0)
+            {
+                // POP rp2[p]
+                uint16_t v;
+                pop(v, sp);
+                write_rp2<ocv.p>(v);
+                cycles += 12;
+                pc += 1;
+            }
+            else if constexpr (ocv.p == 0)
+            {
+                // RET
+                ret(pc, sp);
+                cycles += 16;
+                pc += 1;
+            }
+            else if constexpr (ocv.p == 1)
+            {
+                // RETI
+                ret(pc, sp);
+                Interrupts::enable_now();
+                cycles += 16;
+                pc += 1;
+            }
+            else if constexpr (ocv.p == 2)
+            {
+                // JP HL
+                jp(pc, read_rp<2>());
+                cycles += 4;
+                pc += 1;
+            }
+            else
+            {
+                // LD SP, HL
+                ld(sp, read_rp<2>());
+                cycles += 8;
+                pc += 1;
+            }
+        }
+        else if constexpr (ocv.z == 2)
+        {
+            if constexpr (ocv.y < 4)
+            {
+                // JP cc[y], nn
+                if (condition<ocv.y>())
                 {
-                    val = Memory::get_8b(hl);
+                    jp(pc, bytes_to_16b(b1, b2));
+                    cycles += 16;
+                    pc += 1;
                 }
                 else
                 {
-                    val = r[ocv.z];
-                }
-
-                ld(*target, *val);
-
-                if (ocv.y == 6 || ocv.z == 6)
-                {
-                    t = 8;
-                }
-                else 
-                {
-                    t = 4;
+                    cycles += 12;
+                    pc += 3;
                 }
+            }
+            else if constexpr (ocv.y == 4)
+            {
+                // LD (0xFF00 + C),A
+                Memory::write_8b(0xFF00 + reg[C], a);
+                cycles += 8;
                 pc += 1;
             }
-            break;
-        case 2:
-            // ALU [y] r[z]
+            else if constexpr (ocv.y == 5)
             {
-                uint8_t *target;
-                if (ocv.z == 6)
-                {
-                    target = Memory::get_8b(hl);
-                    t = 8;
-                }
-                else 
-                {
-                    target = r[ocv.z];
-                    t = 4;
-                }
-
-                uint8_t _;
-                al[ocv.y](_, *target, *f);
+                // LD (nn), A
+                Memory::write_8b(bytes_to_16b(b1, b2), a);
+                cycles += 16;
+                pc += 3;
+            }
+            else if constexpr (ocv.y == 6)
+            {
+                // LD A, (0xFF00 + C)
+                ld(a, Memory::read_8b(0xFF00 + reg[C]));
+                cycles += 8;
                 pc += 1;
             }
-            break;
-        case 3:
-            switch (ocv.z)
+            else
             {
-            case 0:
-                switch (ocv.y)
-                {
-                case 0:
-                    // RET nz
-                    {
-                        bool z = *f >> 7;
-                        if (!z)
-                        {
-                            uint16_t *top = Memory::get_16b(sp);
-                            ret(pc, *top, sp);
-                            t = 20;
-                        }
-                        else
-                        {
-                            t = 8;
-                        }
-                        pc += 1;
-                    }
-                    break;
-                case 1:
-                    // RET z
-                    {
-                        bool z = *f >> 7;
-                        if (z)
-                        {
-                            uint16_t *top = Memory::get_16b(sp);
-                            ret(pc, *top, sp);
-                            t = 20;
-                        }
-                        else
-                        {
-                            t = 8;
-                        }
-                        pc += 1;
-                    }
-                    break;
-                case 2:
-                    // RET nc
-                    {
-                        bool c = (*f >> 4) & 1;
-                        if (!c)
-                        {
-                            uint16_t *top = Memory::get_16b(sp);
-                            ret(pc, *top, sp);
-                            t = 20;
-                        }
-                        else
-                        {
-                            t = 8;
-                        }
-                        pc += 1;
-                    }
-                    break;
-                case 3:
-                    // RET c
-                    {
-                        bool c = (*f >> 4) & 1;
-                        if (c)
-                        {
-                            uint16_t *top = Memory::get_16b(sp);
-                            ret(pc, *top, sp);
-                            t = 20;
-                        }
-                        else
-                        {
-                            t = 8;
-                        }
-                        pc += 1;
-                    }
-                    break;
-                case 4:
-                    // LD (0xFF00 + n), a
-                    {
-                        uint8_t *a = reinterpret_cast<uint8_t *>(&af)+1;
-                        uint8_t *reg = Memory::get_8b(0xFF00 + static_cast<uint16_t>(b2));
-                        ld(*reg, *a);
-                        t = 12;
-                        pc += 2;
-                    }
-                    break;
-                case 5:
-                    // ADD SP, d
-                    alu::add(sp, b2, *f);
-                    t = 16;
-                    pc += 2;
-                    break;
-                case 6:
-                    // LD A, (0xFF00 + n)
-                    {
-                        uint8_t *a = reinterpret_cast<uint8_t *>(&af)+1;
-                        uint8_t *reg = Memory::get_8b(0xFF00 + static_cast<uint16_t>(b2));
-                        ld(*a, *reg);
-                        t = 12;
-                        pc += 2;
-                    }
-                    break;
-                case 7:
-                    // LD HL, SP + d
-                    {
-                        uint16_t _sp = sp;
-                        alu::add(_sp, b2, *f);
-                        ld(hl, _sp);
-                        t = 12;
-                        pc += 2;
-                    }
-                    break;
-                default:
-                    break;
-                }
-                break;
-            case 1:
-                switch (ocv.q)
-                {
-                case 0:
-                    // POP rp2[p]
-                    {
-                        uint16_t *top = Memory::get_16b(sp);
-                        pop(*rf[ocv.p], *top, sp);
-                        t = 12;
-                        pc += 1;
-
-                        if (ocv.p == 3) { *f = *f & 0xF0; }
-                    }
-                    break;
-                case 1:
-                    switch (ocv.p)
-                    {
-                    case 0:
-                        // RET
-                        {
-                            uint16_t *top = Memory::get_16b(sp);
-                            ret(pc, *top, sp);
-                            t = 16;
-                            pc += 1;
-                        }
-                        break;
-                    case 1:
-                        // RETI
-                        // TODO: implement interrupts
-                        {
-                            uint16_t *top = Memory::get_16b(sp);
-                            ret(pc, *top, sp);
-                            t = 16;
-                            pc += 1;
-                        }
-                        break;
-                    case 2:
-                        // JP HL
-                        jp(pc, hl);
-                        t = 4;
-                        pc += 1;
-                        break;
-                    case 3:
-                        // LD SP, HL
-                        ld(sp, hl);
-                        t = 8;
-                        pc += 1;
-                        break;
-                    default:
-                        break;
-                    }
-                    break;
-                default:
-                    break;
-                }
-                break;
-            case 2:
-                {
-                    uint8_t *a = reinterpret_cast<uint8_t *>(&af)+1;
-                switch (ocv.y)
-                {
-                case 0:
-                    // JP NZ, nn
-                    {
-                        bool z = *f >> 7;
-                        if (!z)
-                        {
-                            uint16_t nn = bytes_to_16b(b1, b2);
-                            jp(pc, nn);
-                            t = 16;
-                            pc += 1;
-                        }
-                        else
-                        {
-                            t = 12;
-                            pc += 3;
-                        }
-                    }
-                    break;
-                case 1:
-                    // JP Z, nn
-                    {
-                        bool z = *f >> 7;
-                        if (z)
-                        {
-                            uint16_t nn = bytes_to_16b(b1, b2);
-                            jp(pc, nn);
-                            t = 16;
-                            pc += 1;
-                        }
-                        else
-                        {
-                            t = 12;
-                            pc += 3;
-                        }
-                    }
-                    break;
-                case 2:
-                    // JP NC, nn
-                    {
-                        bool c = (*f >> 4) & 1;
-                        if (!c)
-                        {
-                            uint16_t nn = bytes_to_16b(b1, b2);
-                            jp(pc, nn);
-                            t = 16;
-                            pc += 1;
-                        }
-                        else
-                        {
-                            t = 12;
-                            pc += 3;
-                        }
-                    }
-                    break;
-                case 3:
-                    // JP C, nn
-                    {
-                        bool c = (*f >> 4) & 1;
-                        if (c)
-                        {
-                            uint16_t nn = bytes_to_16b(b1, b2);
-                            jp(pc, nn);
-                            t = 16;
-                            pc += 1;
-                        }
-                        else
-                        {
-                            t = 12;
-                            pc += 3;
-                        }
-                    }
-                    break;
-                case 4:
-                    // LD (0xFF00 + C),A
-                    {
-                        uint8_t *c = reinterpret_cast<uint8_t *>(&bc);
-                        uint8_t *reg = Memory::get_8b(0xFF00 + *c);
-                        ld(*reg, *a);
-                        t = 8;
-                        pc += 1;
-                    }
-                    break;
-                case 5:
-                    // LD (nn), A
-                    {
-                        uint16_t nn = bytes_to_16b(b1, b2);
-                        uint8_t *reg = Memory::get_8b(nn);
-                        ld(*reg, *a);
-                        t = 16;
-                        pc += 3;
-                    }
-                    break;
-                case 6:
-                    // LD A, (0xFF00 + C)
-                    {
-                        uint8_t *c = reinterpret_cast<uint8_t *>(&bc);
-                        uint8_t *reg = Memory::get_8b(0xFF00 + *c);
-                        ld(*a, *reg);
-                        t = 8;
-                        pc += 1;
-                    }
-                    break;
-                case 7:
-                    // LD A, (nn)
-                    {
-                        uint16_t nn = bytes_to_16b(b1, b2);
-                        uint8_t *reg = Memory::get_8b(nn);
-                        ld(*a, *reg);
-                        t = 16;
-                        pc += 3;
-                    }
-                    break;
-                default:
-                    break;
-                }
-                }
-                break;
-            case 3:
-                switch (ocv.y)
-                {
-                case 0:
-                    // JP nn
-                    {
-                        uint16_t nn = bytes_to_16b(b1, b2);
-                        jp(pc, nn);
-                        t = 16;
-                        pc += 1;
-                    }
-                    break;
-                case 6:
-                    // DI
-                    break;
-                case 7:
-                    // EI
-                    break;
-                default:
-                    break;
-                }
-                break;
-            case 4:
-                {
-                    uint16_t *top = Memory::get_16b(sp);
-                    uint16_t nn = bytes_to_16b(b1, b2);
-                    switch (ocv.y)
-                    {
-                    case 0:
-                        // CALL nz, nn
-                        {
-                            bool z = *f >> 7;
-                            if (!z)
-                            {
-                                call(pc, *top, nn, sp);
-                                t = 24;
-                                pc += 1;
-                            }
-                            else 
-                            {
-                                t = 12;
-                                pc += 3;
-                            }
-                        }
-                        break;
-                    case 1:
-                        // CALL z, nn
-                        {
-                            bool z = *f >> 7;
-                            if (z)
-                            {
-                                call(pc, *top, nn, sp);
-                                t = 24;
-                                pc += 1;
-                            }
-                            else 
-                            {
-                                t = 12;
-                                pc += 3;
-                            }
-                        }
-                        break;
-                    case 2:
-                        // CALL nc, nn
-                        {
-                            bool c = (*f >> 4) & 1;
-                            if (!c)
-                            {
-                                call(pc, *top, nn, sp);
-                                t = 24;
-                                pc += 1;
-                            }
-                            else 
-                            {
-                                t = 12;
-                                pc += 3;
-                            }
-                        }
-                        break;
-                    case 3:
-                        // CALL c, nn
-                        {
-                            bool c = (*f >> 4) & 1;
-                            if (c)
-                            {
-                                call(pc, *top, nn, sp);
-                                t = 24;
-                                pc += 1;
-                            }
-                            else 
-                            {
-                                t = 12;
-                                pc += 3;
-                            }
-                        }
-                        break;
-                    default:
-                        break;
-                    }
-                }
-                break;
-            case 5:
-                switch (ocv.q)
-                {
-                case 0:
-                    // PUSH rp2[p]
-                    {
-                        uint16_t *top = Memory::get_16b(sp);
-                        push(*top, *rf[ocv.p], sp);
-                        t = 16;
-                        pc += 1;
-                    }
-                    break;
-                case 1:
-                    if (ocv.p == 0)
-                    {
-                        // CALL nn
-                        uint16_t *top = Memory::get_16b(sp);
-                        uint16_t nn = bytes_to_16b(b1, b2);
-                        call(pc, *top, nn, sp);
-                        t = 24;
-                        pc += 1;
-                    }
-                    break;
-                default:
-                    break;
-                }
-                break;
-            case 6:
-                // alu[y] n
+                // LD A, (nn)
+                ld(a, Memory::read_8b(bytes_to_16b(b1, b2)));
+                cycles += 16;
+                pc += 3;
+            }
+        }
+        else if constexpr (ocv.z == 3)
+        {
+            if constexpr (ocv.y == 0)
+            {
+                // JP nn
+                jp(pc, bytes_to_16b(b1, b2));
+                cycles += 16;
+                pc += 1;
+            }
+            else if constexpr (ocv.y == 6)
+            {
+                // DI
+                Interrupts::disable();
+                cycles += 4;
+                pc += 1;
+            }
+            else if constexpr (ocv.y == 7)
+            {
+                // EI
+                cycles += 4;
+                pc += 1;
+                Interrupts::enable();
+            }
+            // the CB prefix never gets here, the rest are not implemented by gameboy
+        }
+        else if constexpr (ocv.z == 4)
+        {
+            if constexpr (ocv.y < 4)
+            {
+                // CALL cc[y], nn
+                if (condition<ocv.y>())
                 {
-                    uint8_t _;
-                    al[ocv.y](_, b2, *f);
-                    t = 8;
-                    pc += 2;
+                    call(pc, bytes_to_16b(b1, b2), sp);
+                    cycles += 24;
+                    pc += 1;
                 }
-                break;
-            case 7:
-                // RST y*8
+                else
                 {
-                    uint16_t *top = Memory::get_16b(sp);
-                    rst(pc, ocv.y * 8, *top, sp);
-                    t = 16;
-                    pc += 1;
+                    cycles += 12;
+                    pc += 3;
                 }
-                break;
-            default:
-                break;
             }
-            break;
-        default:
-            break;
+        }
+        else if constexpr (ocv.z == 5)
+        {
+            if constexpr (ocv.q == 0)
+            {
+                // PUSH rp2[p]
+                push(read_rp2<ocv.p>(), sp);
+                cycles += 16;
+                pc += 1;
+            }
+            else if constexpr (ocv.p == 0)
+            {
+                // CALL nn
+                call(pc, bytes_to_16b(b1, b2), sp);
+                cycles += 24;
+                pc += 1;
+            }
+            // DD, ED and FD prefixes are not implemented by gameboy
+        }
+        else if constexpr (ocv.z == 6)
+        {
+            // alu[y] n
+            alu_a<ocv.y>(b2);
+            cycles += 8;
+            pc += 2;
+        }
+        else
+        {
+            // RST y*8
+            rst(pc, ocv.y * 8, sp);
+            cycles += 16;
+            pc += 1;
         }
     }
 }
 
+template <uint8_t Op>
+void CPU::execute_cb()
+{
+    constexpr opcode_values ocv = get_opcode_values(Op);
 
+    uint8_t v = read_r<ocv.z>();
+    if constexpr (ocv.z == 6)
+    {
+        cycles += (ocv.x == 1) ? 12 : 16;
+    }
+    else
+    {
+        cycles += 8;
+    }
 
+    if constexpr (ocv.x == 0)
+    {
+        // rot[y] r[z]
+        rotate<ocv.y>(v);
+    }
+    else if constexpr (ocv.x == 1)
+    {
+        // BIT y, r[z]
+        uint8_t y = ocv.y;
+        alu::bit(y, v, reg[F]);
+    }
+    else if constexpr (ocv.x == 2)
+    {
+        // RES y, r[z]
+        reset_bit(ocv.y, v);
+    }
+    else
+    {
+        // SET y, r[z]
+        set_bit(ocv.y, v);
+    }
+
+    if constexpr (ocv.x != 1)
+    {
+        write_r<ocv.z>(v);
+    }
+    pc += 2;
+}
+
+template <std::size_t... I>
+constexpr std::array<CPU::handler, sizeof...(I)> CPU::handler_table(std::index_sequence<I...>)
+{
+    return { { &CPU::execute<static_cast<uint8_t>(I)>... } };
+}
 
+template <std::size_t... I>
+constexpr std::array<CPU::cb_handler, sizeof...(I)> CPU::cb_handler_table(std::index_sequence<I...>)
+{
+    return { { &CPU::execute_cb<static_cast<uint8_t>(I)>... } };
+}
+
+const std::array<CPU::handler, 256> CPU::handlers = CPU::handler_table(std::make_index_sequence<256>());
+const std::array<CPU::cb_handler, 256> CPU::cb_handlers = CPU::cb_handler_table(std::make_index_sequence<256>());
+
+void CPU::instruction(const uint8_t &b3, const uint8_t &b2, const uint8_t &b1, const uint8_t &b0)
+{
+#ifdef GAMEBOY_TRACE
+    if (Tracer::active())
+    {
+        Tracer::record(cycles, pc - 1, b3, b2, b1, get_registers());
+    }
+#endif
+    Coverage::mark(pc - 1);
+    const uint64_t start = cycles;
+    if (b3 == 0xcb)
+    {
+        cb_handlers[b2]();
+        OpcodeProfiler::record(0x100 | b2, cycles - start);
+    }
+    else
+    {
+        handlers[b3](b2, b1);
+        OpcodeProfiler::record(b3, cycles - start);
+    }
+}
+
+void CPU::branch(const uint8_t &opcode, const uint8_t &offset)
+{
+    bool taken = true;
+    switch (opcode)
+    {
+    case 0x20: taken = condition<0>(); break;
+    case 0x28: taken = condition<1>(); break;
+    case 0x30: taken = condition<2>(); break;
+    case 0x38: taken = condition<3>(); break;
+    default: break;
+    }
+
+    if (taken)
+    {
+        jr(pc, offset);
+        cycles += 12;
+    }
+    else
+    {
+        cycles += 8;
+    }
+    pc += 2;
+}
+
+// JR e or JR cc,e
+static bool is_jr(const uint8_t &opcode)
+{
+    return opcode == 0x18 || (opcode & 0xE7) == 0x20;
+}
+
+// 8-bit register operand, not (HL)
+static bool is_register(const uint8_t &z)
+{
+    return z != 6;
+}
+
+// count both halves of a fused pair in the opcode profile and coverage, the first taking a fixed number of cycles;
+// the opcodes are as fetched, since the pair may have written over itself
+static bool fused(const uint16_t &head, const uint8_t *opcodes, const uint8_t &length, const uint64_t &start,
+                  const uint32_t &taken)
+{
+    OpcodeProfiler::record(opcodes[0], taken);
+    OpcodeProfiler::record(opcodes[length], CPU::cycles - start - taken);
+    Coverage::mark(head);
+    Coverage::mark(head + length);
+    return true;
+}
+
+// pairs picked with PairProfiler, run back to back without going through step() twice
+bool CPU::fuse(const uint64_t &horizon)
+{
+    if (pc > 0xFFFB)
+    {
+        return false;
+    }
+
+    const uint16_t head = pc - 1;
+    const uint8_t *code = Memory::get_8b(head);
+    const uint8_t op = code[0];
+    const uint8_t opcodes[3] = { code[0], code[1], code[2] };
+    const uint64_t start = cycles;
+
+    if ((op & 0xC7) == 0xC6 && is_jr(code[2]))
+    {
+        // ALU A,n; JR cc,e
+        if (cycles + 8 >= horizon) { return false; }
+        handlers[op](code[1], code[2]);
+        branch(code[2], code[3]);
+        return fused(head, opcodes, 2, start, 8);
+    }
+    if ((op & 0xC6) == 0x04 && is_register((op >> 3) & 7) && is_jr(code[1]))
+    {
+        // INC r or DEC r; JR cc,e
+        if (cycles + 4 >= horizon) { return false; }
+        handlers[op](code[1], code[2]);
+        branch(code[1], code[2]);
+        return fused(head, opcodes, 1, start, 4);
+    }
+    if ((op & 0xC0) == 0x80 && is_register(op & 7) && is_jr(code[1]))
+    {
+        // ALU A,r; JR cc,e
+        if (cycles + 4 >= horizon) { return false; }
+        handlers[op](code[1], code[2]);
+        branch(code[1], code[2]);
+        return fused(head, opcodes, 1, start, 4);
+    }
+    if ((op & 0xF8) == 0x78 && is_register(op & 7) && (code[1] & 0xC0) == 0x80 && is_register(code[1] & 7))
+    {
+        // LD A,r; ALU A,r, as in LD A,B; OR C
+        if (cycles + 4 >= horizon) { return false; }
+        handlers[op](code[1], code[2]);
+        handlers[code[1]](code[2], code[3]);
+        return fused(head, opcodes, 1, start, 4);
+    }
+    if (op == 0x2A && code[1] == 0x12)
+    {
+        // LD A,(HL+); LD (DE),A
+        if (cycles + 8 >= horizon) { return false; }
+        execute<0x2A>(code[1], code[2]);
+        execute<0x12>(code[2], code[3]);
+        return fused(head, opcodes, 1, start, 8);
+    }
+    if (op == 0xF0 && (code[2] & 0xC7) == 0xC6)
+    {
+        // LDH A,(n); ALU A,n, as in LDH A,(LY); CP n
+        if (cycles + 12 >= horizon) { return false; }
+        execute<0xF0>(code[1], code[2]);
+        handlers[code[2]](code[3], code[4]);
+        return fused(head, opcodes, 2, start, 12);
+    }
+    return false;
+}
+
+void CPU::step(const uint64_t &horizon)
+{
+    if (halt_bug)
+    {
+        // run the opcode after HALT as if it sat one byte earlier, followed by itself
+        halt_bug = false;
+        pc -= 1;
+        instruction(*Memory::get_8b(pc), *Memory::get_8b(pc), *Memory::get_8b(pc + 1), 0x00);
+        return;
+    }
+
+    if (horizon && fuse(horizon))
+    {
+        return;
+    }
+
+    // pc already points one past the opcode, which was fetched at the end of the previous instruction
+    instruction(*Memory::get_8b(pc - 1), *Memory::get_8b(pc), *Memory::get_8b(pc + 1), 0x00);
+}
+
+uint32_t CPU::bulk(const uint64_t &horizon, const uint64_t &render)
+{
+    const uint16_t head = pc - 1;
+    if (halt_bug || head > 0xFFF0 || horizon <= cycles)
+    {
+        return 0;
+    }
+
+    const uint8_t *code = Memory::get_8b(head);
+    const bulk_loop *loop = nullptr;
+    for (const bulk_loop &l : bulk_loops)
+    {
+        if (std::memcmp(code, l.code, l.length) == 0)
+        {
+            loop = &l;
+            break;
+        }
+    }
+    if (loop == nullptr)
+    {
+        return 0;
+    }
+
+    // the body must be closed by a taken conditional jump straight back to the head
+    const uint8_t *branch = code + loop->length;
+    uint32_t taken;
+    if (branch[0] == 0x20 && static_cast<int8_t>(branch[1]) == -(loop->length + 2))
+    {
+        taken = 12;
+    }
+    else if (branch[0] == 0xC2 && bytes_to_16b(branch[2], branch[1]) == head)
+    {
+        taken = 16;
+    }
+    else
+    {
+        return 0;
+    }
+    uint32_t period = taken;
+    for (int i = 0; i < loop->length; i++)
+    {
+        period += loop->cycles[i];
+    }
+
+    uint32_t count;
+    switch (loop->counter)
+    {
+    case bulk_bc:
+        count = read_rp<0>() ? read_rp<0>() : 0x10000;
+        break;
+    case bulk_b:
+        count = reg[B] ? reg[B] : 0x100;
+        break;
+    default:
+        count = reg[C] ? reg[C] : 0x100;
+        break;
+    }
+
+    // the last iteration, which falls through, is left to the interpreter
+    uint16_t source = (loop->source == bulk_de) ? read_rp<1>() : read_rp<2>();
+    uint16_t destination = (loop->destination == bulk_de) ? read_rp<1>() : read_rp<2>();
+    uint32_t n = static_cast<uint32_t>(std::min<uint64_t>(count - 1, (horizon - cycles) / period));
+    if ((destination < 0xA000 && destination + n > 0x8000) || (destination < 0xFEA0 && destination + n > 0xFE00))
+    {
+        // the PPU reads VRAM and OAM when it renders a line, so stop before the next one
+        n = (render > cycles) ? static_cast<uint32_t>(std::min<uint64_t>(n, (render - cycles) / period)) : 0;
+    }
+    if (n < 2)
+    {
+        return 0;
+    }
+
+    // only plain RAM on both sides, not wrapping, and not overwriting the loop itself
+    if (destination < 0x8000 || destination + n > 0x10000 || !Memory::plain(destination, n) ||
+        (destination < head + loop->length + 3 && destination + n > head))
+    {
+        return 0;
+    }
+    if (loop->source != bulk_a && (source + n > 0x10000 || !Memory::plain(source, n)))
+    {
+        return 0;
+    }
+
+    // byte by byte and in order, so overlapping ranges behave as they would on hardware
+    uint8_t *memory = Memory::get_8b(0x0000);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        if (loop->source != bulk_a)
+        {
+            reg[A] = memory[source++];
+        }
+        memory[destination++] = reg[A];
+    }
+
+    if (loop->source == bulk_de) { write_rp<1>(source); }
+    if (loop->source == bulk_hl) { write_rp<2>(source); }
+    if (loop->destination == bulk_de) { write_rp<1>(destination); }
+    if (loop->destination == bulk_hl) { write_rp<2>(destination); }
+
+    switch (loop->counter)
+    {
+    case bulk_bc:
+        // LD A,B; OR C of a taken iteration: A non-zero, only Z could be set and it is not
+        write_rp<0>(static_cast<uint16_t>(count - n));
+        reg[A] = reg[B] | reg[C];
+        reg[F] = 0x00;
+        break;
+    default:
+        {
+            // DEC r of a taken iteration: Z clear, N set, H from the borrow, C untouched
+            uint8_t &counter = (loop->counter == bulk_b) ? reg[B] : reg[C];
+            counter = static_cast<uint8_t>(count - n);
+            reg[F] = (reg[F] & 0x1F) | 0x40 | (((counter & 0x0F) == 0x0F) ? 0x20 : 0x00);
+        }
+        break;
+    }
+
+    for (int i = 0; i < loop->length; i++)
+    {
+        OpcodeProfiler::record(loop->code[i], static_cast<uint64_t>(n) * loop->cycles[i], n);
+    }
+    OpcodeProfiler::record(branch[0], static_cast<uint64_t>(n) * taken, n);
+    // the body is all one-byte opcodes, then the branch opcode, whose operands are never run
+    Coverage::mark(head, loop->length + 1);
+
+    cycles += static_cast<uint64_t>(n) * period;
+    return n;
+}
+
+void CPU::interrupt(const uint16_t &vector)
+{
+    // pc is one past the next opcode, which is where the handler returns to
+    push(pc - 1, sp);
+    if (GuestProfiler::active())
+    {
+        GuestProfiler::interrupt(pc - 1);
+    }
+    pc = vector + 1;
+    cycles += 20;
+}
+
+void CPU::reset()
+{
+    write_rp2<3>(0x01B0);
+    write_rp<0>(0x0013);
+    write_rp<1>(0x00D8);
+    write_rp<2>(0x014D);
+    sp = 0xFFFE;
+    pc = 0x0101;
+    cycles = 0;
+    halted = false;
+    halt_bug = false;
+}
 
 #ifdef CMAKE_BUILD_TESTING
 
 void CPU::set_a(const uint8_t &z)
 {
-    uint8_t *a = reinterpret_cast<uint8_t *>(&af)+1;
-    *a = z;
+    reg[A] = z;
 }
 
 void CPU::set_b(const uint8_t &z)
 {
-    uint8_t *b = reinterpret_cast<uint8_t *>(&bc)+1;
-    *b = z;
+    reg[B] = z;
 }
 
 void CPU::set_c(const uint8_t &z)
 {
-    uint8_t *c = reinterpret_cast<uint8_t *>(&bc);
-    *c = z;
+    reg[C] = z;
 }
 
 void CPU::set_d(const uint8_t &z)
 {
-    uint8_t *d = reinterpret_cast<uint8_t *>(&de)+1;
-    *d = z;
+    reg[D] = z;
 }
 
 void CPU::set_e(const uint8_t &z)
 {
-    uint8_t *e = reinterpret_cast<uint8_t *>(&de);
-    *e = z;
+    reg[E] = z;
 }
 
 void CPU::set_f(const uint8_t &z)
 {
-    uint8_t *f = reinterpret_cast<uint8_t *>(&af);
-    *f = z;
+    reg[F] = z;
 }
 
 void CPU::set_h(const uint8_t &z)
 {
-    uint8_t *h = reinterpret_cast<uint8_t *>(&hl)+1;
-    *h = z;
+    reg[H] = z;
 }
 
 void CPU::set_l(const uint8_t &z)
 {
-    uint8_t *l = reinterpret_cast<uint8_t *>(&hl);
-    *l = z;
+    reg[L] = z;
 }
 
 void CPU::set_pc(const uint16_t &z)
@@ -1084,50 +1027,42 @@ void CPU::set_sp(const uint16_t &z)
 
 uint8_t CPU::get_a()
 {
-    uint8_t *a = reinterpret_cast<uint8_t *>(&af)+1;
-    return *a;
+    return reg[A];
 }
 
 uint8_t CPU::get_b()
 {
-    uint8_t *b = reinterpret_cast<uint8_t *>(&bc)+1;
-    return *b;
+    return reg[B];
 }
 
 uint8_t CPU::get_c()
 {
-    uint8_t *c = reinterpret_cast<uint8_t *>(&bc);
-    return *c;
+    return reg[C];
 }
 
 uint8_t CPU::get_d()
 {
-    uint8_t *d = reinterpret_cast<uint8_t *>(&de)+1;
-    return *d;
+    return reg[D];
 }
 
 uint8_t CPU::get_e()
 {
-    uint8_t *e = reinterpret_cast<uint8_t *>(&de);
-    return *e;
+    return reg[E];
 }
 
 uint8_t CPU::get_f()
 {
-    uint8_t *f = reinterpret_cast<uint8_t *>(&af);
-    return *f;
+    return reg[F];
 }
 
 uint8_t CPU::get_h()
 {
-    uint8_t *h = reinterpret_cast<uint8_t *>(&hl)+1;
-    return *h;
+    return reg[H];
 }
 
 uint8_t CPU::get_l()
 {
-    uint8_t *l = reinterpret_cast<uint8_t *>(&hl);
-    return *l;
+    return reg[L];
 }
 
 uint16_t CPU::get_pc()
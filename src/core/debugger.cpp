@@ -0,0 +1,117 @@
+#include "gameboy-emulator/core/debugger.hpp"
+
+#include "gameboy-emulator/core/memory.hpp"
+
+namespace emulator
+{
+
+thread_local std::map<uint16_t, uint8_t> Debugger::points;
+thread_local bool Debugger::paused = false;
+thread_local Debugger::Hit Debugger::last = {};
+thread_local bool Debugger::resuming = false;
+thread_local uint16_t Debugger::resume_address = 0;
+
+void Debugger::update_page(const uint8_t &page)
+{
+    uint8_t kinds = 0;
+    for (auto it = points.lower_bound(page << 8); it != points.end() && it->first >> 8 == page; ++it)
+    {
+        kinds |= it->second;
+    }
+    Memory::set_flags(page, Memory::page_debug, false);
+    Memory::set_flags(page, Memory::page_break, kinds & BREAK);
+    Memory::set_flags(page, Memory::page_watch_read, kinds & READ);
+    Memory::set_flags(page, Memory::page_watch_write, kinds & WRITE);
+}
+
+void Debugger::set(const uint16_t &address, const uint8_t &kinds, const bool &on)
+{
+    uint8_t &point = points[address];
+    point = on ? (point | kinds) : (point & ~kinds);
+    if (point == 0)
+    {
+        points.erase(address);
+    }
+    if (!on && address == resume_address)
+    {
+        resuming = false;
+    }
+    update_page(address >> 8);
+}
+
+void Debugger::add_breakpoint(const uint16_t &address)
+{
+    set(address, BREAK, true);
+}
+
+void Debugger::remove_breakpoint(const uint16_t &address)
+{
+    set(address, BREAK, false);
+}
+
+void Debugger::add_watchpoint(const uint16_t &address, const uint8_t &kinds)
+{
+    set(address, kinds & (READ | WRITE), true);
+}
+
+void Debugger::remove_watchpoint(const uint16_t &address, const uint8_t &kinds)
+{
+    set(address, kinds & (READ | WRITE), false);
+}
+
+void Debugger::clear()
+{
+    while (!points.empty())
+    {
+        const uint16_t address = points.begin()->first;
+        points.erase(points.begin());
+        update_page(address >> 8);
+    }
+    paused = false;
+    resuming = false;
+}
+
+const Debugger::Hit &Debugger::hit()
+{
+    return last;
+}
+
+void Debugger::resume()
+{
+    resuming = paused && last.kind == BREAK;
+    resume_address = last.address;
+    paused = false;
+}
+
+bool Debugger::breakpoint(const uint16_t &address)
+{
+    if (resuming)
+    {
+        resuming = false;
+        if (address == resume_address)
+        {
+            return false;
+        }
+    }
+
+    auto it = points.find(address);
+    if (it == points.end() || !(it->second & BREAK))
+    {
+        return false;
+    }
+    last = { BREAK, address, 0 };
+    paused = true;
+    return true;
+}
+
+void Debugger::access(const uint16_t &address, const uint8_t &value, const uint8_t &kind)
+{
+    auto it = points.find(address);
+    if (it != points.end() && (it->second & kind))
+    {
+        last = { kind, address, value };
+        paused = true;
+    }
+}
+
+} // namespace emulator
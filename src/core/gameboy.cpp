@@ -0,0 +1,132 @@
+#include "gameboy-emulator/core/gameboy.hpp"
+
+#include <algorithm>
+
+#include "gameboy-emulator/core/apu.hpp"
+#include "gameboy-emulator/core/cpu.hpp"
+#include "gameboy-emulator/core/debugger.hpp"
+#include "gameboy-emulator/core/guest_profiler.hpp"
+#include "gameboy-emulator/core/idle_loop.hpp"
+#include "gameboy-emulator/core/interrupts.hpp"
+#include "gameboy-emulator/core/memory.hpp"
+#include "gameboy-emulator/core/pair_profiler.hpp"
+#include "gameboy-emulator/core/ppu.hpp"
+#include "gameboy-emulator/core/scheduler.hpp"
+#include "gameboy-emulator/core/timer.hpp"
+#include "gameboy-emulator/core/tracer.hpp"
+
+namespace emulator
+{
+
+thread_local uint64_t GameBoy::ppu_cycles = 0;
+
+void GameBoy::reset()
+{
+    Scheduler::reset();
+    Memory::reset();
+    CPU::reset();
+    Timer::reset();
+    Interrupts::reset();
+    PPU::reset();
+    APU::reset();
+    IdleLoop::reset();
+    ppu_cycles = CPU::cycles;
+}
+
+uint64_t GameBoy::horizon(const uint64_t &limit)
+{
+    return std::min({ Scheduler::deadline(), ppu_cycles + PPU::cycles_to_vblank(), limit,
+                      CPU::cycles + cycles_per_frame });
+}
+
+bool GameBoy::step(const uint64_t &limit)
+{
+    if (CPU::halted)
+    {
+        // nothing can happen before the next event, so jump straight to it in whole M-cycles
+        uint64_t target = horizon(limit);
+        uint64_t skip = target > CPU::cycles ? (target - CPU::cycles + 3) & ~3ull : 0;
+        CPU::cycles += std::max<uint64_t>(skip, 4);
+    }
+    else
+    {
+        uint16_t before = CPU::get_registers().pc;
+
+        // the exact address is only looked up on pages with a breakpoint
+        if (Memory::flagged(before - 1, Memory::page_break) && Debugger::breakpoint(before - 1))
+        {
+            return false;
+        }
+
+        uint8_t opcode = *Memory::get_8b(before - 1);
+        const bool plain = PairProfiler::active() || Debugger::active() || Tracer::active();
+        if (plain)
+        {
+            // profile, trace or debug the plain instruction stream: no bulk copies or fused pairs,
+            // which could run past a breakpoint or the access a watchpoint stops after
+            if (PairProfiler::active())
+            {
+                PairProfiler::record(opcode == 0xCB ? 0x100 | *Memory::get_8b(before) : opcode);
+            }
+            CPU::step();
+        }
+        else
+        {
+            // cheap filter on the opcode before looking for a block copy or fill loop
+            if (opcode == 0x2A || opcode == 0x1A || opcode == 0x22)
+            {
+                CPU::bulk(horizon(limit), ppu_cycles + PPU::cycles_to_line_change());
+            }
+
+            // pairs may only be fused if nothing needs to run between them
+            CPU::step(std::min({ Scheduler::deadline(), ppu_cycles + PPU::cycles_to_mode_change(), limit }));
+        }
+
+        // fused pairs and block copies never call or return, so only the opcode stepped needs following
+        if (GuestProfiler::active())
+        {
+            GuestProfiler::observe(opcode, before);
+        }
+
+        uint32_t period = IdleLoop::observe(before);
+        if (period && !Debugger::active())
+        {
+            // skip a polling loop up to the first point where what it reads could change, unless
+            // it could hit a breakpoint or watchpoint on the way
+            uint64_t until = horizon(limit);
+            if (IdleLoop::reads() & Memory::access_ly)
+            {
+                until = std::min<uint64_t>(until, ppu_cycles + PPU::cycles_to_line_change());
+            }
+            if (IdleLoop::reads() & Memory::access_stat)
+            {
+                until = std::min<uint64_t>(until, ppu_cycles + PPU::cycles_to_mode_change());
+            }
+            IdleLoop::skip(until);
+        }
+    }
+
+    bool frame = PPU::tick(static_cast<uint32_t>(CPU::cycles - ppu_cycles));
+    ppu_cycles = CPU::cycles;
+
+    if (CPU::cycles >= Scheduler::deadline())
+    {
+        Scheduler::dispatch(CPU::cycles);
+    }
+    return frame;
+}
+
+bool GameBoy::run_frame()
+{
+    const uint64_t end = CPU::cycles + cycles_per_frame;
+    bool frame = false;
+    while (!frame && CPU::cycles < end && !Debugger::stopped())
+    {
+        frame = step(end);
+    }
+    APU::end_frame();
+    IdleLoop::forget();
+    return frame;
+}
+
+} // namespace emulator
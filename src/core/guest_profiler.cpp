@@ -0,0 +1,203 @@
+#include "gameboy-emulator/core/guest_profiler.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "gameboy-emulator/core/cpu.hpp"
+#include "gameboy-emulator/core/memory.hpp"
+#include "gameboy-emulator/core/scheduler.hpp"
+
+namespace emulator
+{
+
+thread_local bool GuestProfiler::enabled = false;
+thread_local uint32_t GuestProfiler::period = 0;
+thread_local std::vector<GuestProfiler::Frame> GuestProfiler::frames;
+thread_local std::map<std::vector<uint32_t>, uint64_t> GuestProfiler::stacks;
+thread_local uint64_t GuestProfiler::total = 0;
+thread_local std::map<uint32_t, std::string> GuestProfiler::symbols;
+
+// bank and address of code, the bank being the one mapped there now
+static uint32_t location(const uint16_t &address)
+{
+    const uint16_t bank = (address >= 0x4000 && address < 0x8000) ? Memory::bank() : 0;
+    return static_cast<uint32_t>(bank) << 16 | address;
+}
+
+// symbols only name code in their own region: ROM banks, VRAM, cartridge RAM, work RAM and high RAM
+static int region(const uint16_t &address)
+{
+    return address < 0x8000 ? address >> 14 : address >> 13;
+}
+
+bool GuestProfiler::start(const uint32_t &cycles)
+{
+    // sample() steps through missed periods, which never ends without one
+    if (cycles == 0)
+    {
+        return false;
+    }
+
+    enabled = true;
+    period = cycles;
+    frames.clear();
+    Scheduler::schedule(Scheduler::Event::PROFILE, CPU::cycles + period, sample);
+    return true;
+}
+
+void GuestProfiler::stop()
+{
+    enabled = false;
+    Scheduler::cancel(Scheduler::Event::PROFILE);
+}
+
+void GuestProfiler::reset()
+{
+    frames.clear();
+    stacks.clear();
+    total = 0;
+}
+
+void GuestProfiler::sample(const uint64_t &deadline)
+{
+    // a sample late by more than a period stands in for every one it missed
+    uint64_t next = deadline;
+    uint64_t weight = 0;
+    while (next <= CPU::cycles)
+    {
+        next += period;
+        weight++;
+    }
+
+    const struct registers regs = CPU::get_registers();
+    unwind(regs.sp);
+
+    std::vector<uint32_t> stack;
+    stack.reserve(frames.size() + 1);
+    for (const Frame &f : frames)
+    {
+        stack.push_back(f.caller);
+    }
+    stack.push_back(location(regs.pc - 1));
+    stacks[stack] += weight;
+    total += weight;
+
+    Scheduler::schedule(Scheduler::Event::PROFILE, next, sample);
+}
+
+void GuestProfiler::call(const uint16_t &caller)
+{
+    const uint16_t sp = CPU::get_registers().sp;
+    unwind(sp);
+    if (frames.size() < max_depth)
+    {
+        frames.push_back({ location(caller), sp });
+    }
+}
+
+void GuestProfiler::unwind(const uint16_t &sp)
+{
+    // a frame is live while its return address is still on the stack
+    while (!frames.empty() && frames.back().sp < sp)
+    {
+        frames.pop_back();
+    }
+}
+
+void GuestProfiler::observe(const uint8_t &opcode, const uint16_t &before)
+{
+    if (opcode == 0xCD || (opcode & 0xE7) == 0xC4)
+    {
+        // CALL nn or CALL cc,nn, taken unless it fell through to the next instruction
+        if (CPU::get_registers().pc != before + 3)
+        {
+            call(before - 1);
+        }
+    }
+    else if ((opcode & 0xC7) == 0xC7)
+    {
+        // RST
+        call(before - 1);
+    }
+    else if (opcode == 0xC9 || opcode == 0xD9 || (opcode & 0xE7) == 0xC0)
+    {
+        // RET, RETI or RET cc, which pops nothing when not taken
+        unwind(CPU::get_registers().sp);
+    }
+}
+
+void GuestProfiler::interrupt(const uint16_t &interrupted)
+{
+    call(interrupted);
+}
+
+bool GuestProfiler::load_symbols(const std::string &path)
+{
+    std::ifstream f(path);
+    if (!f)
+    {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(f, line))
+    {
+        line = line.substr(0, line.find(';'));
+
+        unsigned int bank;
+        unsigned int address;
+        char name[256];
+        if (std::sscanf(line.c_str(), "%x:%x %255s", &bank, &address, name) == 3 && address <= 0xFFFF)
+        {
+            symbols[bank << 16 | address] = name;
+        }
+    }
+    return true;
+}
+
+std::string GuestProfiler::name(const uint16_t &bank, const uint16_t &address)
+{
+    const uint32_t key = static_cast<uint32_t>(bank) << 16 | address;
+    auto it = symbols.upper_bound(key);
+    if (it != symbols.begin())
+    {
+        --it;
+        if (it->first >> 16 == bank && region(static_cast<uint16_t>(it->first)) == region(address))
+        {
+            return it->second;
+        }
+    }
+
+    char s[16];
+    std::snprintf(s, sizeof(s), "%02X:%04X", bank, address);
+    return s;
+}
+
+uint64_t GuestProfiler::samples()
+{
+    return total;
+}
+
+void GuestProfiler::write_collapsed(std::ostream &out)
+{
+    // locations within one routine share its name, so their stacks are merged
+    std::map<std::string, uint64_t> named;
+    for (const auto &s : stacks)
+    {
+        std::string line;
+        for (uint32_t l : s.first)
+        {
+            line += (line.empty() ? "" : ";") + name(static_cast<uint16_t>(l >> 16), static_cast<uint16_t>(l));
+        }
+        named[line] += s.second;
+    }
+
+    for (const auto &n : named)
+    {
+        out << n.first << " " << n.second << "\n";
+    }
+    out.flush();
+}
+
+} // namespace emulator
@@ -0,0 +1,149 @@
+#include "gameboy-emulator/core/idle_loop.hpp"
+
+#include <cstring>
+
+#include "gameboy-emulator/core/memory.hpp"
+
+namespace emulator
+{
+
+thread_local bool IdleLoop::enabled = true;
+
+thread_local bool IdleLoop::watching = false;
+thread_local uint16_t IdleLoop::head = 0;
+thread_local int IdleLoop::steps = 0;
+thread_local struct registers IdleLoop::entry = {};
+thread_local uint64_t IdleLoop::entry_cycles = 0;
+
+thread_local uint32_t IdleLoop::period = 0;
+thread_local uint8_t IdleLoop::accesses = 0;
+
+thread_local uint16_t IdleLoop::rejected[IdleLoop::rejected_size] = {};
+
+thread_local uint64_t IdleLoop::skipped = 0;
+
+void IdleLoop::reject()
+{
+    if (watching)
+    {
+        Memory::monitor(false);
+        watching = false;
+    }
+    rejected[head % rejected_size] = head;
+    period = 0;
+}
+
+void IdleLoop::reset()
+{
+    if (watching)
+    {
+        Memory::monitor(false);
+        watching = false;
+    }
+    period = 0;
+    skipped = 0;
+    forget();
+}
+
+void IdleLoop::set_enabled(const bool &on)
+{
+    if (!on)
+    {
+        reset();
+    }
+    enabled = on;
+}
+
+uint32_t IdleLoop::observe(const uint16_t &before)
+{
+    if (!enabled)
+    {
+        return 0;
+    }
+
+    period = 0;
+    const struct registers now = CPU::get_registers();
+
+    if (watching)
+    {
+        if (now.pc != head)
+        {
+            if (++steps > max_steps)
+            {
+                reject(); // not a tight loop
+            }
+            return 0;
+        }
+
+        // one iteration done: it is idle if it only polled and changed nothing
+        Memory::monitor(false);
+        watching = false;
+        accesses = Memory::monitored();
+        if ((accesses & (Memory::access_write | Memory::access_io)) || CPU::halted)
+        {
+            reject();
+            return 0;
+        }
+        if (!(now == entry))
+        {
+            // a loop that reads nothing but still changes registers is a delay loop, never idle;
+            // otherwise the polled value just changed, so try again on the next iteration
+            if (!(accesses & ~Memory::access_write))
+            {
+                reject();
+            }
+            return 0;
+        }
+        period = static_cast<uint32_t>(CPU::cycles - entry_cycles);
+        return period;
+    }
+
+    // only short backward branches, or jumps to self, can close a polling loop
+    if (now.pc > before || before - now.pc > 64 || rejected[now.pc % rejected_size] == now.pc)
+    {
+        return 0;
+    }
+
+    watching = true;
+    head = now.pc;
+    steps = 0;
+    entry = now;
+    entry_cycles = CPU::cycles;
+    Memory::monitor(true);
+    return 0;
+}
+
+uint8_t IdleLoop::reads()
+{
+    return accesses;
+}
+
+void IdleLoop::skip(const uint64_t &horizon)
+{
+    if (period == 0 || horizon <= CPU::cycles)
+    {
+        return;
+    }
+
+    // land on the loop head at least one iteration before anything can change
+    uint64_t n = (horizon - CPU::cycles) / period;
+    if (n < 2)
+    {
+        return;
+    }
+    uint64_t s = (n - 1) * period;
+    CPU::cycles += s;
+    skipped += s;
+}
+
+void IdleLoop::forget()
+{
+    std::memset(rejected, 0, sizeof(rejected));
+}
+
+uint64_t IdleLoop::skipped_cycles()
+{
+    return skipped;
+}
+
+} // namespace emulator
@@ -2,6 +2,7 @@
 
 #include "gameboy-emulator/core/bytelib.hpp"
 #include "gameboy-emulator/core/alu.hpp"
+#include "gameboy-emulator/core/memory.hpp"
 
 namespace emulator
 {
@@ -23,7 +24,7 @@ void ld(uint8_t &reg, const uint8_t &val)
 
 void stop()
 {
-
+    Memory::write_8b(0xFF04, 0x00);
 }
 
 void jp(uint16_t &pc, const uint16_t &address)
@@ -38,38 +39,35 @@ void jr(uint16_t &pc, const uint8_t &offset)
     alu::add(pc, d, _);
 }
 
-void ret(uint16_t &pc, uint16_t &top, uint16_t &sp)
+void ret(uint16_t &pc, uint16_t &sp)
 {
-    pop(pc, top, sp);
+    pop(pc, sp);
 }
 
-void pop(uint16_t &reg, uint16_t &top, uint16_t &sp)
+void pop(uint16_t &reg, uint16_t &sp)
 {
-    reg = top;
+    reg = bytes_to_16b(Memory::read_8b(sp + 1), Memory::read_8b(sp));
     sp += 2;
 }
 
-void push(uint8_t &top, const uint8_t &val, uint16_t &sp)
+void push(const uint16_t &val, uint16_t &sp)
 {
-    *(&top - 1) = val;
+    // high byte goes first, as on hardware
     sp -= 1;
+    Memory::write_8b(sp, static_cast<uint8_t>(val >> 8));
+    sp -= 1;
+    Memory::write_8b(sp, static_cast<uint8_t>(val & 0xFF));
 }
 
-void push(uint16_t &top, const uint16_t &val, uint16_t &sp)
-{
-    *(&top - 1) = val;
-    sp -= 2;
-}
-
-void call(uint16_t &pc, uint16_t &top, const uint16_t &val, uint16_t &sp)
+void call(uint16_t &pc, const uint16_t &val, uint16_t &sp)
 {
-    push(top, pc+2, sp); // +2 and not +3 because ret instruction increments pc by +1
+    push(pc+2, sp); // +2 and not +3 because ret instruction increments pc by +1
     pc = val;
 }
 
-void rst(uint16_t &pc, const uint8_t &val, uint16_t &top, uint16_t &sp)
+void rst(uint16_t &pc, const uint8_t &val, uint16_t &sp)
 {
-    push(top, pc, sp);
+    push(pc, sp);
     pc = val;
 }
 
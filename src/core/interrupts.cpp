@@ -0,0 +1,128 @@
+#include "gameboy-emulator/core/interrupts.hpp"
+
+#include "gameboy-emulator/core/cpu.hpp"
+#include "gameboy-emulator/core/memory.hpp"
+#include "gameboy-emulator/core/scheduler.hpp"
+
+namespace emulator
+{
+
+thread_local bool Interrupts::ime = false;
+thread_local bool Interrupts::ime_delayed = false;
+
+uint8_t Interrupts::pending()
+{
+    return *Memory::get_8b(0xFF0F) & *Memory::get_8b(0xFFFF) & 0x1F;
+}
+
+void Interrupts::update()
+{
+    // the check runs through the scheduler: an interrupt that can be taken
+    // is an event that is due right away, so the run loop needs no extra test
+    if (ime_delayed)
+    {
+        // due once the instruction after EI has completed
+        Scheduler::schedule(Scheduler::Event::INTERRUPT, CPU::cycles + 1, service);
+    }
+    else if (pending() && (ime || CPU::halted))
+    {
+        Scheduler::schedule(Scheduler::Event::INTERRUPT, CPU::cycles, service);
+    }
+    else
+    {
+        Scheduler::cancel(Scheduler::Event::INTERRUPT);
+    }
+}
+
+void Interrupts::service(const uint64_t &)
+{
+    if (ime_delayed)
+    {
+        ime_delayed = false;
+        ime = true;
+    }
+
+    uint8_t p = pending();
+    if (p && CPU::halted)
+    {
+        CPU::halted = false;
+    }
+
+    if (p && ime)
+    {
+        // the lowest bit has the highest priority
+        int i = 0;
+        while (!(p & (1 << i)))
+        {
+            i++;
+        }
+
+        ime = false;
+        *Memory::get_8b(0xFF0F) &= ~(1 << i);
+        CPU::interrupt(0x40 + i * 8);
+    }
+    update();
+}
+
+void Interrupts::reset()
+{
+    ime = false;
+    ime_delayed = false;
+    update();
+}
+
+void Interrupts::request(const uint8_t &mask)
+{
+    *Memory::get_8b(0xFF0F) |= mask;
+    update();
+}
+
+void Interrupts::enable()
+{
+    if (!ime)
+    {
+        ime_delayed = true;
+    }
+    update();
+}
+
+void Interrupts::enable_now()
+{
+    ime = true;
+    ime_delayed = false;
+    update();
+}
+
+void Interrupts::disable()
+{
+    ime = false;
+    ime_delayed = false;
+    update();
+}
+
+bool Interrupts::master_enabled()
+{
+    return ime;
+}
+
+bool Interrupts::requested()
+{
+    return pending() != 0;
+}
+
+uint8_t Interrupts::read(const uint16_t &address)
+{
+    if (address == 0xFF0F)
+    {
+        return *Memory::get_8b(0xFF0F) | 0xE0;
+    }
+    return *Memory::get_8b(0xFFFF);
+}
+
+void Interrupts::write(const uint16_t &address, const uint8_t &b)
+{
+    *Memory::get_8b(address) = (address == 0xFF0F) ? (b & 0x1F) : b;
+    update();
+}
+
+} // namespace emulator
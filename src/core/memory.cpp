@@ -1,9 +1,27 @@
 #include "gameboy-emulator/core/memory.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "gameboy-emulator/core/apu.hpp"
+#include "gameboy-emulator/core/coverage.hpp"
+#include "gameboy-emulator/core/debugger.hpp"
+#include "gameboy-emulator/core/interrupts.hpp"
+#include "gameboy-emulator/core/timer.hpp"
+
 namespace emulator
 {
 
-uint8_t Memory::registers[65536] = {};
+thread_local uint8_t Memory::registers[65536] = {};
+thread_local uint8_t Memory::page_flags[256] = {};
+thread_local uint8_t Memory::monitored_accesses = 0;
+thread_local std::vector<uint8_t> Memory::rom;
+thread_local bool Memory::mbc1 = false;
+thread_local uint8_t Memory::rom_bank_low = 1;
+thread_local uint8_t Memory::rom_bank_high = 0;
+thread_local uint16_t Memory::rom_bank = 1;
 
 uint8_t *Memory::get_8b(const uint16_t &address)
 {
@@ -15,6 +33,243 @@ uint16_t *Memory::get_16b(const uint16_t &address)
     return reinterpret_cast<uint16_t *>(&registers[address]);
 }
 
+void Memory::monitor_access(const uint16_t &address, const bool &write)
+{
+    if (write)
+    {
+        monitored_accesses |= access_write;
+    }
+    else if (address == 0xFF44)
+    {
+        monitored_accesses |= access_ly;
+    }
+    else if (address == 0xFF41)
+    {
+        monitored_accesses |= access_stat;
+    }
+    else if (address >= 0xFF00 && address < 0xFF80 && address != 0xFF0F && (address < 0xFF40 || address > 0xFF4B))
+    {
+        monitored_accesses |= access_io;
+    }
+    else if (address >= 0x8000)
+    {
+        monitored_accesses |= access_ram;
+    }
+}
+
+void Memory::monitor(const bool &on)
+{
+    if (on)
+    {
+        monitored_accesses = 0;
+    }
+    for (uint8_t &flags : page_flags)
+    {
+        flags = on ? (flags | page_monitor) : (flags & ~page_monitor);
+    }
+}
+
+uint8_t Memory::monitored()
+{
+    return monitored_accesses;
+}
+
+uint8_t Memory::read_slow(const uint16_t &address)
+{
+    const uint8_t flags = page_flags[address >> 8];
+    if (flags & page_monitor)
+    {
+        monitor_access(address, false);
+    }
+
+    uint8_t value = registers[address];
+    if (flags & page_io)
+    {
+        if (address >= 0xFF04 && address <= 0xFF07)
+        {
+            value = Timer::read(address);
+        }
+        else if (address == 0xFF0F || address == 0xFFFF)
+        {
+            value = Interrupts::read(address);
+        }
+        else if (address >= 0xFF10 && address <= 0xFF3F)
+        {
+            value = APU::read(address);
+        }
+    }
+
+    // watchpoints see the byte the read returns, not what is stored behind a register
+    if (flags & page_watch_read)
+    {
+        Debugger::access(address, value, Debugger::READ);
+    }
+    return value;
+}
+
+void Memory::write_mbc(const uint16_t &address, const uint8_t &b)
+{
+    // ROM only cartridges have nothing listening, and the write is lost
+    if (!mbc1)
+    {
+        return;
+    }
+
+    if (address >= 0x2000 && address < 0x4000)
+    {
+        rom_bank_low = b & 0x1F;
+        map_rom_bank();
+    }
+    else if (address >= 0x4000 && address < 0x6000)
+    {
+        rom_bank_high = b & 0x03;
+        map_rom_bank();
+    }
+}
+
+void Memory::map_rom_bank()
+{
+    // bank 0 can't be selected in the low bits, 20, 40 and 60 map to the bank above
+    const uint16_t banks = static_cast<uint16_t>(rom.size() / 0x4000);
+    uint16_t selected = (rom_bank_high << 5 | std::max<uint8_t>(rom_bank_low, 1)) % banks;
+    if (selected != rom_bank)
+    {
+        rom_bank = selected;
+        std::memcpy(&registers[0x4000], &rom[rom_bank * 0x4000], 0x4000);
+        Coverage::map_bank(rom_bank);
+    }
+}
+
+void Memory::write_slow(const uint16_t &address, const uint8_t &b)
+{
+    if (page_flags[address >> 8] & page_watch_write)
+    {
+        Debugger::access(address, b, Debugger::WRITE);
+    }
+    if (page_flags[address >> 8] & page_mbc)
+    {
+        if (page_flags[address >> 8] & page_monitor)
+        {
+            monitor_access(address, true);
+        }
+        write_mbc(address, b);
+        return;
+    }
+    if (page_flags[address >> 8] & page_monitor)
+    {
+        monitor_access(address, true);
+        if (!(page_flags[address >> 8] & page_io))
+        {
+            registers[address] = b;
+            return;
+        }
+    }
+    if (address >= 0xFF04 && address <= 0xFF07)
+    {
+        Timer::write(address, b);
+        return;
+    }
+    if (address == 0xFF0F || address == 0xFFFF)
+    {
+        Interrupts::write(address, b);
+        return;
+    }
+    if (address >= 0xFF10 && address <= 0xFF3F)
+    {
+        APU::write(address, b);
+        return;
+    }
+    registers[address] = b;
+}
+
+void Memory::set_flags(const uint8_t &page, const uint8_t &flags, const bool &on)
+{
+    page_flags[page] = on ? (page_flags[page] | flags) : (page_flags[page] & ~flags);
+}
+
+bool Memory::plain(const uint16_t &address, const uint32_t &length)
+{
+    if (length == 0)
+    {
+        return true;
+    }
+    for (uint32_t page = address >> 8; page <= (address + length - 1) >> 8; page++)
+    {
+        if (page_flags[page] & (page_read | page_watch_write))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Memory::load_rom(const std::string &path)
+{
+    std::ifstream f(path, std::ios::binary);
+    if (!f)
+    {
+        return false;
+    }
+    return load_rom(std::vector<uint8_t>(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()));
+}
+
+bool Memory::load_rom(const std::vector<uint8_t> &image)
+{
+    if (image.empty())
+    {
+        return false;
+    }
+
+    // whole banks only, padding a short image as the unconnected bus would read
+    rom.assign(image.begin(), image.end());
+    rom.resize(std::max<size_t>((rom.size() + 0x3FFF) & ~size_t(0x3FFF), 0x8000), 0xFF);
+    std::memcpy(registers, rom.data(), 0x8000);
+
+    // only MBC1 cartridges (0147 = 01-03) bank, anything else is a flat 32 KiB; ROM is never written either way
+    mbc1 = rom[0x0147] >= 0x01 && rom[0x0147] <= 0x03;
+    for (int page = 0x00; page < 0x80; page++)
+    {
+        page_flags[page] |= page_mbc;
+    }
+    rom_bank_low = 1;
+    rom_bank_high = 0;
+    rom_bank = 1;
+    Coverage::layout(static_cast<uint16_t>(rom.size() / 0x4000));
+    return true;
+}
+
+uint16_t Memory::bank()
+{
+    return rom_bank;
+}
+
+void Memory::reset()
+{
+    registers[0xFF0F] = 0xE1; // IF
+    registers[0xFF40] = 0x91; // LCDC
+    registers[0xFF41] = 0x85; // STAT
+    registers[0xFF42] = 0x00; // SCY
+    registers[0xFF43] = 0x00; // SCX
+    registers[0xFF44] = 0x00; // LY
+    registers[0xFF45] = 0x00; // LYC
+    registers[0xFF47] = 0xFC; // BGP
+    registers[0xFF48] = 0xFF; // OBP0
+    registers[0xFF49] = 0xFF; // OBP1
+    registers[0xFF4A] = 0x00; // WY
+    registers[0xFF4B] = 0x00; // WX
+    registers[0xFFFF] = 0x00; // IE
+
+    page_flags[0xFF] = page_io | (page_flags[0xFF] & page_debug);
+
+    // the cartridge stays inserted, its bank controller powers up with bank 1 mapped
+    rom_bank_low = 1;
+    rom_bank_high = 0;
+    if (!rom.empty())
+    {
+        map_rom_bank();
+    }
+}
+
 #ifdef CMAKE_BUILD_TESTING
 
 void Memory::write(const uint8_t &b, const uint16_t &address)
@@ -0,0 +1,116 @@
+#include "gameboy-emulator/core/oam.hpp"
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace emulator::oam
+{
+
+#if defined(__SSE2__)
+
+// gather the y bytes of 16 objects (64 bytes of oam) into one vector
+static inline __m128i gather_y(const uint8_t *oam)
+{
+    const __m128i low = _mm_set1_epi32(0xFF);
+    __m128i a = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(oam)), low);
+    __m128i b = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(oam + 16)), low);
+    __m128i c = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(oam + 32)), low);
+    __m128i d = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(oam + 48)), low);
+    return _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+}
+
+uint64_t scan(const uint8_t *oam, const uint8_t &ly, const uint8_t &size)
+{
+    // an object overlaps the line when (ly + 16 - y) mod 256 < size
+    const __m128i line = _mm_set1_epi8(static_cast<char>(ly + 16));
+    const __m128i limit = _mm_set1_epi8(static_cast<char>(size - 1));
+
+    __m128i y0 = gather_y(oam);
+    __m128i y1 = gather_y(oam + 64);
+
+    // objects 32-39, the upper half is padding and masked off below
+    const __m128i low = _mm_set1_epi32(0xFF);
+    __m128i a = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(oam + 128)), low);
+    __m128i b = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(oam + 144)), low);
+    __m128i y2 = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_setzero_si128());
+
+    __m128i d0 = _mm_sub_epi8(line, y0);
+    __m128i d1 = _mm_sub_epi8(line, y1);
+    __m128i d2 = _mm_sub_epi8(line, y2);
+
+    uint64_t m0 = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(d0, limit), d0)));
+    uint64_t m1 = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(d1, limit), d1)));
+    uint64_t m2 = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(d2, limit), d2))) & 0xFF;
+
+    return m0 | (m1 << 16) | (m2 << 32);
+}
+
+#else
+
+uint64_t scan(const uint8_t *oam, const uint8_t &ly, const uint8_t &size)
+{
+    uint64_t mask = 0;
+    for (int i = 0; i < 40; i++)
+    {
+        uint8_t row = static_cast<uint8_t>(ly + 16 - oam[i * 4]);
+        if (row < size)
+        {
+            mask |= uint64_t(1) << i;
+        }
+    }
+    return mask;
+}
+
+#endif
+
+static inline void compare_swap(uint16_t &a, uint16_t &b)
+{
+    uint16_t lo = std::min(a, b);
+    uint16_t hi = std::max(a, b);
+    a = lo;
+    b = hi;
+}
+
+int select(const uint8_t *oam, const uint8_t &ly, const uint8_t &size, uint8_t *selected)
+{
+    uint64_t mask = scan(oam, ly, size);
+
+    // keys are (x << 8) | index so ties resolve to the lower oam index,
+    // unused slots sort to the end
+    uint16_t k[10] = {
+        0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+        0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF
+    };
+
+    int n = 0;
+    while (mask && n < 10)
+    {
+        int i = __builtin_ctzll(mask);
+        mask &= mask - 1;
+        k[n++] = static_cast<uint16_t>((oam[i * 4 + 1] << 8) | i);
+    }
+
+    if (n > 1)
+    {
+        // 29 comparator sorting network for 10 inputs
+        compare_swap(k[0], k[8]); compare_swap(k[1], k[9]); compare_swap(k[2], k[7]); compare_swap(k[3], k[5]); compare_swap(k[4], k[6]);
+        compare_swap(k[0], k[2]); compare_swap(k[1], k[4]); compare_swap(k[5], k[8]); compare_swap(k[7], k[9]);
+        compare_swap(k[0], k[3]); compare_swap(k[2], k[4]); compare_swap(k[5], k[7]); compare_swap(k[6], k[9]);
+        compare_swap(k[0], k[1]); compare_swap(k[3], k[6]); compare_swap(k[8], k[9]);
+        compare_swap(k[1], k[5]); compare_swap(k[2], k[3]); compare_swap(k[4], k[8]); compare_swap(k[6], k[7]);
+        compare_swap(k[1], k[2]); compare_swap(k[3], k[5]); compare_swap(k[4], k[6]); compare_swap(k[7], k[8]);
+        compare_swap(k[2], k[3]); compare_swap(k[4], k[5]); compare_swap(k[6], k[7]);
+        compare_swap(k[3], k[4]); compare_swap(k[5], k[6]);
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        selected[i] = static_cast<uint8_t>(k[i] & 0xFF);
+    }
+    return n;
+}
+
+} // namespace emulator::oam
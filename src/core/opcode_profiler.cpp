@@ -0,0 +1,78 @@
+#include "gameboy-emulator/core/opcode_profiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace emulator
+{
+
+thread_local uint64_t OpcodeProfiler::counts[OpcodeProfiler::opcodes] = {};
+thread_local uint64_t OpcodeProfiler::times[OpcodeProfiler::opcodes] = {};
+
+void OpcodeProfiler::reset()
+{
+    std::memset(counts, 0, sizeof(counts));
+    std::memset(times, 0, sizeof(times));
+}
+
+uint64_t OpcodeProfiler::count(const uint16_t &opcode)
+{
+    return counts[opcode];
+}
+
+uint64_t OpcodeProfiler::cycles(const uint16_t &opcode)
+{
+    return times[opcode];
+}
+
+uint64_t OpcodeProfiler::instructions()
+{
+    uint64_t total = 0;
+    for (int i = 0; i < opcodes; i++)
+    {
+        total += counts[i];
+    }
+    return total;
+}
+
+std::vector<OpcodeProfiler::Entry> OpcodeProfiler::top(const size_t &n)
+{
+    std::vector<Entry> entries;
+    for (int i = 0; i < opcodes; i++)
+    {
+        if (counts[i])
+        {
+            entries.push_back({ static_cast<uint16_t>(i), counts[i], times[i] });
+        }
+    }
+
+    size_t m = std::min(n, entries.size());
+    std::partial_sort(entries.begin(), entries.begin() + m, entries.end(),
+                      [](const Entry &x, const Entry &y) { return x.cycles > y.cycles; });
+    entries.resize(m);
+    return entries;
+}
+
+void OpcodeProfiler::dump(std::ostream &out)
+{
+    uint64_t total_cycles = 0;
+    for (int i = 0; i < opcodes; i++)
+    {
+        total_cycles += times[i];
+    }
+
+    out << instructions() << " instructions in " << total_cycles << " cycles\n";
+    out << "opcode        count       cycles  cycles%\n";
+    for (const Entry &e : top(opcodes))
+    {
+        char line[64];
+        std::snprintf(line, sizeof(line), e.opcode & 0x100 ? "CB%02X  %14llu %12llu %7.2f%%\n" : "%02X    %14llu %12llu %7.2f%%\n",
+                      e.opcode & 0xFF, static_cast<unsigned long long>(e.count),
+                      static_cast<unsigned long long>(e.cycles), 100.0 * e.cycles / total_cycles);
+        out << line;
+    }
+    out.flush();
+}
+
+} // namespace emulator
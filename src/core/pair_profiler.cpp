@@ -0,0 +1,57 @@
+#include "gameboy-emulator/core/pair_profiler.hpp"
+
+#include <algorithm>
+
+namespace emulator
+{
+
+thread_local bool PairProfiler::enabled = false;
+thread_local uint16_t PairProfiler::previous = 0;
+thread_local uint64_t PairProfiler::total = 0;
+thread_local std::vector<uint32_t> PairProfiler::counts;
+
+void PairProfiler::reset()
+{
+    std::fill(counts.begin(), counts.end(), 0);
+    previous = 0;
+    total = 0;
+}
+
+void PairProfiler::set_enabled(const bool &on)
+{
+    if (on && counts.empty())
+    {
+        counts.assign(opcodes * opcodes, 0);
+    }
+    enabled = on;
+}
+
+uint64_t PairProfiler::count(const uint16_t &first, const uint16_t &second)
+{
+    return counts.empty() ? 0 : counts[first * opcodes + second];
+}
+
+uint64_t PairProfiler::instructions()
+{
+    return total;
+}
+
+std::vector<PairProfiler::Pair> PairProfiler::top(const size_t &n)
+{
+    std::vector<Pair> pairs;
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+        if (counts[i])
+        {
+            pairs.push_back({ static_cast<uint16_t>(i / opcodes), static_cast<uint16_t>(i % opcodes), counts[i] });
+        }
+    }
+
+    size_t m = std::min(n, pairs.size());
+    std::partial_sort(pairs.begin(), pairs.begin() + m, pairs.end(),
+                      [](const Pair &x, const Pair &y) { return x.count > y.count; });
+    pairs.resize(m);
+    return pairs;
+}
+
+} // namespace emulator
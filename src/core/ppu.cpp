@@ -0,0 +1,270 @@
+#include "gameboy-emulator/core/ppu.hpp"
+
+#include <cstring>
+
+#include "gameboy-emulator/core/interrupts.hpp"
+#include "gameboy-emulator/core/memory.hpp"
+#include "gameboy-emulator/core/oam.hpp"
+
+namespace emulator
+{
+
+thread_local uint8_t PPU::framebuffer[PPU::height][PPU::width] = {};
+thread_local uint8_t PPU::palettes[PPU::height][3] = {};
+
+thread_local uint32_t PPU::dot = 0;
+thread_local uint8_t PPU::window_line = 0;
+
+thread_local uint64_t PPU::line_hash[PPU::height] = {};
+thread_local std::bitset<PPU::height> PPU::dirty;
+thread_local std::bitset<PPU::height> PPU::pending;
+
+uint64_t PPU::hash_line(const uint8_t &ly)
+{
+    // FNV-1a over 64-bit words, seeded with the palettes so palette-only
+    // changes (fades, flashes) still mark the line as changed
+    uint64_t h = 0xCBF29CE484222325;
+    h = (h ^ (palettes[ly][0] | (palettes[ly][1] << 8) | (palettes[ly][2] << 16))) * 0x100000001B3;
+
+    for (int i = 0; i < width; i += 8)
+    {
+        uint64_t w;
+        std::memcpy(&w, &framebuffer[ly][i], sizeof(w));
+        h = (h ^ w) * 0x100000001B3;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+void PPU::end_frame()
+{
+    dirty = pending;
+    pending.reset();
+}
+
+bool PPU::tick(const uint32_t &t)
+{
+    uint8_t *lcdc = Memory::get_8b(0xFF40);
+    uint8_t *stat = Memory::get_8b(0xFF41);
+    uint8_t *ly = Memory::get_8b(0xFF44);
+
+    if (!(*lcdc & 0x80))
+    {
+        // lcd off: ly is held at 0 and the ppu sits in hblank
+        dot = 0;
+        window_line = 0;
+        *ly = 0;
+        *stat = *stat & 0xFC;
+        return false;
+    }
+
+    bool frame = false;
+    dot += t;
+    while (dot >= 456)
+    {
+        dot -= 456;
+        if (*ly < height)
+        {
+            render_line(*ly);
+        }
+
+        *ly = *ly + 1;
+        if (*ly == height)
+        {
+            Interrupts::request(Interrupts::vblank);
+            end_frame();
+            frame = true;
+        }
+        else if (*ly == 154)
+        {
+            *ly = 0;
+            window_line = 0;
+        }
+    }
+
+    // mode bits: 2 oam scan, 3 drawing, 0 hblank, 1 vblank
+    uint8_t mode;
+    if (*ly >= height) { mode = 1; }
+    else if (dot < 80) { mode = 2; }
+    else if (dot < 252) { mode = 3; }
+    else { mode = 0; }
+
+    uint8_t coincidence = (*ly == *Memory::get_8b(0xFF45)) ? 0x04 : 0x00;
+    *stat = (*stat & 0xF8) | coincidence | mode;
+    return frame;
+}
+
+void PPU::reset()
+{
+    dot = 0;
+    window_line = 0;
+    invalidate();
+}
+
+uint32_t PPU::cycles_to_vblank()
+{
+    if (!(*Memory::get_8b(0xFF40) & 0x80))
+    {
+        return ~0u;
+    }
+
+    // ly reaches 144 at the end of line 143, after wrapping if it is in vblank now
+    uint32_t ly = *Memory::get_8b(0xFF44);
+    uint32_t lines = (ly < height) ? height - ly : 154 - ly + height;
+    return lines * 456 - dot;
+}
+
+uint32_t PPU::cycles_to_line_change()
+{
+    if (!(*Memory::get_8b(0xFF40) & 0x80))
+    {
+        return ~0u;
+    }
+    return 456 - dot;
+}
+
+uint32_t PPU::cycles_to_mode_change()
+{
+    if (!(*Memory::get_8b(0xFF40) & 0x80))
+    {
+        return ~0u;
+    }
+
+    if (*Memory::get_8b(0xFF44) >= height || dot >= 252)
+    {
+        return 456 - dot;
+    }
+    return (dot < 80) ? 80 - dot : 252 - dot;
+}
+
+void PPU::render_line(const uint8_t &ly)
+{
+    uint8_t lcdc = *Memory::get_8b(0xFF40);
+    uint8_t scy = *Memory::get_8b(0xFF42);
+    uint8_t scx = *Memory::get_8b(0xFF43);
+    uint8_t wy = *Memory::get_8b(0xFF4A);
+    uint8_t wx = *Memory::get_8b(0xFF4B);
+
+    palettes[ly][0] = *Memory::get_8b(0xFF47);
+    palettes[ly][1] = *Memory::get_8b(0xFF48);
+    palettes[ly][2] = *Memory::get_8b(0xFF49);
+
+    uint8_t *line = framebuffer[ly];
+    uint8_t bg[width] = {}; // background colour indices, needed for object priority
+
+    // background and window
+    if (lcdc & 0x01)
+    {
+        bool window = (lcdc & 0x20) && wy <= ly && wx <= 166;
+        uint16_t bg_map = (lcdc & 0x08) ? 0x9C00 : 0x9800;
+        uint16_t win_map = (lcdc & 0x40) ? 0x9C00 : 0x9800;
+
+        for (int x = 0; x < width; x++)
+        {
+            uint16_t map;
+            uint8_t px, py;
+            if (window && x + 7 >= wx)
+            {
+                map = win_map;
+                px = static_cast<uint8_t>(x + 7 - wx);
+                py = window_line;
+            }
+            else
+            {
+                map = bg_map;
+                px = static_cast<uint8_t>(x + scx);
+                py = static_cast<uint8_t>(ly + scy);
+            }
+
+            uint8_t tile = *Memory::get_8b(map + (py / 8) * 32 + px / 8);
+            uint16_t address;
+            if (lcdc & 0x10)
+            {
+                address = 0x8000 + tile * 16;
+            }
+            else
+            {
+                address = 0x9000 + static_cast<int8_t>(tile) * 16;
+            }
+            address += (py % 8) * 2;
+
+            uint8_t lo = *Memory::get_8b(address);
+            uint8_t hi = *Memory::get_8b(address + 1);
+            uint8_t bit = 7 - px % 8;
+            bg[x] = (((hi >> bit) & 1) << 1) | ((lo >> bit) & 1);
+        }
+
+        if (window)
+        {
+            window_line++;
+        }
+    }
+    std::memcpy(line, bg, width);
+
+    // objects
+    if (lcdc & 0x02)
+    {
+        uint8_t size = (lcdc & 0x04) ? 16 : 8;
+        uint8_t *objects = Memory::get_8b(0xFE00);
+
+        uint8_t selected[10];
+        int n = oam::select(objects, ly, size, selected);
+
+        bool taken[width] = {};
+        for (int i = 0; i < n; i++)
+        {
+            uint8_t *obj = &objects[selected[i] * 4];
+            uint8_t attributes = obj[3];
+            uint8_t row = static_cast<uint8_t>(ly + 16 - obj[0]);
+            if (attributes & 0x40) { row = size - 1 - row; } // y flip
+
+            uint8_t tile = (size == 16) ? (obj[2] & 0xFE) : obj[2];
+            uint16_t address = 0x8000 + tile * 16 + row * 2;
+            uint8_t lo = *Memory::get_8b(address);
+            uint8_t hi = *Memory::get_8b(address + 1);
+            uint8_t palette = (attributes & 0x10) ? 2 : 1;
+
+            for (int col = 0; col < 8; col++)
+            {
+                int x = obj[1] - 8 + col;
+                if (x < 0 || x >= width || taken[x]) { continue; }
+
+                uint8_t bit = (attributes & 0x20) ? col : 7 - col; // x flip
+                uint8_t ci = (((hi >> bit) & 1) << 1) | ((lo >> bit) & 1);
+                if (ci == 0) { continue; }
+
+                // the highest priority opaque object owns the pixel even when hidden behind the background
+                taken[x] = true;
+                if (!(attributes & 0x80) || bg[x] == 0)
+                {
+                    line[x] = (palette << 2) | ci;
+                }
+            }
+        }
+    }
+
+    uint64_t h = hash_line(ly);
+    if (h != line_hash[ly])
+    {
+        line_hash[ly] = h;
+        pending.set(ly);
+    }
+}
+
+bool PPU::line_dirty(const uint8_t &ly)
+{
+    return dirty.test(ly);
+}
+
+const std::bitset<PPU::height> &PPU::dirty_lines()
+{
+    return dirty;
+}
+
+void PPU::invalidate()
+{
+    dirty.set();
+    pending.set();
+}
+
+} // namespace emulator
@@ -0,0 +1,161 @@
+#include "gameboy-emulator/core/resampler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace emulator
+{
+
+static_assert(Resampler::phases == 256, "the phase is taken from the top 8 fraction bits");
+
+Resampler::Resampler(const uint32_t &input_rate, const uint32_t &output_rate)
+{
+    const double pi = 3.14159265358979323846;
+    const int half = taps / 2;
+
+    // cut off below the lower of the two nyquist frequencies, in cycles per input sample
+    const double cutoff = 0.45 * std::min(1.0, static_cast<double>(output_rate) / input_rate);
+
+    for (int p = 0; p < phases; p++)
+    {
+        double frac = static_cast<double>(p) / phases;
+        double k[taps];
+        double sum = 0.0;
+        for (int i = 0; i < taps; i++)
+        {
+            double x = i - (half - 1) - frac;
+            double sinc = (x == 0.0) ? 2.0 * cutoff : std::sin(2.0 * pi * cutoff * x) / (pi * x);
+            double window = 0.42 + 0.5 * std::cos(pi * x / half) + 0.08 * std::cos(2.0 * pi * x / half);
+            k[i] = sinc * window;
+            sum += k[i];
+        }
+        for (int i = 0; i < taps; i++)
+        {
+            kernel[p][i * 2] = static_cast<float>(k[i] / sum);
+            kernel[p][i * 2 + 1] = static_cast<float>(k[i] / sum);
+        }
+    }
+
+    nominal_step = (static_cast<uint64_t>(input_rate) << 32) / output_rate;
+    clear();
+}
+
+void Resampler::clear()
+{
+    std::memset(history, 0, sizeof(history));
+    count = 0;
+    position = 0;
+    step = nominal_step;
+}
+
+void Resampler::set_fill(const double &fill)
+{
+    double adjust = max_adjust * (std::clamp(fill, 0.0, 1.0) * 2.0 - 1.0);
+    step = static_cast<uint64_t>(static_cast<double>(nominal_step) * (1.0 + adjust));
+}
+
+size_t Resampler::write(const int16_t *in, const size_t &frames)
+{
+    size_t n = std::min(frames, capacity + taps - count);
+    float *dst = history + count * 2;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    // four stereo frames at a time, sign extending int16 to int32 before converting
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 2));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(dst + i * 2, _mm_cvtepi32_ps(lo));
+        _mm_storeu_ps(dst + i * 2 + 4, _mm_cvtepi32_ps(hi));
+    }
+#endif
+    for (; i < n; i++)
+    {
+        dst[i * 2] = in[i * 2];
+        dst[i * 2 + 1] = in[i * 2 + 1];
+    }
+
+    count += n;
+    return n;
+}
+
+size_t Resampler::input_needed(const size_t &frames) const
+{
+    if (frames == 0)
+    {
+        return 0;
+    }
+    uint64_t last = (position + step * (frames - 1)) >> 32;
+    size_t needed = static_cast<size_t>(last) + taps;
+    return needed > count ? needed - count : 0;
+}
+
+// filter one output frame starting at an input frame
+static inline void filter(const float *in, const float *k, int16_t *out)
+{
+#if defined(__SSE2__)
+    // accumulates [l r l r], two taps per multiply
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (int i = 0; i < Resampler::taps * 2; i += 8)
+    {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(in + i), _mm_load_ps(k + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(in + i + 4), _mm_load_ps(k + i + 4)));
+    }
+    __m128 acc = _mm_add_ps(acc0, acc1);
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+
+    // round, then saturate to int16 while packing
+    __m128i v = _mm_cvtps_epi32(acc);
+    v = _mm_packs_epi32(v, v);
+    int32_t lr = _mm_cvtsi128_si32(v);
+    std::memcpy(out, &lr, sizeof(lr));
+#else
+    float l = 0.0f;
+    float r = 0.0f;
+    for (int i = 0; i < Resampler::taps * 2; i += 2)
+    {
+        l += in[i] * k[i];
+        r += in[i + 1] * k[i + 1];
+    }
+    out[0] = static_cast<int16_t>(std::clamp(std::lrint(l), -32768l, 32767l));
+    out[1] = static_cast<int16_t>(std::clamp(std::lrint(r), -32768l, 32767l));
+#endif
+}
+
+size_t Resampler::read(int16_t *out, const size_t &frames)
+{
+    size_t n = 0;
+    while (n < frames)
+    {
+        size_t i = static_cast<size_t>(position >> 32);
+        if (i + taps > count)
+        {
+            break;
+        }
+
+        int phase = static_cast<int>((position >> (32 - 8)) & (phases - 1));
+        filter(history + i * 2, kernel[phase], out + n * 2);
+        position += step;
+        n++;
+    }
+
+    // drop input no future output frame reaches back to
+    size_t used = std::min(static_cast<size_t>(position >> 32), count);
+    if (used > 0)
+    {
+        std::memmove(history, history + used * 2, (count - used) * 2 * sizeof(float));
+        count -= used;
+        position -= static_cast<uint64_t>(used) << 32;
+    }
+    return n;
+}
+
+} // namespace emulator
@@ -0,0 +1,60 @@
+#include "gameboy-emulator/core/scheduler.hpp"
+
+namespace emulator
+{
+
+thread_local uint64_t Scheduler::deadlines[static_cast<int>(Scheduler::Event::COUNT)] = {};
+thread_local Scheduler::Handler Scheduler::handlers[static_cast<int>(Scheduler::Event::COUNT)] = {};
+thread_local uint64_t Scheduler::next = Scheduler::never;
+
+void Scheduler::update()
+{
+    next = never;
+    for (uint64_t d : deadlines)
+    {
+        next = d < next ? d : next;
+    }
+}
+
+void Scheduler::reset()
+{
+    for (int i = 0; i < static_cast<int>(Event::COUNT); i++)
+    {
+        deadlines[i] = never;
+        handlers[i] = nullptr;
+    }
+    next = never;
+}
+
+void Scheduler::schedule(const Event &event, const uint64_t &cycle, const Handler &handler)
+{
+    deadlines[static_cast<int>(event)] = cycle;
+    handlers[static_cast<int>(event)] = handler;
+    update();
+}
+
+void Scheduler::cancel(const Event &event)
+{
+    deadlines[static_cast<int>(event)] = never;
+    update();
+}
+
+void Scheduler::dispatch(const uint64_t &cycle)
+{
+    while (next <= cycle)
+    {
+        int first = 0;
+        for (int i = 1; i < static_cast<int>(Event::COUNT); i++)
+        {
+            first = deadlines[i] < deadlines[first] ? i : first;
+        }
+
+        // the handler may schedule the event again
+        uint64_t deadline = deadlines[first];
+        deadlines[first] = never;
+        update();
+        handlers[first](deadline);
+    }
+}
+
+} // namespace emulator
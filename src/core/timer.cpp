@@ -0,0 +1,144 @@
+#include "gameboy-emulator/core/timer.hpp"
+
+#include "gameboy-emulator/core/cpu.hpp"
+#include "gameboy-emulator/core/interrupts.hpp"
+#include "gameboy-emulator/core/scheduler.hpp"
+
+namespace emulator
+{
+
+thread_local uint64_t Timer::div_base = 0;
+thread_local uint16_t Timer::tima = 0;
+thread_local uint64_t Timer::tima_base = 0;
+thread_local uint8_t Timer::tma = 0;
+thread_local uint8_t Timer::tac = 0;
+
+// TIMA counts falling edges of system counter bit 9, 3, 5 or 7, so once every 2^shift cycles
+static const int shifts[4] = { 10, 4, 6, 8 };
+
+uint16_t Timer::counter(const uint64_t &cycle)
+{
+    return static_cast<uint16_t>(cycle - div_base);
+}
+
+int Timer::edge_shift()
+{
+    return shifts[tac & 0x03];
+}
+
+bool Timer::input(const uint64_t &cycle)
+{
+    // the enable bit gates the selected counter bit before the edge detector
+    return (tac & 0x04) && (counter(cycle) & (1 << (edge_shift() - 1)));
+}
+
+void Timer::sync(const uint64_t &cycle)
+{
+    if ((tac & 0x04) && tima < 256)
+    {
+        int s = edge_shift();
+        uint64_t edges = ((cycle - div_base) >> s) - ((tima_base - div_base) >> s);
+        tima = static_cast<uint16_t>(tima + edges);
+    }
+    tima_base = cycle;
+}
+
+void Timer::increment(const uint64_t &cycle)
+{
+    if (tima < 256 && ++tima == 256)
+    {
+        Scheduler::schedule(Scheduler::Event::TIMER, cycle + 4, overflow);
+    }
+}
+
+void Timer::schedule_overflow()
+{
+    if (tima >= 256)
+    {
+        return; // reload already scheduled
+    }
+    if (!(tac & 0x04))
+    {
+        Scheduler::cancel(Scheduler::Event::TIMER);
+        return;
+    }
+
+    // the edge that takes TIMA past 255, then 4 cycles until the reload
+    int s = edge_shift();
+    uint64_t edges = ((tima_base - div_base) >> s) + (256 - tima);
+    Scheduler::schedule(Scheduler::Event::TIMER, div_base + (edges << s) + 4, overflow);
+}
+
+void Timer::overflow(const uint64_t &deadline)
+{
+    sync(deadline);
+    tima = tma;
+    Interrupts::request(Interrupts::timer);
+    schedule_overflow();
+}
+
+void Timer::reset()
+{
+    // the boot ROM leaves the system counter at ABCC
+    div_base = CPU::cycles - 0xABCC;
+    tima = 0;
+    tima_base = CPU::cycles;
+    tma = 0;
+    tac = 0;
+    Scheduler::cancel(Scheduler::Event::TIMER);
+}
+
+uint8_t Timer::read(const uint16_t &address)
+{
+    switch (address)
+    {
+    case 0xFF04:
+        return static_cast<uint8_t>(counter(CPU::cycles) >> 8);
+    case 0xFF05:
+        sync(CPU::cycles);
+        return tima < 256 ? static_cast<uint8_t>(tima) : 0x00;
+    case 0xFF06:
+        return tma;
+    default:
+        return tac | 0xF8;
+    }
+}
+
+void Timer::write(const uint16_t &address, const uint8_t &b)
+{
+    const uint64_t now = CPU::cycles;
+    sync(now);
+
+    switch (address)
+    {
+    case 0xFF04:
+        // clearing the counter is a falling edge if the selected bit was set
+        if (input(now))
+        {
+            increment(now);
+        }
+        div_base = now;
+        break;
+    case 0xFF05:
+        // a write between the overflow and the reload cancels the reload
+        tima = b;
+        break;
+    case 0xFF06:
+        tma = b;
+        break;
+    default:
+    {
+        bool before = input(now);
+        tac = b & 0x07;
+        if (before && !input(now))
+        {
+            increment(now);
+        }
+        break;
+    }
+    }
+
+    schedule_overflow();
+}
+
+} // namespace emulator
@@ -0,0 +1,146 @@
+#include "gameboy-emulator/core/tracer.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include "gameboy-emulator/core/ring_buffer.hpp"
+
+namespace emulator
+{
+
+// records buffered between the emulation thread and the writer, about 1.5 MiB of them
+static constexpr size_t ring_size = 1 << 16;
+
+struct Tracer::Session
+{
+    RingBuffer<TraceRecord, ring_size> ring;
+    std::FILE *file;
+    std::thread writer;
+    std::atomic<bool> running{true};
+};
+
+thread_local Tracer::Session *Tracer::session = nullptr;
+
+static void put_16(uint8_t *p, const uint16_t &v)
+{
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+static uint16_t get_16(const uint8_t *p)
+{
+    return static_cast<uint16_t>(p[0] | p[1] << 8);
+}
+
+static void encode(const TraceRecord &r, uint8_t *p)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        p[i] = static_cast<uint8_t>(r.cycle >> (i * 8));
+    }
+    put_16(p + 8, r.pc);
+    p[10] = r.bytes[0];
+    p[11] = r.bytes[1];
+    p[12] = r.bytes[2];
+    p[13] = 0;
+    put_16(p + 14, r.af);
+    put_16(p + 16, r.bc);
+    put_16(p + 18, r.de);
+    put_16(p + 20, r.hl);
+    put_16(p + 22, r.sp);
+}
+
+TraceRecord Tracer::decode(const uint8_t *p)
+{
+    TraceRecord r;
+    r.cycle = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        r.cycle |= static_cast<uint64_t>(p[i]) << (i * 8);
+    }
+    r.pc = get_16(p + 8);
+    r.bytes[0] = p[10];
+    r.bytes[1] = p[11];
+    r.bytes[2] = p[12];
+    r.af = get_16(p + 14);
+    r.bc = get_16(p + 16);
+    r.de = get_16(p + 18);
+    r.hl = get_16(p + 20);
+    r.sp = get_16(p + 22);
+    return r;
+}
+
+// drain the ring to the file until stopped, then whatever is left
+static void write(Tracer::Session *s)
+{
+    TraceRecord records[1024];
+    uint8_t encoded[sizeof(records) / sizeof(records[0]) * Tracer::record_size];
+    while (true)
+    {
+        const bool last = !s->running.load(std::memory_order_acquire);
+        size_t n = s->ring.read(records, 1024);
+        for (size_t i = 0; i < n; i++)
+        {
+            encode(records[i], encoded + i * Tracer::record_size);
+        }
+        std::fwrite(encoded, Tracer::record_size, n, s->file);
+
+        if (n == 0)
+        {
+            if (last)
+            {
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+void Tracer::append(const TraceRecord &record)
+{
+    // a full ring waits for the writer rather than losing records
+    while (session->ring.write(&record, 1) == 0)
+    {
+        std::this_thread::yield();
+    }
+}
+
+bool Tracer::start(const std::string &path)
+{
+    if (session != nullptr)
+    {
+        return false;
+    }
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    uint8_t header[header_size] = { 'G', 'B', 'T', 'R' };
+    put_16(header + 4, version);
+    put_16(header + 6, record_size);
+    std::fwrite(header, 1, header_size, file);
+
+    session = new Session();
+    session->file = file;
+    session->writer = std::thread(write, session);
+    return true;
+}
+
+void Tracer::stop()
+{
+    if (session == nullptr)
+    {
+        return;
+    }
+    session->running.store(false, std::memory_order_release);
+    session->writer.join();
+    std::fclose(session->file);
+    delete session;
+    session = nullptr;
+}
+
+} // namespace emulator
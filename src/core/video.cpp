@@ -0,0 +1,131 @@
+#include "gameboy-emulator/core/video.hpp"
+
+#include <cstring>
+
+namespace emulator::video
+{
+
+// shade of each colour index under every possible palette byte
+static uint8_t shade_lut[256][4];
+
+// output value of each shade per format
+static uint32_t rgba_lut[4];
+static uint16_t rgb565_lut[4];
+static uint8_t gray_lut[4];
+
+static bool build_luts()
+{
+    for (int p = 0; p < 256; p++)
+    {
+        for (int ci = 0; ci < 4; ci++)
+        {
+            shade_lut[p][ci] = (p >> (ci * 2)) & 0b11;
+        }
+    }
+
+    const uint32_t grays[4] = { 0xFFFFFF, 0xAAAAAA, 0x555555, 0x000000 };
+    set_colours(grays);
+    return true;
+}
+
+static const bool luts_built = build_luts();
+
+void set_colours(const uint32_t rgb[4])
+{
+    for (int s = 0; s < 4; s++)
+    {
+        uint8_t r = (rgb[s] >> 16) & 0xFF;
+        uint8_t g = (rgb[s] >> 8) & 0xFF;
+        uint8_t b = rgb[s] & 0xFF;
+
+        uint8_t bytes[4] = { r, g, b, 0xFF };
+        std::memcpy(&rgba_lut[s], bytes, sizeof(bytes));
+        rgb565_lut[s] = static_cast<uint16_t>(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+        gray_lut[s] = static_cast<uint8_t>((r * 77 + g * 150 + b * 29) >> 8);
+    }
+}
+
+size_t line_size(const PixelFormat &format)
+{
+    switch (format)
+    {
+    case PixelFormat::RGBA8888:
+        return PPU::width * 4;
+    case PixelFormat::RGB565:
+        return PPU::width * 2;
+    case PixelFormat::GRAY8:
+        return PPU::width;
+    case PixelFormat::INDEX2:
+        return PPU::width / 4;
+    default:
+        return 0;
+    }
+}
+
+template <typename T>
+static void expand_line(const uint8_t *src, const uint8_t *shades, const T *lut, uint8_t *dst)
+{
+    // fold the line's palettes and the format into one table indexed by framebuffer pixel
+    T line_lut[12];
+    for (int i = 0; i < 12; i++)
+    {
+        line_lut[i] = lut[shades[i]];
+    }
+
+    T out[PPU::width];
+    for (int x = 0; x < PPU::width; x++)
+    {
+        out[x] = line_lut[src[x]];
+    }
+    std::memcpy(dst, out, sizeof(out));
+}
+
+void convert_line(const PixelFormat &format, const uint8_t &ly, uint8_t *dst)
+{
+    const uint8_t *src = PPU::framebuffer[ly];
+
+    uint8_t shades[12];
+    for (int p = 0; p < 3; p++)
+    {
+        std::memcpy(&shades[p * 4], shade_lut[PPU::palettes[ly][p]], 4);
+    }
+
+    switch (format)
+    {
+    case PixelFormat::RGBA8888:
+        expand_line(src, shades, rgba_lut, dst);
+        break;
+    case PixelFormat::RGB565:
+        expand_line(src, shades, rgb565_lut, dst);
+        break;
+    case PixelFormat::GRAY8:
+        expand_line(src, shades, gray_lut, dst);
+        break;
+    case PixelFormat::INDEX2:
+        // colour indices as the PPU fetched them, without the palette
+        for (int x = 0; x < PPU::width; x += 4)
+        {
+            dst[x / 4] = static_cast<uint8_t>(((src[x] & 0b11) << 6) | ((src[x + 1] & 0b11) << 4) |
+                                              ((src[x + 2] & 0b11) << 2) | (src[x + 3] & 0b11));
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+int convert(const PixelFormat &format, uint8_t *dst, const size_t &pitch, const std::bitset<PPU::height> &lines)
+{
+    int n = 0;
+    for (int ly = 0; ly < PPU::height; ly++)
+    {
+        if (lines.test(ly))
+        {
+            convert_line(format, static_cast<uint8_t>(ly), dst + ly * pitch);
+            n++;
+        }
+    }
+    return n;
+}
+
+} // namespace emulator::video
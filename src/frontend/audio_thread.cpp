@@ -0,0 +1,97 @@
+#include "gameboy-emulator/frontend/audio_thread.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "gameboy-emulator/core/apu.hpp"
+#include "gameboy-emulator/core/resampler.hpp"
+
+namespace emulator::frontend
+{
+
+std::thread AudioThread::thread;
+std::atomic<bool> AudioThread::running{false};
+
+AudioSink AudioThread::sink = nullptr;
+void *AudioThread::sink_user = nullptr;
+uint32_t AudioThread::rate = 48000;
+size_t AudioThread::period = 1024;
+
+std::atomic<uint64_t> AudioThread::periods{0};
+std::atomic<uint64_t> AudioThread::underruns{0};
+
+void AudioThread::run()
+{
+    using clock = std::chrono::steady_clock;
+    const auto period_time = std::chrono::nanoseconds(1000000000ull * period / rate);
+
+    static int16_t input[Resampler::capacity * 2];
+    static int16_t samples[max_period * 2];
+
+    // keep about four periods queued in the ring
+    const double target = 4.0 * period * APU::sample_rate / rate;
+
+    Resampler resampler(APU::sample_rate, rate);
+    auto deadline = clock::now();
+    while (running.load(std::memory_order_relaxed))
+    {
+        APU::Output &ring = APU::output();
+        resampler.set_fill(ring.size() / 2 / (target * 2.0));
+
+        size_t wanted = std::min(resampler.input_needed(period), Resampler::capacity);
+        size_t got = ring.read(input, wanted * 2) / 2;
+        resampler.write(input, got);
+
+        size_t n = resampler.read(samples, period);
+        if (n < period)
+        {
+            std::memset(samples + n * 2, 0, (period - n) * 2 * sizeof(int16_t));
+            underruns.fetch_add(1, std::memory_order_relaxed);
+        }
+        sink(samples, period, sink_user);
+        periods.fetch_add(1, std::memory_order_relaxed);
+
+        deadline += period_time;
+        auto now = clock::now();
+        if (deadline < now - 4 * period_time)
+        {
+            deadline = now; // fell far behind, don't try to catch up
+        }
+        std::this_thread::sleep_until(deadline);
+    }
+}
+
+void AudioThread::start(const AudioSink &s, void *user, const uint32_t &output_rate, const size_t &frames)
+{
+    stop();
+    sink = s;
+    sink_user = user;
+    rate = output_rate;
+    period = std::clamp<size_t>(frames, 1, max_period);
+    periods.store(0, std::memory_order_relaxed);
+    underruns.store(0, std::memory_order_relaxed);
+    running.store(true, std::memory_order_relaxed);
+    thread = std::thread(run);
+}
+
+void AudioThread::stop()
+{
+    running.store(false, std::memory_order_relaxed);
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+}
+
+uint64_t AudioThread::period_count()
+{
+    return periods.load(std::memory_order_relaxed);
+}
+
+uint64_t AudioThread::underrun_count()
+{
+    return underruns.load(std::memory_order_relaxed);
+}
+
+} // namespace emulator::frontend
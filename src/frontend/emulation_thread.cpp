@@ -0,0 +1,141 @@
+#include "gameboy-emulator/frontend/emulation_thread.hpp"
+
+#include <chrono>
+#include <iostream>
+
+#include "gameboy-emulator/core/coverage.hpp"
+#include "gameboy-emulator/core/gameboy.hpp"
+#include "gameboy-emulator/core/memory.hpp"
+#include "gameboy-emulator/core/opcode_profiler.hpp"
+
+#ifdef GAMEBOY_TRACE
+#include "gameboy-emulator/core/tracer.hpp"
+#endif
+
+namespace emulator::frontend
+{
+
+std::thread EmulationThread::thread;
+std::atomic<bool> EmulationThread::running{false};
+
+video::PixelFormat EmulationThread::output_format = video::PixelFormat::RGBA8888;
+bool EmulationThread::paced = true;
+
+TripleBuffer<Frame> EmulationThread::buffer;
+std::bitset<PPU::height> EmulationThread::stale[3];
+
+void EmulationThread::run(const std::string &rom, [[maybe_unused]] const std::string &trace, const bool &profile,
+                          const std::string &coverage, std::promise<bool> loaded)
+{
+    GameBoy::reset();
+    if (!Memory::load_rom(rom))
+    {
+        loaded.set_value(false);
+        return;
+    }
+    loaded.set_value(true);
+
+#ifdef GAMEBOY_TRACE
+    // the tracer records the thread that starts it, so it is started here
+    if (!trace.empty() && !Tracer::start(trace))
+    {
+        std::cerr << "could not write trace " << trace << std::endl;
+    }
+#endif
+
+    using clock = std::chrono::steady_clock;
+    const auto frame_time = std::chrono::nanoseconds(1000000000ull * GameBoy::cycles_per_frame / 4194304);
+
+    // changes of frames that were dropped, which the next frame has to carry to the presenter
+    std::bitset<PPU::height> carried;
+    carried.set();
+    for (auto &s : stale) { s.set(); }
+
+    uint64_t number = 0;
+    auto deadline = clock::now();
+    while (running.load(std::memory_order_relaxed))
+    {
+        if (GameBoy::run_frame())
+        {
+            const std::bitset<PPU::height> &dirty = PPU::dirty_lines();
+            for (auto &s : stale) { s |= dirty; }
+
+            // only lines this buffer has not seen yet are converted
+            int i = buffer.write_index();
+            Frame &frame = buffer.write_buffer();
+            frame.format = output_format;
+            frame.pitch = video::line_size(output_format);
+            video::convert(output_format, frame.pixels, frame.pitch, stale[i]);
+            stale[i].reset();
+
+            frame.dirty = dirty | carried;
+            frame.number = ++number;
+            carried.reset();
+
+            if (buffer.publish())
+            {
+                carried = buffer.write_buffer().dirty;
+            }
+        }
+
+        if (paced)
+        {
+            deadline += frame_time;
+            auto now = clock::now();
+            if (deadline < now - 4 * frame_time)
+            {
+                deadline = now; // fell far behind, don't try to catch up
+            }
+            std::this_thread::sleep_until(deadline);
+        }
+    }
+
+#ifdef GAMEBOY_TRACE
+    Tracer::stop();
+#endif
+
+    // the counts and coverage are this thread's, so they are written out here
+    if (profile)
+    {
+        OpcodeProfiler::dump(std::cerr);
+    }
+    if (!coverage.empty() && !Coverage::dump(coverage))
+    {
+        std::cerr << "could not write coverage " << coverage << std::endl;
+    }
+}
+
+bool EmulationThread::start(const std::string &rom, const video::PixelFormat &format, const bool &throttle,
+                            const std::string &trace, const bool &profile, const std::string &coverage)
+{
+    stop();
+    output_format = format;
+    paced = throttle;
+    running.store(true, std::memory_order_relaxed);
+
+    std::promise<bool> loaded;
+    std::future<bool> result = loaded.get_future();
+    thread = std::thread(run, rom, trace, profile, coverage, std::move(loaded));
+    if (!result.get())
+    {
+        stop();
+        return false;
+    }
+    return true;
+}
+
+void EmulationThread::stop()
+{
+    running.store(false, std::memory_order_relaxed);
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+}
+
+TripleBuffer<Frame> &EmulationThread::frames()
+{
+    return buffer;
+}
+
+} // namespace emulator::frontend
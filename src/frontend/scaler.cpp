@@ -0,0 +1,395 @@
+#include "gameboy-emulator/frontend/scaler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "gameboy-emulator/frontend/emulation_thread.hpp"
+
+namespace emulator::frontend
+{
+
+static constexpr int width = PPU::width;
+static_assert(width % 4 == 0, "rows are processed 4 pixels at a time");
+
+// copy a source line into a row padded on both sides with its edge pixels
+static void load_row(const uint8_t *src, int y, uint32_t *row)
+{
+    y = std::clamp(y, 0, PPU::height - 1);
+    std::memcpy(row + 1, src + y * width * 4, width * 4);
+    row[0] = row[1];
+    row[width + 1] = row[width];
+}
+
+#if defined(__SSE2__)
+
+static inline __m128i select(const __m128i &mask, const __m128i &a, const __m128i &b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static inline void store(uint32_t *dst, const __m128i &v)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), v);
+}
+
+// write [a0 b0 a1 b1 a2 b2 a3 b3]
+static inline void interleave2(const __m128i &a, const __m128i &b, uint32_t *dst)
+{
+    store(dst, _mm_unpacklo_epi32(a, b));
+    store(dst + 4, _mm_unpackhi_epi32(a, b));
+}
+
+// write [a0 b0 c0 a1 b1 c1 a2 b2 c2 a3 b3 c3]
+static inline void interleave3(const __m128i &a, const __m128i &b, const __m128i &c, uint32_t *dst)
+{
+    __m128 ab_lo = _mm_castsi128_ps(_mm_unpacklo_epi32(a, b));
+    __m128 ca_lo = _mm_castsi128_ps(_mm_unpacklo_epi32(c, a));
+    __m128 bc_lo = _mm_castsi128_ps(_mm_unpacklo_epi32(b, c));
+    __m128 ab_hi = _mm_castsi128_ps(_mm_unpackhi_epi32(a, b));
+    __m128 ca_hi = _mm_castsi128_ps(_mm_unpackhi_epi32(c, a));
+    __m128 bc_hi = _mm_castsi128_ps(_mm_unpackhi_epi32(b, c));
+
+    store(dst, _mm_castps_si128(_mm_shuffle_ps(ab_lo, ca_lo, _MM_SHUFFLE(3, 0, 1, 0))));
+    store(dst + 4, _mm_castps_si128(_mm_shuffle_ps(bc_lo, ab_hi, _MM_SHUFFLE(1, 0, 3, 2))));
+    store(dst + 8, _mm_castps_si128(_mm_shuffle_ps(ca_hi, bc_hi, _MM_SHUFFLE(3, 2, 3, 0))));
+}
+
+static inline __m128i load(const uint32_t *src)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+}
+
+static void nearest_row(const uint32_t *in, const int &factor, uint32_t *out)
+{
+    for (int x = 0; x < width; x += 4)
+    {
+        __m128i v = load(in + x);
+        switch (factor)
+        {
+        case 2:
+            interleave2(v, v, out + x * 2);
+            break;
+        case 3:
+            interleave3(v, v, v, out + x * 3);
+            break;
+        case 4:
+            store(out + x * 4, _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 0, 0, 0)));
+            store(out + x * 4 + 4, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 1, 1, 1)));
+            store(out + x * 4 + 8, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 2, 2, 2)));
+            store(out + x * 4 + 12, _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3)));
+            break;
+        default:
+            store(out + x, v);
+            break;
+        }
+    }
+}
+
+// darken to 3/4 brightness where mask is set, keeping alpha opaque
+static void grid_row(uint32_t *row, const uint32_t *mask, const int &n)
+{
+    const __m128i low6 = _mm_set1_epi8(0x3F);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+    for (int x = 0; x < n; x += 4)
+    {
+        __m128i v = load(row + x);
+        __m128i dark = _mm_sub_epi8(v, _mm_and_si128(_mm_srli_epi16(v, 2), low6));
+        dark = _mm_or_si128(dark, alpha);
+        store(row + x, select(load(mask + x), dark, v));
+    }
+}
+
+static void scale2x_row(const uint32_t *up, const uint32_t *cur, const uint32_t *down, uint32_t *out0, uint32_t *out1)
+{
+    for (int x = 0; x < width; x += 4)
+    {
+        __m128i b = load(up + x + 1);
+        __m128i d = load(cur + x);
+        __m128i e = load(cur + x + 1);
+        __m128i f = load(cur + x + 2);
+        __m128i h = load(down + x + 1);
+
+        __m128i db = _mm_cmpeq_epi32(d, b);
+        __m128i bf = _mm_cmpeq_epi32(b, f);
+        __m128i dh = _mm_cmpeq_epi32(d, h);
+        __m128i hf = _mm_cmpeq_epi32(h, f);
+
+        __m128i e0 = select(_mm_andnot_si128(_mm_or_si128(bf, dh), db), d, e);
+        __m128i e1 = select(_mm_andnot_si128(_mm_or_si128(db, hf), bf), f, e);
+        __m128i e2 = select(_mm_andnot_si128(_mm_or_si128(db, hf), dh), d, e);
+        __m128i e3 = select(_mm_andnot_si128(_mm_or_si128(dh, bf), hf), f, e);
+
+        interleave2(e0, e1, out0 + x * 2);
+        interleave2(e2, e3, out1 + x * 2);
+    }
+}
+
+static void scale3x_row(const uint32_t *up, const uint32_t *cur, const uint32_t *down, uint32_t *out0, uint32_t *out1, uint32_t *out2)
+{
+    for (int x = 0; x < width; x += 4)
+    {
+        __m128i a = load(up + x);
+        __m128i b = load(up + x + 1);
+        __m128i c = load(up + x + 2);
+        __m128i d = load(cur + x);
+        __m128i e = load(cur + x + 1);
+        __m128i f = load(cur + x + 2);
+        __m128i g = load(down + x);
+        __m128i h = load(down + x + 1);
+        __m128i i = load(down + x + 2);
+
+        __m128i db = _mm_cmpeq_epi32(d, b);
+        __m128i bf = _mm_cmpeq_epi32(b, f);
+        __m128i dh = _mm_cmpeq_epi32(d, h);
+        __m128i hf = _mm_cmpeq_epi32(h, f);
+
+        // corner conditions, as in scale2x
+        __m128i k0 = _mm_andnot_si128(_mm_or_si128(bf, dh), db);
+        __m128i k2 = _mm_andnot_si128(_mm_or_si128(db, hf), bf);
+        __m128i k6 = _mm_andnot_si128(_mm_or_si128(db, hf), dh);
+        __m128i k8 = _mm_andnot_si128(_mm_or_si128(dh, bf), hf);
+
+        __m128i ea = _mm_cmpeq_epi32(e, a);
+        __m128i ec = _mm_cmpeq_epi32(e, c);
+        __m128i eg = _mm_cmpeq_epi32(e, g);
+        __m128i ei = _mm_cmpeq_epi32(e, i);
+
+        __m128i e1 = select(_mm_or_si128(_mm_andnot_si128(ec, k0), _mm_andnot_si128(ea, k2)), b, e);
+        __m128i e3 = select(_mm_or_si128(_mm_andnot_si128(eg, k0), _mm_andnot_si128(ea, k6)), d, e);
+        __m128i e5 = select(_mm_or_si128(_mm_andnot_si128(ei, k2), _mm_andnot_si128(ec, k8)), f, e);
+        __m128i e7 = select(_mm_or_si128(_mm_andnot_si128(ei, k6), _mm_andnot_si128(eg, k8)), h, e);
+
+        interleave3(select(k0, d, e), e1, select(k2, f, e), out0 + x * 3);
+        interleave3(e3, e, e5, out1 + x * 3);
+        interleave3(select(k6, d, e), e7, select(k8, f, e), out2 + x * 3);
+    }
+}
+
+#else
+
+static void nearest_row(const uint32_t *in, const int &factor, uint32_t *out)
+{
+    for (int x = 0; x < width; x++)
+    {
+        for (int i = 0; i < factor; i++)
+        {
+            out[x * factor + i] = in[x];
+        }
+    }
+}
+
+static void grid_row(uint32_t *row, const uint32_t *mask, const int &n)
+{
+    for (int x = 0; x < n; x++)
+    {
+        uint32_t dark = (row[x] - ((row[x] >> 2) & 0x3F3F3F3F)) | 0xFF000000;
+        row[x] = (mask[x] & dark) | (~mask[x] & row[x]);
+    }
+}
+
+static void scale2x_row(const uint32_t *up, const uint32_t *cur, const uint32_t *down, uint32_t *out0, uint32_t *out1)
+{
+    for (int x = 0; x < width; x++)
+    {
+        uint32_t b = up[x + 1], d = cur[x], e = cur[x + 1], f = cur[x + 2], h = down[x + 1];
+        out0[x * 2] = (d == b && b != f && d != h) ? d : e;
+        out0[x * 2 + 1] = (b == f && b != d && f != h) ? f : e;
+        out1[x * 2] = (d == h && d != b && h != f) ? d : e;
+        out1[x * 2 + 1] = (h == f && d != h && b != f) ? f : e;
+    }
+}
+
+static void scale3x_row(const uint32_t *up, const uint32_t *cur, const uint32_t *down, uint32_t *out0, uint32_t *out1, uint32_t *out2)
+{
+    for (int x = 0; x < width; x++)
+    {
+        uint32_t a = up[x], b = up[x + 1], c = up[x + 2];
+        uint32_t d = cur[x], e = cur[x + 1], f = cur[x + 2];
+        uint32_t g = down[x], h = down[x + 1], i = down[x + 2];
+
+        bool k0 = d == b && b != f && d != h;
+        bool k2 = b == f && b != d && f != h;
+        bool k6 = d == h && d != b && h != f;
+        bool k8 = h == f && d != h && b != f;
+
+        out0[x * 3] = k0 ? d : e;
+        out0[x * 3 + 1] = ((k0 && e != c) || (k2 && e != a)) ? b : e;
+        out0[x * 3 + 2] = k2 ? f : e;
+        out1[x * 3] = ((k0 && e != g) || (k6 && e != a)) ? d : e;
+        out1[x * 3 + 1] = e;
+        out1[x * 3 + 2] = ((k2 && e != i) || (k8 && e != c)) ? f : e;
+        out2[x * 3] = k6 ? d : e;
+        out2[x * 3 + 1] = ((k6 && e != i) || (k8 && e != g)) ? h : e;
+        out2[x * 3 + 2] = k8 ? f : e;
+    }
+}
+
+#endif
+
+int filter_factor(const Filter &filter, const int &factor)
+{
+    switch (filter)
+    {
+    case Filter::SCALE2X:
+        return 2;
+    case Filter::SCALE3X:
+        return 3;
+    case Filter::LCD_GRID:
+        return std::clamp(factor, 2, ScaledFrame::max_factor);
+    default:
+        return std::clamp(factor, 1, ScaledFrame::max_factor);
+    }
+}
+
+void scale(const Filter &filter, const int &factor, const uint8_t *src, uint32_t *dst, const std::bitset<PPU::height> &lines)
+{
+    const int out_width = width * factor;
+    uint32_t rows[3][width + 2];
+
+    // columns on the right edge of each cell, for the lcd grid
+    uint32_t column_mask[width * ScaledFrame::max_factor];
+    if (filter == Filter::LCD_GRID)
+    {
+        for (int x = 0; x < out_width; x++)
+        {
+            column_mask[x] = (x % factor == factor - 1) ? 0xFFFFFFFF : 0;
+        }
+    }
+    uint32_t full_mask[width * ScaledFrame::max_factor];
+    std::fill(full_mask, full_mask + out_width, 0xFFFFFFFF);
+
+    for (int y = 0; y < PPU::height; y++)
+    {
+        if (!lines.test(y))
+        {
+            continue;
+        }
+
+        uint32_t *out = dst + y * factor * out_width;
+        switch (filter)
+        {
+        case Filter::SCALE2X:
+            load_row(src, y - 1, rows[0]);
+            load_row(src, y, rows[1]);
+            load_row(src, y + 1, rows[2]);
+            scale2x_row(rows[0], rows[1], rows[2], out, out + out_width);
+            break;
+        case Filter::SCALE3X:
+            load_row(src, y - 1, rows[0]);
+            load_row(src, y, rows[1]);
+            load_row(src, y + 1, rows[2]);
+            scale3x_row(rows[0], rows[1], rows[2], out, out + out_width, out + out_width * 2);
+            break;
+        case Filter::LCD_GRID:
+            load_row(src, y, rows[1]);
+            nearest_row(rows[1] + 1, factor, out);
+            for (int i = 1; i < factor; i++)
+            {
+                std::memcpy(out + i * out_width, out, out_width * 4);
+            }
+            for (int i = 0; i < factor - 1; i++)
+            {
+                grid_row(out + i * out_width, column_mask, out_width);
+            }
+            grid_row(out + (factor - 1) * out_width, full_mask, out_width);
+            break;
+        default:
+            load_row(src, y, rows[1]);
+            nearest_row(rows[1] + 1, factor, out);
+            for (int i = 1; i < factor; i++)
+            {
+                std::memcpy(out + i * out_width, out, out_width * 4);
+            }
+            break;
+        }
+    }
+}
+
+std::thread ScalerThread::thread;
+std::atomic<bool> ScalerThread::running{false};
+
+Filter ScalerThread::filter = Filter::NEAREST;
+int ScalerThread::factor = 1;
+
+TripleBuffer<ScaledFrame> ScalerThread::buffer;
+std::bitset<PPU::height> ScalerThread::stale[3];
+
+void ScalerThread::run()
+{
+    TripleBuffer<Frame> &input = EmulationThread::frames();
+
+    std::bitset<PPU::height> carried;
+    carried.set();
+    for (auto &s : stale) { s.set(); }
+
+    while (running.load(std::memory_order_relaxed))
+    {
+        // waiting on the emulator is not a duplicated frame, only presenting the same one again is
+        if (!input.ready())
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+            continue;
+        }
+        input.update();
+
+        const Frame &frame = input.read_buffer();
+        if (frame.format != video::PixelFormat::RGBA8888)
+        {
+            continue;
+        }
+
+        // edge interpolation reads the lines above and below
+        std::bitset<PPU::height> dirty = frame.dirty;
+        if (filter == Filter::SCALE2X || filter == Filter::SCALE3X)
+        {
+            dirty |= (frame.dirty << 1) | (frame.dirty >> 1);
+        }
+        for (auto &s : stale) { s |= dirty; }
+
+        int i = buffer.write_index();
+        ScaledFrame &out = buffer.write_buffer();
+        scale(filter, factor, frame.pixels, out.pixels, stale[i]);
+        stale[i].reset();
+
+        out.filter = filter;
+        out.factor = factor;
+        out.number = frame.number;
+        out.dirty = dirty | carried;
+        carried.reset();
+
+        if (buffer.publish())
+        {
+            carried = buffer.write_buffer().dirty;
+        }
+    }
+}
+
+void ScalerThread::start(const Filter &f, const int &n)
+{
+    stop();
+    filter = f;
+    factor = filter_factor(f, n);
+    running.store(true, std::memory_order_relaxed);
+    thread = std::thread(run);
+}
+
+void ScalerThread::stop()
+{
+    running.store(false, std::memory_order_relaxed);
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+}
+
+TripleBuffer<ScaledFrame> &ScalerThread::frames()
+{
+    return buffer;
+}
+
+} // namespace emulator::frontend
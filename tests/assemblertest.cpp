@@ -0,0 +1,213 @@
+#define CATCH_CONFIG_MAIN
+
+#include <cstdint>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "gameboy-emulator/assembler/assembler.hpp"
+#include "gameboy-emulator/core/cpu.hpp"
+#include "gameboy-emulator/core/gameboy.hpp"
+#include "gameboy-emulator/core/memory.hpp"
+
+using namespace emulator;
+using namespace emulator::assembler;
+
+// bytes assembled at 0100
+static std::vector<uint8_t> bytes(Assembler &a, const size_t &n)
+{
+    std::vector<uint8_t> image;
+    REQUIRE( a.build(image) );
+    return std::vector<uint8_t>(image.begin() + 0x0100, image.begin() + 0x0100 + n);
+}
+
+// load an image and run it until it halts with interrupts off
+static void run(const std::vector<uint8_t> &image)
+{
+    GameBoy::reset();
+    REQUIRE( Memory::load_rom(image) );
+    for (int i = 0; i < 100000 && !CPU::halted; i++)
+    {
+        GameBoy::step();
+    }
+    REQUIRE( CPU::halted );
+}
+
+TEST_CASE("Encodings", "[assembler]") {
+    Assembler a;
+    a.ld(R8::B, R8::C);
+    a.ld(R8::IND_HL, R8::A);
+    a.alu(Alu::XOR, R8::A);
+    a.alu(Alu::CP, static_cast<uint8_t>(0x90));
+    a.push(R16Stack::AF);
+    a.pop(R16Stack::BC);
+    a.ld(R16::SP, static_cast<uint16_t>(0xDFFF));
+    a.rot(Rot::SWAP, R8::A);
+    a.bit(7, R8::H);
+    a.set(0, R8::IND_HL);
+    a.ldh_a_n(0x44);
+    a.ld_a_hli();
+    a.halt();
+    a.rst(0x38);
+    REQUIRE( bytes(a, 21) == std::vector<uint8_t>{ 0x41, 0x77, 0xAF, 0xFE, 0x90, 0xF5, 0xC1, 0x31, 0xFF, 0xDF, 0xCB,
+                                                   0x37, 0xCB, 0x7C, 0xCB, 0xC6, 0xF0, 0x44, 0x2A, 0x76, 0xFF } );
+}
+
+TEST_CASE("Labels", "[assembler]") {
+    Assembler a;
+    Label top = a.mark();
+    Label end = a.label();
+    a.jr(Cond::NZ, top);
+    a.jp(end);
+    a.call(Cond::C, top);
+    a.bind(end);
+    a.jr(end);
+    REQUIRE( bytes(a, 10) == std::vector<uint8_t>{ 0x20, 0xFE, 0xC3, 0x08, 0x01, 0xDC, 0x00, 0x01, 0x18, 0xFE } );
+
+    std::vector<uint8_t> image;
+    Assembler unbound;
+    unbound.jp(unbound.label());
+    REQUIRE( !unbound.build(image) );
+
+    Assembler far;
+    Label back = far.mark();
+    far.org(0x0200);
+    far.jr(back);
+    REQUIRE( !far.build(image) );
+
+    Assembler header(4);
+    for (int i = 0; i < 0x50; i++)
+    {
+        header.nop();
+    }
+    REQUIRE( !header.build(image) );
+}
+
+TEST_CASE("Assembled programs", "[assembler]") {
+    // sum 1 to 10 into C000
+    {
+        Assembler a;
+        a.alu(Alu::XOR, R8::A);
+        a.ld(R8::B, static_cast<uint8_t>(10));
+        Label loop = a.mark();
+        a.alu(Alu::ADD, R8::B);
+        a.dec(R8::B);
+        a.jr(Cond::NZ, loop);
+        a.ld_mem_a(0xC000);
+        a.di();
+        a.halt();
+
+        std::vector<uint8_t> image;
+        REQUIRE( a.build(image) );
+        run(image);
+        REQUIRE( Memory::read_8b(0xC000) == 55 );
+    }
+
+    // the low nibble of F reads back as zero through the stack, and calls nest
+    {
+        Assembler a;
+        Label inner = a.label();
+        a.ld(R16::SP, static_cast<uint16_t>(0xE000));
+        a.ld(R16::BC, static_cast<uint16_t>(0x12FF));
+        a.push(R16Stack::BC);
+        a.pop(R16Stack::AF);
+        a.call(inner);
+        a.ld_mem_a(0xC001);
+        a.di();
+        a.halt();
+        a.bind(inner);
+        a.push(R16Stack::AF);
+        a.pop(R16Stack::DE);
+        a.ld(R8::A, R8::E);
+        a.ret();
+
+        std::vector<uint8_t> image;
+        REQUIRE( a.build(image) );
+        run(image);
+        REQUIRE( Memory::read_8b(0xC001) == 0xF0 );
+        REQUIRE( CPU::get_registers().sp == 0xE000 );
+    }
+}
+
+TEST_CASE("MBC1 bank switching", "[assembler]") {
+    // each of banks 1-7 holds a routine at 4000 returning its bank number times 3
+    Assembler a(8);
+    for (int bank = 1; bank < 8; bank++)
+    {
+        a.section(bank, 0x4000);
+        a.ld(R8::A, static_cast<uint8_t>(bank * 3));
+        a.ret();
+    }
+
+    // call each in turn, storing the results from C000, selecting bank 0 last
+    a.section(0, 0x0100);
+    Label main = a.label();
+    a.jp(main);
+    a.org(0x0150);
+    a.bind(main);
+    a.ld(R16::HL, static_cast<uint16_t>(0xC000));
+    a.ld(R8::B, static_cast<uint8_t>(1));
+    Label loop = a.mark();
+    a.ld(R8::A, R8::B);
+    a.ld_mem_a(0x2000);
+    a.call(a.at(0x4000));
+    a.ld_hli_a();
+    a.inc(R8::B);
+    a.ld(R8::A, R8::B);
+    a.alu(Alu::CP, static_cast<uint8_t>(8));
+    a.jr(Cond::NZ, loop);
+    a.alu(Alu::XOR, R8::A);
+    a.ld_mem_a(0x2000);
+    a.call(a.at(0x4000));
+    a.ld_hli_a();
+    a.di();
+    a.halt();
+
+    std::vector<uint8_t> image;
+    REQUIRE( a.build(image) );
+    REQUIRE( image.size() == 8 * 0x4000 );
+    REQUIRE( image[0x0147] == 0x01 );
+    REQUIRE( image[0x0148] == 0x02 );
+
+    run(image);
+    for (int bank = 1; bank < 8; bank++)
+    {
+        REQUIRE( Memory::read_8b(0xC000 + bank - 1) == bank * 3 );
+    }
+
+    // bank 0 selects bank 1, and writes to ROM never reach it
+    REQUIRE( Memory::read_8b(0xC007) == 3 );
+    REQUIRE( Memory::bank() == 1 );
+    REQUIRE( Memory::read_8b(0x2000) == 0xFF );
+}
+
+TEST_CASE("ROM only cartridge", "[assembler]") {
+    // write over the whole ROM area, the code being run included
+    Assembler a;
+    a.section(0, 0x0100);
+    Label main = a.label();
+    a.jp(main);
+    a.org(0x0150);
+    a.bind(main);
+    const std::vector<uint16_t> addresses = { 0x0000, 0x0150, 0x2000, 0x4000, 0x6000, 0x7FFF };
+    a.ld(R8::A, static_cast<uint8_t>(0x01));
+    for (uint16_t address : addresses)
+    {
+        a.ld_mem_a(address);
+    }
+    a.di();
+    a.halt();
+
+    std::vector<uint8_t> image;
+    REQUIRE( a.build(image) );
+    REQUIRE( image[0x0147] != 0x01 );
+
+    // no bank controller to take the writes, and none of them reach the ROM
+    run(image);
+    for (uint16_t address : addresses)
+    {
+        REQUIRE( Memory::read_8b(address) == image[address] );
+    }
+    REQUIRE( Memory::read_8b(0x0150) == 0x3E );
+    REQUIRE( Memory::bank() == 1 );
+}
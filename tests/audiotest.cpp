@@ -0,0 +1,292 @@
+#define CATCH_CONFIG_MAIN
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "gameboy-emulator/core/apu.hpp"
+#include "gameboy-emulator/core/cpu.hpp"
+#include "gameboy-emulator/core/gameboy.hpp"
+#include "gameboy-emulator/core/memory.hpp"
+#include "gameboy-emulator/core/resampler.hpp"
+#include "gameboy-emulator/core/ring_buffer.hpp"
+
+using namespace emulator;
+
+// advance the master clock, collecting the left channel every chunk cycles
+static std::vector<int16_t> render(const uint32_t &cycles, const uint32_t &chunk = 4096)
+{
+    std::vector<int16_t> left;
+    int16_t samples[4096];
+    for (uint32_t done = 0; done < cycles; done += chunk)
+    {
+        CPU::cycles += chunk;
+        APU::end_frame();
+        size_t n;
+        while ((n = APU::output().read(samples, 4096)) > 0)
+        {
+            for (size_t i = 0; i < n; i += 2)
+            {
+                left.push_back(samples[i]);
+            }
+        }
+    }
+    return left;
+}
+
+static int zero_crossings(const std::vector<int16_t> &samples)
+{
+    int n = 0;
+    for (size_t i = 1; i < samples.size(); i++)
+    {
+        n += (samples[i - 1] < 0) != (samples[i] < 0);
+    }
+    return n;
+}
+
+TEST_CASE("Ring buffer wrap-around", "[audio]") {
+    RingBuffer<int, 8> ring;
+    int in[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    int out[8] = {};
+
+    REQUIRE( ring.write(in, 5) == 5 );
+    REQUIRE( ring.read(out, 3) == 3 );
+    REQUIRE( out[2] == 2 );
+
+    // only the free space is written
+    REQUIRE( ring.write(in, 8) == 6 );
+    REQUIRE( ring.size() == 8 );
+    REQUIRE( ring.read(out, 8) == 8 );
+    REQUIRE( out[0] == 3 );
+    REQUIRE( out[1] == 4 );
+    REQUIRE( out[2] == 0 );
+    REQUIRE( out[7] == 5 );
+    REQUIRE( ring.read(out, 1) == 0 );
+}
+
+TEST_CASE("Ring buffer across threads", "[audio]") {
+    RingBuffer<uint32_t, 256> ring;
+    const uint32_t count = 1000000;
+
+    std::thread producer([&] {
+        uint32_t next = 0;
+        while (next < count)
+        {
+            uint32_t chunk[37];
+            for (uint32_t i = 0; i < 37; i++) { chunk[i] = next + i; }
+            const size_t written = ring.write(chunk, std::min<uint32_t>(37, count - next));
+            next += static_cast<uint32_t>(written);
+
+            // let the consumer run when the ring is full, as on a single CPU it can't otherwise
+            if (written == 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 0;
+    bool ordered = true;
+    while (expected < count)
+    {
+        uint32_t chunk[53];
+        size_t n = ring.read(chunk, 53);
+        for (size_t i = 0; i < n; i++)
+        {
+            ordered = ordered && chunk[i] == expected++;
+        }
+        if (n == 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+
+    REQUIRE( ordered );
+}
+
+TEST_CASE("Sound register reads", "[audio]") {
+    GameBoy::reset();
+
+    REQUIRE( Memory::read_8b(0xFF26) == 0xF1 );
+    REQUIRE( Memory::read_8b(0xFF11) == 0xBF );
+    REQUIRE( Memory::read_8b(0xFF13) == 0xFF ); // write-only
+
+    Memory::write_8b(0xFF30, 0x5A);
+    REQUIRE( Memory::read_8b(0xFF30) == 0x5A );
+
+    // powering off clears the registers and ignores writes to them
+    Memory::write_8b(0xFF26, 0x00);
+    REQUIRE( Memory::read_8b(0xFF26) == 0x70 );
+    REQUIRE( Memory::read_8b(0xFF24) == 0x00 );
+    Memory::write_8b(0xFF24, 0x77);
+    REQUIRE( Memory::read_8b(0xFF24) == 0x00 );
+
+    Memory::write_8b(0xFF26, 0x80);
+    Memory::write_8b(0xFF24, 0x77);
+    REQUIRE( Memory::read_8b(0xFF24) == 0x77 );
+}
+
+TEST_CASE("Pulse channel tone", "[audio]") {
+    GameBoy::reset();
+    render(65536);
+
+    Memory::write_8b(0xFF24, 0x77);
+    Memory::write_8b(0xFF25, 0x22); // channel 2 on both sides
+    Memory::write_8b(0xFF16, 0x80); // 50% duty
+    Memory::write_8b(0xFF17, 0xF0); // full volume, no envelope
+    Memory::write_8b(0xFF18, 0x00);
+    Memory::write_8b(0xFF19, 0x87); // trigger, period 1792: 4194304 / ((2048 - 1792) * 32) = 512 Hz
+    REQUIRE( (Memory::read_8b(0xFF26) & 0x02) != 0 );
+
+    std::vector<int16_t> samples = render(APU::clock_rate);
+    REQUIRE( samples.size() > APU::sample_rate * 99 / 100 );
+    REQUIRE( zero_crossings(samples) > 1024 * 95 / 100 );
+    REQUIRE( zero_crossings(samples) < 1024 * 105 / 100 );
+
+    // a length-enabled channel stops after its length runs out
+    Memory::write_8b(0xFF16, 0x80 | 0x3F); // 1 step left
+    Memory::write_8b(0xFF19, 0xC7);
+    render(65536);
+    REQUIRE( (Memory::read_8b(0xFF26) & 0x02) == 0 );
+}
+
+TEST_CASE("Silent apu", "[audio]") {
+    GameBoy::reset();
+    std::vector<int16_t> samples = render(APU::clock_rate / 4);
+
+    bool silent = true;
+    for (int16_t s : samples) { silent = silent && s == 0; }
+    REQUIRE( silent );
+}
+
+TEST_CASE("Catch-up granularity", "[audio]") {
+    // the same register writes give the same samples however rarely the apu catches up
+    std::vector<int16_t> runs[2];
+    const uint32_t chunks[2] = { 64, 70224 };
+    for (int i = 0; i < 2; i++)
+    {
+        GameBoy::reset();
+        Memory::write_8b(0xFF25, 0xFF);
+        Memory::write_8b(0xFF21, 0xA3); // noise, decaying envelope
+        Memory::write_8b(0xFF22, 0x21);
+        Memory::write_8b(0xFF23, 0x80);
+        runs[i] = render(70224 * 8, chunks[i]);
+    }
+
+    REQUIRE( runs[0].size() == runs[1].size() );
+    REQUIRE( runs[0] == runs[1] );
+}
+
+TEST_CASE("Wave RAM writes mid-note", "[audio]") {
+    // the same note twice, the second time silencing wave RAM part way through
+    std::vector<int16_t> runs[2];
+    const uint32_t elapsed = 8192; // 16 wave steps run before the write, not yet caught up
+    for (int i = 0; i < 2; i++)
+    {
+        GameBoy::reset();
+        Memory::write_8b(0xFF24, 0x77);
+        Memory::write_8b(0xFF25, 0x44); // channel 3 on both sides
+        for (uint16_t a = 0xFF30; a < 0xFF40; a++) { Memory::write_8b(a, 0xF0); }
+        Memory::write_8b(0xFF1A, 0x80); // DAC on
+        Memory::write_8b(0xFF1C, 0x20); // full level
+        Memory::write_8b(0xFF1D, 0x00);
+        Memory::write_8b(0xFF1E, 0x87); // trigger, period 1792: a wave step every 512 cycles
+        render(16384);
+
+        CPU::cycles += elapsed;
+        if (i == 1)
+        {
+            for (uint16_t a = 0xFF30; a < 0xFF40; a++) { Memory::write_8b(a, 0x00); }
+        }
+        runs[i] = render(16384);
+    }
+
+    // what played before the write is the same, less the width of the band-limited steps around it
+    const size_t before = elapsed / BlipBuffer::clocks_per_sample - 16;
+    REQUIRE( runs[0].size() > before );
+    REQUIRE( std::equal(runs[0].begin(), runs[0].begin() + before, runs[1].begin()) );
+    REQUIRE( runs[0] != runs[1] );
+}
+
+TEST_CASE("Disabled apu", "[audio]") {
+    GameBoy::reset();
+    APU::set_enabled(false);
+
+    Memory::write_8b(0xFF25, 0x22);
+    Memory::write_8b(0xFF17, 0xF0);
+    Memory::write_8b(0xFF19, 0x87);
+    REQUIRE( Memory::read_8b(0xFF25) == 0x22 );
+    REQUIRE( Memory::read_8b(0xFF19) == 0xBF );
+    REQUIRE( render(APU::clock_rate / 4).empty() );
+
+    APU::set_enabled(true);
+}
+
+// resample a stereo sine, the right channel inverted
+static std::vector<int16_t> resample_sine(Resampler &resampler, const double &frequency, const size_t &input_frames)
+{
+    std::vector<int16_t> input(input_frames * 2);
+    for (size_t i = 0; i < input_frames; i++)
+    {
+        int16_t s = static_cast<int16_t>(std::lround(10000.0 * std::sin(2.0 * 3.14159265358979323846 * frequency * i / APU::sample_rate)));
+        input[i * 2] = s;
+        input[i * 2 + 1] = -s;
+    }
+
+    std::vector<int16_t> output;
+    int16_t block[256 * 2];
+    size_t offset = 0;
+    while (offset < input_frames)
+    {
+        offset += resampler.write(&input[offset * 2], std::min<size_t>(1000, input_frames - offset));
+        size_t n;
+        while ((n = resampler.read(block, 256)) > 0)
+        {
+            output.insert(output.end(), block, block + n * 2);
+        }
+    }
+    return output;
+}
+
+TEST_CASE("Resampler tone", "[audio]") {
+    for (uint32_t rate : { 48000u, 44100u })
+    {
+        Resampler resampler(APU::sample_rate, rate);
+        std::vector<int16_t> output = resample_sine(resampler, 1000.0, APU::sample_rate);
+
+        REQUIRE( std::abs(static_cast<int>(output.size() / 2) - static_cast<int>(rate)) < 32 );
+
+        std::vector<int16_t> left;
+        int16_t peak = 0;
+        bool mirrored = true;
+        for (size_t i = 0; i < output.size(); i += 2)
+        {
+            left.push_back(output[i]);
+            peak = std::max(peak, output[i]);
+            mirrored = mirrored && std::abs(output[i] + output[i + 1]) <= 1;
+        }
+        REQUIRE( mirrored );
+        REQUIRE( std::abs(zero_crossings(left) - 2000) <= 4 );
+        REQUIRE( peak > 9800 );
+        REQUIRE( peak < 10200 );
+    }
+}
+
+TEST_CASE("Resampler rate control", "[audio]") {
+    Resampler slow(APU::sample_rate, 48000);
+    Resampler fast(APU::sample_rate, 48000);
+    slow.set_fill(0.0);
+    fast.set_fill(1.0);
+
+    // a full queue is drained faster: fewer output frames per input frame
+    size_t slow_frames = resample_sine(slow, 500.0, APU::sample_rate).size() / 2;
+    size_t fast_frames = resample_sine(fast, 500.0, APU::sample_rate).size() / 2;
+    REQUIRE( slow_frames > 48000 * 1.004 );
+    REQUIRE( fast_frames < 48000 * 0.996 );
+}
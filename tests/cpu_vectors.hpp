@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// packed CPU test vectors: tests/CPUTests/*.json converted by packvectors, memory-mapped by vectortest
+//
+// layout, all little endian:
+//   "GBTV", u16 version, u16 number of files
+//   per file: u16 opcode (0x100 + second byte for CB), u16 reserved, u32 number of vectors, u32 offset of the first
+//   per vector: u8 instruction bytes[3], state initial, state final, u8 number of cycles, cycles
+//   state: u8 a, b, c, d, e, f, h, l, u16 pc, sp, u8 number of ram entries, per entry u16 address, u8 value
+//   cycle: u16 address, u8 value, u8 kind
+
+namespace vectors
+{
+
+static constexpr uint16_t version = 1;
+static constexpr size_t header_size = 8;
+static constexpr size_t index_size = 12;
+
+// what the bus did in one M-cycle of a vector
+enum Kind : uint8_t
+{
+    IDLE = 0,
+    READ = 1,
+    WRITE = 2
+};
+
+struct State
+{
+    uint8_t a, b, c, d, e, f, h, l;
+    uint16_t pc, sp;
+    uint8_t ram_entries;
+    const uint8_t *ram; // ram_entries of u16 address, u8 value
+};
+
+struct Vector
+{
+    const uint8_t *bytes;
+    State initial;
+    State final;
+    uint8_t cycle_entries;
+    const uint8_t *cycles; // cycle_entries of u16 address, u8 value, u8 kind
+};
+
+inline uint16_t read_16(const uint8_t *p)
+{
+    return static_cast<uint16_t>(p[0] | p[1] << 8);
+}
+
+inline uint32_t read_32(const uint8_t *p)
+{
+    return static_cast<uint32_t>(p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline const uint8_t *read_state(const uint8_t *p, State &s)
+{
+    s.a = p[0]; s.b = p[1]; s.c = p[2]; s.d = p[3];
+    s.e = p[4]; s.f = p[5]; s.h = p[6]; s.l = p[7];
+    s.pc = read_16(p + 8);
+    s.sp = read_16(p + 10);
+    s.ram_entries = p[12];
+    s.ram = p + 13;
+    return s.ram + s.ram_entries * 3;
+}
+
+/**@brief Decode the vector at p.
+ *
+ *@return Start of the next vector
+ */
+inline const uint8_t *read_vector(const uint8_t *p, Vector &v)
+{
+    v.bytes = p;
+    p = read_state(p + 3, v.initial);
+    p = read_state(p, v.final);
+    v.cycle_entries = p[0];
+    v.cycles = p + 1;
+    return v.cycles + v.cycle_entries * 4;
+}
+
+/**@brief A packed vector file mapped read-only into memory.
+ */
+class File
+{
+private:
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+
+public:
+    File() = default;
+    File(const File &) = delete;
+    File &operator=(const File &) = delete;
+
+    ~File()
+    {
+        if (data != nullptr)
+        {
+            munmap(const_cast<uint8_t *>(data), size);
+        }
+    }
+
+    /**@brief Map a packed vector file, checking its header.
+     *
+     *@param path Path of the file written by packvectors
+     *@return False if the file could not be mapped or is not a packed vector file
+     */
+    bool open(const std::string &path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < header_size)
+        {
+            close(fd);
+            return false;
+        }
+
+        void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED)
+        {
+            return false;
+        }
+        data = static_cast<const uint8_t *>(mapped);
+        size = st.st_size;
+
+        return std::memcmp(data, "GBTV", 4) == 0 && read_16(data + 4) == version &&
+               header_size + files() * index_size <= size;
+    }
+
+    /**@brief Number of opcode files packed.
+     */
+    size_t files() const
+    {
+        return read_16(data + 6);
+    }
+
+    /**@brief Opcode of a packed file, 0x100 plus the second byte for CB-prefixed ones.
+     */
+    uint16_t opcode(const size_t &i) const
+    {
+        return read_16(data + header_size + i * index_size);
+    }
+
+    /**@brief Number of vectors in a packed file.
+     */
+    uint32_t count(const size_t &i) const
+    {
+        return read_32(data + header_size + i * index_size + 4);
+    }
+
+    /**@brief First vector of a packed file, to be walked with read_vector.
+     */
+    const uint8_t *first(const size_t &i) const
+    {
+        return data + read_32(data + header_size + i * index_size + 8);
+    }
+};
+
+} // namespace vectors
@@ -0,0 +1,196 @@
+#define CATCH_CONFIG_MAIN
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "gameboy-emulator/frontend/scaler.hpp"
+#include "gameboy-emulator/frontend/triple_buffer.hpp"
+
+using namespace emulator;
+using namespace emulator::frontend;
+
+TEST_CASE("Triple buffer hand-over", "[frontend]") {
+    TripleBuffer<int> buffer;
+
+    REQUIRE( !buffer.ready() );
+    REQUIRE( !buffer.update() );
+    REQUIRE( buffer.duplicated() == 1 );
+
+    buffer.write_buffer() = 1;
+    REQUIRE( !buffer.publish() );
+    REQUIRE( buffer.ready() );
+    REQUIRE( buffer.update() );
+    REQUIRE( !buffer.ready() );
+    REQUIRE( buffer.read_buffer() == 1 );
+
+    // the consumer only ever sees the newest buffer
+    buffer.write_buffer() = 2;
+    REQUIRE( !buffer.publish() );
+    buffer.write_buffer() = 3;
+    REQUIRE( buffer.publish() );
+    REQUIRE( buffer.write_buffer() == 2 ); // dropped buffer comes back to the producer
+    REQUIRE( buffer.update() );
+    REQUIRE( buffer.read_buffer() == 3 );
+    REQUIRE( !buffer.update() );
+
+    REQUIRE( buffer.frames() == 3 );
+    REQUIRE( buffer.dropped() == 1 );
+    REQUIRE( buffer.duplicated() == 2 );
+}
+
+TEST_CASE("Triple buffer across threads", "[frontend]") {
+    struct Item { uint64_t a; uint64_t b; };
+    TripleBuffer<Item> buffer;
+    std::atomic<bool> done{false};
+    const uint64_t count = 200000;
+
+    std::thread producer([&] {
+        for (uint64_t i = 1; i <= count; i++)
+        {
+            buffer.write_buffer() = { i, ~i };
+            buffer.publish();
+        }
+        done.store(true);
+    });
+
+    uint64_t last = 0;
+    bool torn = false, backwards = false;
+    for (;;)
+    {
+        bool finished = done.load();
+        if (buffer.update())
+        {
+            const Item &item = buffer.read_buffer();
+            torn = torn || item.b != ~item.a;
+            backwards = backwards || item.a <= last;
+            last = item.a;
+        }
+        else if (finished)
+        {
+            break;
+        }
+    }
+    producer.join();
+
+    REQUIRE( !torn );
+    REQUIRE( !backwards );
+    REQUIRE( last == count );
+    REQUIRE( buffer.frames() == count );
+}
+
+static uint32_t image[PPU::height][PPU::width];
+
+uint32_t pixel(int x, int y)
+{
+    return image[std::clamp(y, 0, PPU::height - 1)][std::clamp(x, 0, PPU::width - 1)];
+}
+
+void make_image()
+{
+    // few distinct colours so the edge rules of scale2x/scale3x trigger often
+    const uint32_t colours[3] = { 0xFFFFFFFF, 0xFF555555, 0xFF000000 };
+    uint32_t seed = 7;
+    for (int y = 0; y < PPU::height; y++)
+    {
+        for (int x = 0; x < PPU::width; x++)
+        {
+            seed = seed * 1103515245 + 12345;
+            image[y][x] = colours[(seed >> 16) % 3];
+        }
+    }
+}
+
+std::vector<uint32_t> run_scale(const Filter &filter, const int &factor)
+{
+    std::vector<uint32_t> out(PPU::height * factor * PPU::width * factor, 0);
+    std::bitset<PPU::height> lines;
+    lines.set();
+    scale(filter, factor, reinterpret_cast<const uint8_t *>(image), out.data(), lines);
+    return out;
+}
+
+TEST_CASE("Nearest and LCD grid scaling", "[frontend]") {
+    make_image();
+    for (int k = 1; k <= 4; k++)
+    {
+        std::vector<uint32_t> out = run_scale(Filter::NEAREST, k);
+        bool pass = true;
+        for (int y = 0; y < PPU::height * k; y++)
+        {
+            for (int x = 0; x < PPU::width * k; x++)
+            {
+                pass = pass && out[y * PPU::width * k + x] == image[y / k][x / k];
+            }
+        }
+        REQUIRE( pass );
+    }
+
+    for (int k = 2; k <= 4; k++)
+    {
+        std::vector<uint32_t> out = run_scale(Filter::LCD_GRID, k);
+        bool pass = true;
+        for (int y = 0; y < PPU::height * k; y++)
+        {
+            for (int x = 0; x < PPU::width * k; x++)
+            {
+                uint32_t p = image[y / k][x / k];
+                bool border = (y % k == k - 1) || (x % k == k - 1);
+                uint32_t expected = border ? ((p - ((p >> 2) & 0x3F3F3F3F)) | 0xFF000000) : p;
+                pass = pass && out[y * PPU::width * k + x] == expected;
+            }
+        }
+        REQUIRE( pass );
+    }
+    REQUIRE( filter_factor(Filter::LCD_GRID, 1) == 2 );
+}
+
+TEST_CASE("Scale2x and Scale3x", "[frontend]") {
+    make_image();
+
+    std::vector<uint32_t> out2 = run_scale(Filter::SCALE2X, 2);
+    std::vector<uint32_t> out3 = run_scale(Filter::SCALE3X, 3);
+    bool pass2 = true, pass3 = true;
+    for (int y = 0; y < PPU::height; y++)
+    {
+        for (int x = 0; x < PPU::width; x++)
+        {
+            uint32_t a = pixel(x - 1, y - 1), b = pixel(x, y - 1), c = pixel(x + 1, y - 1);
+            uint32_t d = pixel(x - 1, y), e = pixel(x, y), f = pixel(x + 1, y);
+            uint32_t g = pixel(x - 1, y + 1), h = pixel(x, y + 1), i = pixel(x + 1, y + 1);
+
+            uint32_t e2[4] = {
+                (d == b && b != f && d != h) ? d : e,
+                (b == f && b != d && f != h) ? f : e,
+                (d == h && d != b && h != f) ? d : e,
+                (h == f && d != h && b != f) ? f : e
+            };
+            const int w2 = PPU::width * 2;
+            pass2 = pass2 && out2[(y * 2) * w2 + x * 2] == e2[0] && out2[(y * 2) * w2 + x * 2 + 1] == e2[1];
+            pass2 = pass2 && out2[(y * 2 + 1) * w2 + x * 2] == e2[2] && out2[(y * 2 + 1) * w2 + x * 2 + 1] == e2[3];
+
+            uint32_t e3[9] = {
+                (d == b && b != f && d != h) ? d : e,
+                ((d == b && b != f && d != h && e != c) || (b == f && b != d && f != h && e != a)) ? b : e,
+                (b == f && b != d && f != h) ? f : e,
+                ((d == b && b != f && d != h && e != g) || (d == h && d != b && h != f && e != a)) ? d : e,
+                e,
+                ((b == f && b != d && f != h && e != i) || (h == f && d != h && b != f && e != c)) ? f : e,
+                (d == h && d != b && h != f) ? d : e,
+                ((d == h && d != b && h != f && e != i) || (h == f && d != h && b != f && e != g)) ? h : e,
+                (h == f && d != h && b != f) ? f : e
+            };
+            const int w3 = PPU::width * 3;
+            for (int j = 0; j < 9; j++)
+            {
+                pass3 = pass3 && out3[(y * 3 + j / 3) * w3 + x * 3 + j % 3] == e3[j];
+            }
+        }
+    }
+    REQUIRE( pass2 );
+    REQUIRE( pass3 );
+}
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "cpu_vectors.hpp"
+
+using json = nlohmann::json;
+
+static void put_16(std::vector<uint8_t> &out, const uint16_t &v)
+{
+    out.push_back(static_cast<uint8_t>(v));
+    out.push_back(static_cast<uint8_t>(v >> 8));
+}
+
+static void put_32(std::vector<uint8_t> &out, const uint32_t &v)
+{
+    put_16(out, static_cast<uint16_t>(v));
+    put_16(out, static_cast<uint16_t>(v >> 16));
+}
+
+static void put_state(std::vector<uint8_t> &out, json &state)
+{
+    for (const char *r : { "a", "b", "c", "d", "e", "f", "h", "l" })
+    {
+        out.push_back(state[r].get<uint8_t>());
+    }
+    put_16(out, state["pc"].get<uint16_t>());
+    put_16(out, state["sp"].get<uint16_t>());
+
+    out.push_back(static_cast<uint8_t>(state["ram"].size()));
+    for (json &entry : state["ram"])
+    {
+        put_16(out, entry[0].get<uint16_t>());
+        out.push_back(entry[1].get<uint8_t>());
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        std::cout << "usage: " << argv[0] << " <json directory> <output file>" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::filesystem::path> paths;
+    for (const auto &entry : std::filesystem::directory_iterator(argv[1]))
+    {
+        if (entry.path().extension() == ".json")
+        {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<uint8_t> index;
+    std::vector<uint8_t> body;
+    const size_t start = vectors::header_size + paths.size() * vectors::index_size;
+    for (const std::filesystem::path &path : paths)
+    {
+        std::ifstream f(path);
+        json data = json::parse(f);
+        uint16_t opcode = 0;
+        const uint32_t offset = static_cast<uint32_t>(start + body.size());
+
+        for (json &vector : data)
+        {
+            // instruction bytes as named, e.g. "cb 11 22"
+            std::string name = vector["name"];
+            name.erase(std::remove(name.begin(), name.end(), ' '), name.end());
+            uint32_t bytes = std::stoul(name, nullptr, 16);
+            body.push_back(static_cast<uint8_t>(bytes >> 16));
+            body.push_back(static_cast<uint8_t>(bytes >> 8));
+            body.push_back(static_cast<uint8_t>(bytes));
+            opcode = (bytes >> 16 == 0xCB) ? 0x100 | ((bytes >> 8) & 0xFF) : bytes >> 16;
+
+            put_state(body, vector["initial"]);
+            put_state(body, vector["final"]);
+
+            body.push_back(static_cast<uint8_t>(vector["cycles"].size()));
+            for (json &cycle : vector["cycles"])
+            {
+                if (cycle.is_null())
+                {
+                    put_16(body, 0);
+                    body.push_back(0);
+                    body.push_back(vectors::IDLE);
+                    continue;
+                }
+                put_16(body, cycle[0].get<uint16_t>());
+                body.push_back(cycle[1].get<uint8_t>());
+                body.push_back(cycle[2] == "write" ? vectors::WRITE : vectors::READ);
+            }
+        }
+
+        put_16(index, opcode);
+        put_16(index, 0);
+        put_32(index, static_cast<uint32_t>(data.size()));
+        put_32(index, offset);
+    }
+
+    std::vector<uint8_t> out = { 'G', 'B', 'T', 'V' };
+    put_16(out, vectors::version);
+    put_16(out, static_cast<uint16_t>(paths.size()));
+    out.insert(out.end(), index.begin(), index.end());
+    out.insert(out.end(), body.begin(), body.end());
+
+    std::ofstream file(argv[2], std::ios::binary);
+    file.write(reinterpret_cast<const char *>(out.data()), out.size());
+    if (!file)
+    {
+        std::cout << "could not write " << argv[2] << std::endl;
+        return 1;
+    }
+    std::cout << "packed " << paths.size() << " files into " << out.size() << " bytes" << std::endl;
+    return 0;
+}
@@ -0,0 +1,934 @@
+#define CATCH_CONFIG_MAIN
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <initializer_list>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "gameboy-emulator/assembler/assembler.hpp"
+#include "gameboy-emulator/core/coverage.hpp"
+#include "gameboy-emulator/core/cpu.hpp"
+#include "gameboy-emulator/core/debugger.hpp"
+#include "gameboy-emulator/core/gameboy.hpp"
+#include "gameboy-emulator/core/guest_profiler.hpp"
+#include "gameboy-emulator/core/idle_loop.hpp"
+#include "gameboy-emulator/core/memory.hpp"
+#include "gameboy-emulator/core/opcode_profiler.hpp"
+#include "gameboy-emulator/core/pair_profiler.hpp"
+#include "gameboy-emulator/core/scheduler.hpp"
+#include "gameboy-emulator/core/tracer.hpp"
+
+using namespace emulator;
+using namespace emulator::assembler;
+
+// place code at the entry point, where CPU::reset leaves pc; straight into memory, as the bus drops writes to cartridge ROM
+static void load(const std::initializer_list<uint8_t> &code)
+{
+    uint16_t address = 0x0100;
+    for (uint8_t b : code)
+    {
+        Memory::write(b, address++);
+    }
+}
+
+// move the master clock forward as instructions would, running due events
+static void advance(const uint64_t &cycles)
+{
+    for (uint64_t i = 0; i < cycles; i += 4)
+    {
+        CPU::cycles += 4;
+        if (CPU::cycles >= Scheduler::deadline())
+        {
+            Scheduler::dispatch(CPU::cycles);
+        }
+    }
+}
+
+TEST_CASE("DIV", "[system]") {
+    GameBoy::reset();
+    REQUIRE( Memory::read_8b(0xFF04) == 0xAB );
+
+    advance(0x34);
+    REQUIRE( Memory::read_8b(0xFF04) == 0xAC );
+    advance(256 * 0x54 - 4);
+    REQUIRE( Memory::read_8b(0xFF04) == 0xFF );
+    advance(4);
+    REQUIRE( Memory::read_8b(0xFF04) == 0x00 );
+
+    // any write clears the whole counter
+    advance(100);
+    Memory::write_8b(0xFF04, 0x5A);
+    REQUIRE( Memory::read_8b(0xFF04) == 0x00 );
+    advance(252);
+    REQUIRE( Memory::read_8b(0xFF04) == 0x00 );
+    advance(4);
+    REQUIRE( Memory::read_8b(0xFF04) == 0x01 );
+}
+
+TEST_CASE("TIMA overflow", "[system]") {
+    GameBoy::reset();
+    Memory::write_8b(0xFF0F, 0x00);
+    Memory::write_8b(0xFF04, 0x00);
+    Memory::write_8b(0xFF06, 0xF0);
+    Memory::write_8b(0xFF05, 0xFE);
+    Memory::write_8b(0xFF07, 0x05); // enabled, every 16 cycles
+    REQUIRE( Memory::read_8b(0xFF07) == 0xFD );
+
+    advance(16);
+    REQUIRE( Memory::read_8b(0xFF05) == 0xFF );
+
+    // TIMA reads 0 for 4 cycles after overflowing, then is reloaded from TMA
+    advance(16);
+    REQUIRE( Memory::read_8b(0xFF05) == 0x00 );
+    REQUIRE( (Memory::read_8b(0xFF0F) & 0x04) == 0 );
+    REQUIRE( Scheduler::deadline() == CPU::cycles + 4 );
+    advance(4);
+    REQUIRE( Memory::read_8b(0xFF05) == 0xF0 );
+    REQUIRE( (Memory::read_8b(0xFF0F) & 0x04) != 0 );
+
+    // the next overflow is 16 increments later
+    Memory::write_8b(0xFF0F, 0x00);
+    advance(16 * 16 - 4);
+    REQUIRE( (Memory::read_8b(0xFF0F) & 0x04) == 0 );
+    advance(4);
+    REQUIRE( (Memory::read_8b(0xFF0F) & 0x04) != 0 );
+    REQUIRE( Memory::read_8b(0xFF05) == 0xF0 );
+
+    // stopping the timer cancels the event
+    Memory::write_8b(0xFF07, 0x01);
+    REQUIRE( Scheduler::deadline() == Scheduler::never );
+    uint8_t tima = Memory::read_8b(0xFF05);
+    advance(1024);
+    REQUIRE( Memory::read_8b(0xFF05) == tima );
+}
+
+TEST_CASE("Timer glitches", "[system]") {
+    GameBoy::reset();
+    Memory::write_8b(0xFF04, 0x00);
+    Memory::write_8b(0xFF05, 0x10);
+    Memory::write_8b(0xFF07, 0x04); // enabled, every 1024 cycles, counter bit 9
+
+    // resetting DIV while bit 9 is set is a falling edge
+    advance(512);
+    REQUIRE( Memory::read_8b(0xFF05) == 0x10 );
+    Memory::write_8b(0xFF04, 0x00);
+    REQUIRE( Memory::read_8b(0xFF05) == 0x11 );
+
+    // while it is clear nothing happens
+    advance(256);
+    Memory::write_8b(0xFF04, 0x00);
+    REQUIRE( Memory::read_8b(0xFF05) == 0x11 );
+
+    // disabling the timer while the selected bit is set is a falling edge too
+    advance(512);
+    Memory::write_8b(0xFF07, 0x00);
+    REQUIRE( Memory::read_8b(0xFF05) == 0x12 );
+
+    // so is switching to a clock whose bit is clear
+    Memory::write_8b(0xFF04, 0x00);
+    advance(8);
+    Memory::write_8b(0xFF07, 0x05); // bit 3 set
+    Memory::write_8b(0xFF07, 0x06); // bit 5 clear
+    REQUIRE( Memory::read_8b(0xFF05) == 0x13 );
+}
+
+TEST_CASE("Interrupt dispatch", "[system]") {
+    GameBoy::reset();
+    load({ 0xFB, 0x00, 0x00, 0x00 }); // EI, NOP, NOP, NOP
+    Memory::write_8b(0xFFFF, 0x04);
+    Memory::write_8b(0xFF0F, 0x04);
+
+    // IME is only set once the instruction after EI has run
+    GameBoy::step();
+    REQUIRE( CPU::get_pc() == 0x0102 );
+    uint64_t start = CPU::cycles;
+    GameBoy::step();
+    REQUIRE( CPU::get_pc() == 0x0051 ); // one past the opcode at the timer vector
+    REQUIRE( CPU::cycles - start == 4 + 20 );
+    REQUIRE( CPU::get_sp() == 0xFFFC );
+    REQUIRE( Memory::read_8b(0xFFFC) == 0x02 ); // returns to the second NOP
+    REQUIRE( Memory::read_8b(0xFFFD) == 0x01 );
+    REQUIRE( Memory::read_8b(0xFF0F) == 0xE0 );
+}
+
+TEST_CASE("Interrupt priority", "[system]") {
+    GameBoy::reset();
+    load({ 0xFB, 0x00, 0x00, 0x00 });
+    Memory::write_8b(0xFFFF, 0x1F);
+    Memory::write_8b(0xFF0F, 0x14); // timer and joypad
+
+    GameBoy::step();
+    GameBoy::step();
+    REQUIRE( CPU::get_pc() == 0x0051 );
+    REQUIRE( Memory::read_8b(0xFF0F) == 0xF0 );
+
+    // IME is clear inside the handler, RETI sets it right away
+    Memory::write(static_cast<uint8_t>(0xD9), 0x0050); // RETI
+    GameBoy::step();
+    REQUIRE( CPU::get_pc() == 0x0061 );
+    REQUIRE( Memory::read_8b(0xFF0F) == 0xE0 );
+}
+
+TEST_CASE("DI after EI", "[system]") {
+    GameBoy::reset();
+    load({ 0xFB, 0xF3, 0x00, 0x00 }); // EI, DI, NOP, NOP
+    Memory::write_8b(0xFFFF, 0x01);
+    Memory::write_8b(0xFF0F, 0x01);
+
+    GameBoy::step();
+    GameBoy::step();
+    GameBoy::step();
+    REQUIRE( CPU::get_pc() == 0x0104 );
+    REQUIRE( Memory::read_8b(0xFF0F) == 0xE1 );
+}
+
+TEST_CASE("HALT wake-up", "[system]") {
+    GameBoy::reset();
+    load({ 0x76, 0x00, 0x00 }); // HALT, NOP, NOP
+    Memory::write_8b(0xFFFF, 0x04);
+    Memory::write_8b(0xFF0F, 0x00);
+    Memory::write_8b(0xFF05, 0xFF);
+    Memory::write_8b(0xFF07, 0x05);
+
+    GameBoy::step();
+    REQUIRE( CPU::halted );
+
+    // with IME clear a pending interrupt ends HALT without being taken
+    int steps = 0;
+    while (CPU::halted && steps < 100)
+    {
+        GameBoy::step();
+        steps++;
+    }
+    REQUIRE( !CPU::halted );
+    REQUIRE( steps < 10 );
+    REQUIRE( Memory::read_8b(0xFF0F) == 0xE4 );
+    GameBoy::step();
+    REQUIRE( CPU::get_pc() == 0x0103 );
+}
+
+TEST_CASE("HALT fast-forward", "[system]") {
+    GameBoy::reset();
+    load({ 0x76, 0x00, 0x00 });
+    Memory::write_8b(0xFFFF, 0x01); // vblank only
+    Memory::write_8b(0xFF0F, 0x00);
+
+    // a single step runs the whole wait up to the start of vblank
+    GameBoy::step();
+    REQUIRE( CPU::halted );
+    GameBoy::step();
+    REQUIRE( !CPU::halted );
+    REQUIRE( Memory::read_8b(0xFF44) == 144 );
+    REQUIRE( CPU::cycles % 4 == 0 );
+
+    // the wait ends at the timer event when that comes first
+    GameBoy::reset();
+    load({ 0x76, 0x00, 0x00 });
+    Memory::write_8b(0xFFFF, 0x05);
+    Memory::write_8b(0xFF0F, 0x00);
+    Memory::write_8b(0xFF04, 0x00);
+    Memory::write_8b(0xFF05, 0xF0);
+    Memory::write_8b(0xFF07, 0x04); // every 1024 cycles
+    uint64_t start = CPU::cycles;
+    GameBoy::step();
+    GameBoy::step();
+    REQUIRE( !CPU::halted );
+    REQUIRE( Memory::read_8b(0xFF0F) == 0xE4 );
+    REQUIRE( CPU::cycles - start == 16 * 1024 + 4 );
+}
+
+TEST_CASE("HALT bug", "[system]") {
+    GameBoy::reset();
+    load({ 0x76, 0x3C, 0x00 }); // HALT, INC A, NOP
+    CPU::set_a(0x00);
+    Memory::write_8b(0xFFFF, 0x04);
+    Memory::write_8b(0xFF0F, 0x04);
+
+    // with IME clear and an interrupt pending HALT falls through and INC A runs twice
+    GameBoy::step();
+    REQUIRE( !CPU::halted );
+    GameBoy::step();
+    GameBoy::step();
+    REQUIRE( CPU::get_a() == 0x02 );
+    REQUIRE( CPU::get_pc() == 0x0103 );
+}
+
+TEST_CASE("STOP", "[system]") {
+    GameBoy::reset();
+    load({ 0x10, 0x00, 0x00 });
+    Memory::write_8b(0xFFFF, 0x00);
+
+    GameBoy::step();
+    REQUIRE( CPU::halted );
+    REQUIRE( Memory::read_8b(0xFF04) == 0x00 );
+}
+
+// run until pc reaches an address, returning the number of steps taken
+static int run_until(const uint16_t &pc, const int &max_steps)
+{
+    int steps = 0;
+    while (CPU::get_pc() != pc && steps < max_steps)
+    {
+        GameBoy::step();
+        steps++;
+    }
+    return steps;
+}
+
+TEST_CASE("Idle loop polling LY", "[system]") {
+    uint64_t cycles[2];
+    int steps[2];
+    uint8_t a[2];
+    for (int i = 0; i < 2; i++)
+    {
+        GameBoy::reset();
+        IdleLoop::set_enabled(i == 1);
+        load({ 0xF0, 0x44, 0xFE, 0x90, 0x20, 0xFA, 0x00, 0x00 }); // LDH A,(LY); CP 144; JR NZ,-6
+        Memory::write_8b(0xFFFF, 0x00);
+
+        steps[i] = run_until(0x0107, 100000);
+        cycles[i] = CPU::cycles;
+        a[i] = CPU::get_a();
+    }
+    IdleLoop::set_enabled(true);
+
+    // the loop exits at exactly the same cycle, in far fewer steps
+    REQUIRE( cycles[0] == cycles[1] );
+    REQUIRE( a[0] == 0x90 );
+    REQUIRE( a[1] == 0x90 );
+    REQUIRE( steps[1] * 4 < steps[0] );
+    REQUIRE( IdleLoop::skipped_cycles() > 0 );
+}
+
+TEST_CASE("Idle loop polling a flag set by an interrupt", "[system]") {
+    uint64_t cycles[2];
+    for (int i = 0; i < 2; i++)
+    {
+        GameBoy::reset();
+        IdleLoop::set_enabled(i == 1);
+        // EI; loop: LD A,(C000); OR A; JR Z,loop
+        load({ 0xFB, 0xFA, 0x00, 0xC0, 0xB7, 0x28, 0xFA, 0x00, 0x00 });
+        // vblank handler: LD A,1; LD (C000),A; RETI
+        const uint8_t handler[] = { 0x3E, 0x01, 0xEA, 0x00, 0xC0, 0xD9 };
+        for (int j = 0; j < 6; j++) { Memory::write(handler[j], static_cast<uint16_t>(0x0040 + j)); }
+        Memory::write_8b(0xC000, 0x00);
+        Memory::write_8b(0xFFFF, 0x01);
+        Memory::write_8b(0xFF0F, 0x00);
+
+        run_until(0x0108, 100000);
+        cycles[i] = CPU::cycles;
+        REQUIRE( CPU::get_pc() == 0x0108 );
+    }
+    IdleLoop::set_enabled(true);
+
+    REQUIRE( cycles[0] == cycles[1] );
+    REQUIRE( IdleLoop::skipped_cycles() > 0 );
+}
+
+TEST_CASE("Loops with side effects are not skipped", "[system]") {
+    GameBoy::reset();
+    // loop: INC (HL); JR loop
+    load({ 0x34, 0x18, 0xFD });
+    CPU::set_h(0xC0);
+    CPU::set_l(0x00);
+    Memory::write_8b(0xC000, 0x00);
+
+    for (int i = 0; i < 100; i++) { GameBoy::step(); }
+    REQUIRE( Memory::read_8b(0xC000) == 50 );
+    REQUIRE( IdleLoop::skipped_cycles() == 0 );
+}
+
+// place a block copy at the entry point, with a source to copy
+static void load_copy(const std::vector<uint8_t> &code)
+{
+    GameBoy::reset();
+    for (size_t i = 0; i < code.size(); i++)
+    {
+        Memory::write(code[i], static_cast<uint16_t>(0x0100 + i));
+    }
+    Memory::write_8b(0xFFFF, 0x00);
+    for (int i = 0; i < 0x300; i++)
+    {
+        Memory::write_8b(0xC000 + i, static_cast<uint8_t>(i * 7 + 1));
+        Memory::write_8b(0xD000 + i, 0x00);
+    }
+}
+
+// run code at the entry point up to pc, either instruction by instruction or through GameBoy::step
+static int run_copy(const std::vector<uint8_t> &code, const uint16_t &end, const bool &system)
+{
+    load_copy(code);
+    int steps = 0;
+    while (CPU::get_pc() != end && steps < 100000)
+    {
+        if (system) { GameBoy::step(); } else { CPU::step(); }
+        steps++;
+    }
+    return steps;
+}
+
+TEST_CASE("Block copy and fill loops run in bulk", "[system]") {
+    const std::vector<uint8_t> loops[] = {
+        // LD HL,C000; LD DE,D000; LD BC,0203; LD A,(HL+); LD (DE),A; INC DE; DEC BC; LD A,B; OR C; JR NZ
+        { 0x21, 0x00, 0xC0, 0x11, 0x00, 0xD0, 0x01, 0x03, 0x02,
+          0x2A, 0x12, 0x13, 0x0B, 0x78, 0xB1, 0x20, 0xF8, 0x00, 0x00 },
+        // LD DE,C000; LD HL,D000; LD BC,0203; LD A,(DE); LD (HL+),A; INC DE; DEC BC; LD A,B; OR C; JP NZ
+        { 0x11, 0x00, 0xC0, 0x21, 0x00, 0xD0, 0x01, 0x03, 0x02,
+          0x1A, 0x22, 0x13, 0x0B, 0x78, 0xB1, 0xC2, 0x09, 0x01, 0x00, 0x00 },
+        // LD HL,C000; LD DE,D000; LD BC,2F00; LD A,(HL+); LD (DE),A; INC DE; DEC B; JR NZ
+        { 0x21, 0x00, 0xC0, 0x11, 0x00, 0xD0, 0x01, 0x00, 0x2F,
+          0x2A, 0x12, 0x13, 0x05, 0x20, 0xFA, 0x00, 0x00, 0x00 },
+        // LD HL,D000; LD C,00; LD A,5A; LD (HL+),A; DEC C; JR NZ
+        { 0x21, 0x00, 0xD0, 0x0E, 0x00, 0x3E, 0x5A,
+          0x22, 0x0D, 0x20, 0xFC, 0x00, 0x00, 0x00 },
+    };
+    const uint16_t ends[] = { 0x0112, 0x0113, 0x0110, 0x010C };
+
+    for (int l = 0; l < 4; l++)
+    {
+        struct registers regs[2];
+        uint64_t cycles[2];
+        int steps[2];
+        uint8_t copied[2][0x300];
+        for (int i = 0; i < 2; i++)
+        {
+            steps[i] = run_copy(loops[l], ends[l], i == 1);
+            regs[i] = CPU::get_registers();
+            cycles[i] = CPU::cycles;
+            for (int j = 0; j < 0x300; j++) { copied[i][j] = Memory::read_8b(0xD000 + j); }
+        }
+
+        // same registers, flags, memory and timing, in far fewer steps
+        REQUIRE( CPU::get_pc() == ends[l] );
+        REQUIRE( regs[0] == regs[1] );
+        REQUIRE( cycles[0] == cycles[1] );
+        REQUIRE( std::equal(copied[0], copied[0] + 0x300, copied[1]) );
+        REQUIRE( steps[1] * 4 < steps[0] );
+    }
+}
+
+TEST_CASE("Block copies to I/O are not run in bulk", "[system]") {
+    // LD HL,C000; LD DE,FF80; LD BC,0040; LD A,(HL+); LD (DE),A; INC DE; DEC BC; LD A,B; OR C; JR NZ
+    const std::vector<uint8_t> code = { 0x21, 0x00, 0xC0, 0x11, 0x80, 0xFF, 0x01, 0x40, 0x00,
+                                       0x2A, 0x12, 0x13, 0x0B, 0x78, 0xB1, 0x20, 0xF8, 0x00, 0x00 };
+    int steps[2];
+    for (int i = 0; i < 2; i++)
+    {
+        steps[i] = run_copy(code, 0x0112, i == 1);
+    }
+    // every iteration still runs, even if some of its pairs are fused
+    REQUIRE( steps[1] > 0x40 * 4 );
+    REQUIRE( Memory::read_8b(0xFF80) == 0x01 );
+    REQUIRE( Memory::read_8b(0xFFBF) == static_cast<uint8_t>(63 * 7 + 1) );
+}
+
+// registers and memory a fused pair may touch, from a seed
+static void seed(const int &i, const std::vector<uint8_t> &code)
+{
+    GameBoy::reset();
+    for (size_t j = 0; j < code.size(); j++)
+    {
+        Memory::write(code[j], static_cast<uint16_t>(0x0100 + j));
+    }
+    const uint8_t v = static_cast<uint8_t>(i * 37 + 11);
+    CPU::set_a(v);
+    CPU::set_b(static_cast<uint8_t>(i & 3));
+    CPU::set_c(static_cast<uint8_t>(v ^ 0x5A));
+    CPU::set_d(0xC1);
+    CPU::set_e(static_cast<uint8_t>(i));
+    CPU::set_h(0xC0);
+    CPU::set_l(static_cast<uint8_t>(v + 3));
+    CPU::set_f(static_cast<uint8_t>((i << 4) & 0xF0));
+    Memory::write_8b(0xC000 + static_cast<uint8_t>(v + 3), static_cast<uint8_t>(v * 3));
+    Memory::write_8b(0xFF80, static_cast<uint8_t>(v + 1));
+    Memory::write_8b(0xFFFF, 0x00);
+}
+
+TEST_CASE("Fused pairs match the instructions they replace", "[system]") {
+    const std::vector<uint8_t> pairs[] = {
+        { 0xFE, 0x05, 0x20, 0x10 }, // CP n; JR NZ
+        { 0xFE, 0x05, 0x28, 0x10 }, // CP n; JR Z
+        { 0xE6, 0x0F, 0x30, 0xF0 }, // AND n; JR NC
+        { 0xC6, 0x80, 0x38, 0x02 }, // ADD A,n; JR C
+        { 0x05, 0x20, 0xFA },       // DEC B; JR NZ
+        { 0x3C, 0x28, 0x02 },       // INC A; JR Z
+        { 0x0D, 0x18, 0x04 },       // DEC C; JR
+        { 0xB1, 0x20, 0xFE },       // OR C; JR NZ
+        { 0x90, 0x38, 0x02 },       // SUB B; JR C
+        { 0x78, 0xB1 },             // LD A,B; OR C
+        { 0x7B, 0xA8 },             // LD A,E; XOR B
+        { 0x2A, 0x12 },             // LD A,(HL+); LD (DE),A
+        { 0xF0, 0x80, 0xFE, 0x33 }, // LDH A,(80); CP n
+    };
+
+    for (const std::vector<uint8_t> &code : pairs)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            seed(i, code);
+            CPU::step();
+            CPU::step();
+            const struct registers plain = CPU::get_registers();
+            const uint64_t cycles = CPU::cycles;
+            const uint8_t stored = Memory::read_8b(0xC100 + i);
+
+            seed(i, code);
+            CPU::step(~0ull);
+            REQUIRE( CPU::get_registers() == plain );
+            REQUIRE( CPU::cycles == cycles );
+            REQUIRE( Memory::read_8b(0xC100 + i) == stored );
+        }
+    }
+}
+
+TEST_CASE("Pairs are not fused across the horizon", "[system]") {
+    seed(0, { 0x05, 0x20, 0xFA }); // DEC B; JR NZ
+    CPU::step(CPU::cycles + 4);
+    REQUIRE( CPU::get_pc() == 0x0102 );
+    REQUIRE( CPU::cycles == 4 );
+    CPU::step(CPU::cycles + 12);
+    REQUIRE( CPU::cycles == 16 );
+}
+
+TEST_CASE("Pair profiler", "[system]") {
+    GameBoy::reset();
+    load({ 0x06, 0x10, 0x05, 0x20, 0xFD, 0x00, 0x00 }); // LD B,10; loop: DEC B; JR NZ,loop
+    Memory::write_8b(0xFFFF, 0x00);
+
+    PairProfiler::reset();
+    PairProfiler::set_enabled(true);
+    run_until(0x0106, 1000);
+    PairProfiler::set_enabled(false);
+
+    REQUIRE( PairProfiler::instructions() == 33 );
+    REQUIRE( PairProfiler::count(0x05, 0x20) == 16 );
+    REQUIRE( PairProfiler::count(0x20, 0x05) == 15 );
+
+    std::vector<PairProfiler::Pair> top = PairProfiler::top(2);
+    REQUIRE( top.size() == 2 );
+    REQUIRE( top[0].first == 0x05 );
+    REQUIRE( top[0].second == 0x20 );
+    REQUIRE( top[1].count == 15 );
+
+    // profiling and counts belong to the thread that ran the instructions
+    bool active = true;
+    uint64_t counted = 1;
+    std::thread other([&] {
+        active = PairProfiler::active();
+        counted = PairProfiler::instructions() + PairProfiler::count(0x05, 0x20) + PairProfiler::top(1).size();
+    });
+    PairProfiler::set_enabled(true);
+    other.join();
+    PairProfiler::set_enabled(false);
+    REQUIRE( !active );
+    REQUIRE( counted == 0 );
+}
+
+TEST_CASE("Opcode profiler", "[system]") {
+    GameBoy::reset();
+    load({ 0x06, 0x10, 0x05, 0x20, 0xFD, 0xCB, 0x37, 0x00 }); // LD B,10; loop: DEC B; JR NZ,loop; SWAP A
+    Memory::write_8b(0xFFFF, 0x00);
+
+    OpcodeProfiler::reset();
+    run_until(0x0108, 1000);
+
+    // fused DEC B; JR NZ pairs count as both instructions
+    REQUIRE( OpcodeProfiler::instructions() == 34 );
+    REQUIRE( OpcodeProfiler::count(0x05) == 16 );
+    REQUIRE( OpcodeProfiler::cycles(0x05) == 16 * 4 );
+    REQUIRE( OpcodeProfiler::count(0x20) == 16 );
+    REQUIRE( OpcodeProfiler::cycles(0x20) == 15 * 12 + 8 );
+    REQUIRE( OpcodeProfiler::count(0x137) == 1 );
+    REQUIRE( OpcodeProfiler::cycles(0x137) == 8 );
+
+    std::vector<OpcodeProfiler::Entry> top = OpcodeProfiler::top(1);
+    REQUIRE( top.size() == 1 );
+    REQUIRE( top[0].opcode == 0x20 );
+
+    // block copies run in bulk count every instruction they replace, as stepping one at a time does
+    // LD HL,C000; LD DE,D000; LD BC,0203; LD A,(HL+); LD (DE),A; INC DE; DEC BC; LD A,B; OR C; JR NZ
+    const std::vector<uint8_t> copy = { 0x21, 0x00, 0xC0, 0x11, 0x00, 0xD0, 0x01, 0x03, 0x02,
+                                        0x2A, 0x12, 0x13, 0x0B, 0x78, 0xB1, 0x20, 0xF8, 0x00, 0x00 };
+    uint64_t counts[2][OpcodeProfiler::opcodes];
+    uint64_t cycles[2][OpcodeProfiler::opcodes];
+    for (int i = 0; i < 2; i++)
+    {
+        OpcodeProfiler::reset();
+        run_copy(copy, 0x0112, i == 1);
+        for (int op = 0; op < OpcodeProfiler::opcodes; op++)
+        {
+            counts[i][op] = OpcodeProfiler::count(op);
+            cycles[i][op] = OpcodeProfiler::cycles(op);
+        }
+    }
+    REQUIRE( counts[0][0x2A] == 0x203 );
+    REQUIRE( std::equal(counts[0], counts[0] + OpcodeProfiler::opcodes, counts[1]) );
+    REQUIRE( std::equal(cycles[0], cycles[0] + OpcodeProfiler::opcodes, cycles[1]) );
+
+    // a fused pair writing over itself counts the opcodes it fetched, not what it left behind
+    // LD HL,D000; LD DE,C000; JP C000, to LD A,(HL+); LD (DE),A; NOP
+    GameBoy::reset();
+    load({ 0x21, 0x00, 0xD0, 0x11, 0x00, 0xC0, 0xC3, 0x00, 0xC0 });
+    const uint8_t pair[] = { 0x2A, 0x12, 0x00 };
+    for (int i = 0; i < 3; i++) { Memory::write_8b(0xC000 + i, pair[i]); }
+    Memory::write_8b(0xD000, 0x3C);
+    Memory::write_8b(0xFFFF, 0x00);
+
+    OpcodeProfiler::reset();
+    run_until(0xC003, 100);
+    REQUIRE( Memory::read_8b(0xC000) == 0x3C );
+    REQUIRE( OpcodeProfiler::count(0x2A) == 1 );
+    REQUIRE( OpcodeProfiler::count(0x12) == 1 );
+    REQUIRE( OpcodeProfiler::count(0x3C) == 0 );
+}
+
+TEST_CASE("Guest profiler", "[system]") {
+    GameBoy::reset();
+    load({ 0xCD, 0x00, 0x02, 0x18, 0xFB }); // Main: CALL Outer; JR Main
+    const uint8_t outer[] = { 0xCD, 0x00, 0x03, 0xC9 }; // Outer: CALL Inner; RET
+    const uint8_t inner[] = { 0x06, 0x40, 0x05, 0x20, 0xFD, 0xC9 }; // Inner: LD B,40; loop: DEC B; JR NZ,loop; RET
+    for (int i = 0; i < 4; i++) { Memory::write(outer[i], static_cast<uint16_t>(0x0200 + i)); }
+    for (int i = 0; i < 6; i++) { Memory::write(inner[i], static_cast<uint16_t>(0x0300 + i)); }
+    Memory::write_8b(0xFFFF, 0x00);
+
+    const std::string path = "systemtest.sym";
+    {
+        std::ofstream sym(path);
+        sym << "; File generated by rgblink\n00:0100 Main\n00:0200 Outer\n00:0300 Inner\n";
+    }
+    REQUIRE( GuestProfiler::load_symbols(path) );
+    std::remove(path.c_str());
+
+    REQUIRE( GuestProfiler::name(0, 0x0304) == "Inner" );
+    REQUIRE( GuestProfiler::name(0, 0x00FF) == "00:00FF" );
+    REQUIRE( GuestProfiler::name(0, 0xC000) == "00:C000" );
+    REQUIRE( GuestProfiler::name(1, 0x4000) == "01:4000" );
+
+    GuestProfiler::reset();
+    REQUIRE( !GuestProfiler::start(0) );
+    REQUIRE( !GuestProfiler::active() );
+    REQUIRE( GuestProfiler::start(64) );
+    for (int i = 0; i < 20000; i++) { GameBoy::step(); }
+    GuestProfiler::stop();
+
+    std::stringstream out;
+    GuestProfiler::write_collapsed(out);
+    std::map<std::string, uint64_t> stacks;
+    std::string stack;
+    uint64_t count;
+    uint64_t total = 0;
+    while (out >> stack >> count)
+    {
+        stacks[stack] = count;
+        total += count;
+    }
+
+    // calls are followed back out again, and most of the time is spent in the innermost loop
+    REQUIRE( GuestProfiler::samples() > 0 );
+    REQUIRE( total == GuestProfiler::samples() );
+    for (const auto &s : stacks)
+    {
+        REQUIRE( (s.first == "Main" || s.first == "Main;Outer" || s.first == "Main;Outer;Inner") );
+    }
+    REQUIRE( stacks["Main;Outer;Inner"] * 10 > total * 9 );
+}
+
+TEST_CASE("Coverage per bank", "[system]") {
+    // banks 1-3 each hold a routine at 4000, of which bank 2 skips over its middle
+    Assembler a(4);
+    for (int bank = 1; bank < 4; bank++)
+    {
+        a.section(bank, 0x4000);
+        Label end = a.label();
+        if (bank == 2)
+        {
+            a.jr(end);
+        }
+        a.nop();
+        a.nop();
+        a.bind(end);
+        a.ret();
+    }
+
+    // call banks 1 and 2, never 3, count down in fused pairs, then copy and fill blocks in bulk
+    a.section(0, 0x0100);
+    Label main = a.label();
+    a.jp(main);
+    a.org(0x0150);
+    a.bind(main);
+    for (uint8_t bank : { 1, 2 })
+    {
+        a.ld(R8::A, bank);
+        a.ld_mem_a(0x2000);
+        a.call(a.at(0x4000));
+    }
+    a.ld(R8::B, static_cast<uint8_t>(0x20));
+    const uint16_t count = a.here();
+    Label count_loop = a.mark();
+    a.dec(R8::B);
+    a.jr(Cond::NZ, count_loop);
+    a.ld(R16::HL, static_cast<uint16_t>(0xC000));
+    a.ld(R16::DE, static_cast<uint16_t>(0xD000));
+    a.ld(R16::BC, static_cast<uint16_t>(0x0100));
+    const uint16_t copy = a.here();
+    Label copy_loop = a.mark();
+    a.ld_a_hli();
+    a.ld_ind_a(R16::DE);
+    a.inc(R16::DE);
+    a.dec(R16::BC);
+    a.ld(R8::A, R8::B);
+    a.alu(Alu::OR, R8::C);
+    a.jr(Cond::NZ, copy_loop);
+    a.ld(R8::B, static_cast<uint8_t>(0x80));
+    const uint16_t fill = a.here();
+    Label fill_loop = a.mark();
+    a.ld_hli_a();
+    a.dec(R8::B);
+    a.jp(Cond::NZ, fill_loop);
+    a.di();
+    const uint16_t end = a.here();
+    a.halt();
+
+    std::vector<uint8_t> image;
+    REQUIRE( a.build(image) );
+
+    // once through GameBoy::step, then on the plain instruction stream the pair profiler forces
+    std::vector<uint8_t> bitmaps[2];
+    int steps[2];
+    for (int i = 0; i < 2; i++)
+    {
+        GameBoy::reset();
+        REQUIRE( Memory::load_rom(image) );
+        PairProfiler::set_enabled(i == 1);
+        for (steps[i] = 0; steps[i] < 100000 && !CPU::halted; steps[i]++)
+        {
+            GameBoy::step();
+        }
+        PairProfiler::set_enabled(false);
+        REQUIRE( CPU::halted );
+        bitmaps[i] = Coverage::bitmap();
+    }
+
+    // fused pairs and bulk loops mark every instruction they replace, and nothing else
+    REQUIRE( steps[0] * 4 < steps[1] );
+    REQUIRE( bitmaps[0] == bitmaps[1] );
+
+    REQUIRE( Coverage::covered(0, 0x0100) );
+    REQUIRE( !Coverage::covered(0, 0x0101) );
+    REQUIRE( Coverage::covered(0, end) );
+    REQUIRE( Coverage::covered(1, 0x4000) );
+    REQUIRE( Coverage::covered(1, 0x4001) );
+    REQUIRE( Coverage::covered(2, 0x4000) );
+    REQUIRE( !Coverage::covered(2, 0x4002) );
+    REQUIRE( Coverage::covered(2, 0x4004) );
+    REQUIRE( !Coverage::covered(3, 0x4000) );
+
+    // opcodes of each loop, never the operands of its branch
+    REQUIRE( Coverage::covered(0, count) );
+    REQUIRE( Coverage::covered(0, count + 1) );
+    REQUIRE( !Coverage::covered(0, count + 2) );
+    for (uint16_t i = 0; i < 7; i++)
+    {
+        REQUIRE( Coverage::covered(0, copy + i) );
+    }
+    REQUIRE( !Coverage::covered(0, copy + 7) );
+    for (uint16_t i = 0; i < 3; i++)
+    {
+        REQUIRE( Coverage::covered(0, fill + i) );
+    }
+    REQUIRE( !Coverage::covered(0, fill + 3) );
+    REQUIRE( !Coverage::covered(0, fill + 4) );
+
+    const std::string path = "systemtest_coverage.bin";
+    REQUIRE( Coverage::dump(path) );
+    std::ifstream f(path, std::ios::binary);
+    std::vector<uint8_t> file((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    f.close();
+    std::remove(path.c_str());
+
+    REQUIRE( file.size() == Coverage::header_size + (4 * 0x4000 + 0x8000) / 8 );
+    REQUIRE( std::string(file.begin(), file.begin() + 4) == "GBCV" );
+    REQUIRE( file[6] == 4 );
+    REQUIRE( std::vector<uint8_t>(file.begin() + Coverage::header_size, file.end()) == Coverage::bitmap() );
+
+    // another cartridge of the same size starts from an empty bitmap
+    REQUIRE( Memory::load_rom(std::vector<uint8_t>(4 * 0x4000, 0x00)) );
+    REQUIRE( Coverage::count() == 0 );
+
+    // back to a flat 32 KiB cartridge for the tests after
+    REQUIRE( Memory::load_rom(std::vector<uint8_t>(0x8000, 0x00)) );
+}
+
+TEST_CASE("Breakpoints", "[system]") {
+    GameBoy::reset();
+    // LD B,10; loop: DEC B; JR NZ,loop; LD A,5A; LD (C000),A; LD A,(C001); JR -2
+    load({ 0x06, 0x10, 0x05, 0x20, 0xFD, 0x3E, 0x5A, 0xEA, 0x00, 0xC0, 0xFA, 0x01, 0xC0, 0x18, 0xFE });
+    Memory::write_8b(0xFFFF, 0x00);
+
+    // the second instruction of a pair that is otherwise fused
+    Debugger::add_breakpoint(0x0103);
+    for (int i = 0; i < 3; i++)
+    {
+        GameBoy::run_frame();
+        REQUIRE( Debugger::stopped() );
+        REQUIRE( Debugger::hit().kind == Debugger::BREAK );
+        REQUIRE( Debugger::hit().address == 0x0103 );
+        REQUIRE( CPU::get_pc() == 0x0104 );
+        REQUIRE( CPU::get_b() == 0x0F - i );
+
+        // stepping stays put until resumed
+        GameBoy::step();
+        REQUIRE( CPU::get_pc() == 0x0104 );
+        Debugger::resume();
+    }
+    Debugger::remove_breakpoint(0x0103);
+    REQUIRE( !Debugger::active() );
+
+    Debugger::add_watchpoint(0xC000, Debugger::WRITE);
+    Debugger::add_watchpoint(0xC001, Debugger::READ);
+    GameBoy::run_frame();
+    REQUIRE( Debugger::stopped() );
+    REQUIRE( Debugger::hit().kind == Debugger::WRITE );
+    REQUIRE( Debugger::hit().address == 0xC000 );
+    REQUIRE( Debugger::hit().value == 0x5A );
+    REQUIRE( CPU::get_b() == 0x00 );
+    REQUIRE( CPU::get_pc() == 0x010B );
+
+    Debugger::resume();
+    GameBoy::run_frame();
+    REQUIRE( Debugger::stopped() );
+    REQUIRE( Debugger::hit().kind == Debugger::READ );
+    REQUIRE( Debugger::hit().address == 0xC001 );
+    REQUIRE( CPU::get_pc() == 0x010E );
+
+    // with every point gone nothing stops, nor takes the slow path
+    Debugger::clear();
+    REQUIRE( !Debugger::stopped() );
+    REQUIRE( !Memory::flagged(0xC000, Memory::page_debug) );
+    REQUIRE( !Memory::flagged(0x0100, Memory::page_debug) );
+    GameBoy::run_frame();
+    REQUIRE( !Debugger::stopped() );
+
+    // a watched I/O register reports the byte the read returns, here DIV counted up since reset
+    GameBoy::reset();
+    load({ 0x06, 0x40, 0x05, 0x20, 0xFD, 0xF0, 0x04, 0x18, 0xFE }); // LD B,40; loop: DEC B; JR NZ,loop; LDH A,(DIV); JR -2
+    Memory::write_8b(0xFFFF, 0x00);
+    Debugger::add_watchpoint(0xFF04, Debugger::READ);
+    GameBoy::run_frame();
+    REQUIRE( Debugger::stopped() );
+    REQUIRE( Debugger::hit().address == 0xFF04 );
+    REQUIRE( CPU::get_a() != 0xAB );
+    REQUIRE( Debugger::hit().value == CPU::get_a() );
+    Debugger::clear();
+}
+
+TEST_CASE("Watchpoints in a block copy", "[system]") {
+    // LD HL,C000; LD DE,D000; LD BC,0203; LD A,(HL+); LD (DE),A; INC DE; DEC BC; LD A,B; OR C; JR NZ
+    const std::vector<uint8_t> copy = { 0x21, 0x00, 0xC0, 0x11, 0x00, 0xD0, 0x01, 0x03, 0x02,
+                                        0x2A, 0x12, 0x13, 0x0B, 0x78, 0xB1, 0x20, 0xF8, 0x00, 0x00 };
+
+    // the copy stops right after the watched byte is written, not in the middle of a bulk run
+    load_copy(copy);
+    Debugger::add_watchpoint(0xD180, Debugger::WRITE);
+    GameBoy::run_frame();
+    REQUIRE( Debugger::stopped() );
+    REQUIRE( Debugger::hit().address == 0xD180 );
+    REQUIRE( Memory::read_8b(0xD180) == static_cast<uint8_t>(0x180 * 7 + 1) );
+    REQUIRE( Memory::read_8b(0xD181) == 0x00 );
+    REQUIRE( CPU::get_pc() == 0x010C );
+    Debugger::clear();
+
+    // reads of a watched source page are seen too
+    load_copy(copy);
+    Debugger::add_watchpoint(0xC042, Debugger::READ);
+    GameBoy::run_frame();
+    REQUIRE( Debugger::stopped() );
+    REQUIRE( Debugger::hit().value == static_cast<uint8_t>(0x42 * 7 + 1) );
+    REQUIRE( Memory::read_8b(0xD041) == static_cast<uint8_t>(0x41 * 7 + 1) );
+    REQUIRE( Memory::read_8b(0xD042) == 0x00 );
+    REQUIRE( CPU::get_pc() == 0x010B );
+    Debugger::clear();
+}
+
+TEST_CASE("Execution trace", "[system]") {
+    const std::string path = "systemtest_trace.bin";
+
+    // records go through the ring and the writer thread in order, twice the ring's size so it fills up
+    const uint32_t records = 0x20000;
+    REQUIRE( Tracer::start(path) );
+    REQUIRE( !Tracer::start(path) );
+    for (uint32_t i = 0; i < records; i++)
+    {
+        const uint16_t n = static_cast<uint16_t>(i);
+        Tracer::record(i * 4, n, static_cast<uint8_t>(i), static_cast<uint8_t>(i >> 8), 0xCB,
+                       { n, static_cast<uint16_t>(n + 1), static_cast<uint16_t>(n + 2), static_cast<uint16_t>(n + 3),
+                         static_cast<uint16_t>(n + 4), 0 });
+    }
+    Tracer::stop();
+    REQUIRE( !Tracer::active() );
+
+    std::ifstream f(path, std::ios::binary);
+    std::vector<uint8_t> file((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    f.close();
+    std::remove(path.c_str());
+
+    REQUIRE( file.size() == Tracer::header_size + records * Tracer::record_size );
+    REQUIRE( std::equal(file.begin(), file.begin() + 4, "GBTR") );
+    REQUIRE( (file[4] | file[5] << 8) == Tracer::version );
+    REQUIRE( (file[6] | file[7] << 8) == Tracer::record_size );
+
+    bool ordered = true;
+    for (uint32_t i = 0; i < records; i++)
+    {
+        const TraceRecord r = Tracer::decode(file.data() + Tracer::header_size + i * Tracer::record_size);
+        const uint16_t n = static_cast<uint16_t>(i);
+        ordered = ordered && r.cycle == i * 4 && r.pc == n && r.bytes[0] == static_cast<uint8_t>(i) &&
+                  r.bytes[1] == static_cast<uint8_t>(i >> 8) && r.bytes[2] == 0xCB && r.af == n && r.bc == static_cast<uint16_t>(n + 1) &&
+                  r.de == static_cast<uint16_t>(n + 2) && r.hl == static_cast<uint16_t>(n + 3) &&
+                  r.sp == static_cast<uint16_t>(n + 4);
+    }
+    REQUIRE( ordered );
+
+#ifdef GAMEBOY_TRACE
+    // with the CPU hook built in, GameBoy::step records every instruction, none lost to fused pairs
+    GameBoy::reset();
+    load({ 0x06, 0x10, 0x05, 0x20, 0xFD, 0x00, 0x00 }); // LD B,10; loop: DEC B; JR NZ,loop
+    Memory::write_8b(0xFFFF, 0x00);
+
+    REQUIRE( Tracer::start(path) );
+    run_until(0x0106, 1000);
+    Tracer::stop();
+
+    f.open(path, std::ios::binary);
+    file.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    f.close();
+    std::remove(path.c_str());
+
+    REQUIRE( file.size() == Tracer::header_size + 33 * Tracer::record_size );
+
+    TraceRecord first = Tracer::decode(file.data() + Tracer::header_size);
+    REQUIRE( first.pc == 0x0100 );
+    REQUIRE( first.bytes[0] == 0x06 );
+    REQUIRE( first.bytes[1] == 0x10 );
+    REQUIRE( first.bytes[2] == 0x05 );
+
+    // registers before each instruction ran, cycles counting up from the first
+    TraceRecord second = Tracer::decode(file.data() + Tracer::header_size + Tracer::record_size);
+    REQUIRE( second.pc == 0x0102 );
+    REQUIRE( second.bc >> 8 == 0x10 );
+    REQUIRE( second.cycle == first.cycle + 8 );
+
+    TraceRecord last = Tracer::decode(file.data() + file.size() - Tracer::record_size);
+    REQUIRE( last.pc == 0x0103 );
+    REQUIRE( last.bc >> 8 == 0x00 );
+#endif
+}
@@ -0,0 +1,210 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gameboy-emulator/core/bus_recorder.hpp"
+#include "gameboy-emulator/core/cpu.hpp"
+#include "gameboy-emulator/core/memory.hpp"
+
+#include "cpu_vectors.hpp"
+
+using namespace emulator;
+
+static void set_initial(const vectors::State &s)
+{
+    CPU::set_a(s.a);
+    CPU::set_b(s.b);
+    CPU::set_c(s.c);
+    CPU::set_d(s.d);
+    CPU::set_e(s.e);
+    CPU::set_f(s.f);
+    CPU::set_h(s.h);
+    CPU::set_l(s.l);
+
+    CPU::set_pc(s.pc);
+    CPU::set_sp(s.sp);
+
+    for (int i = 0; i < s.ram_entries; i++)
+    {
+        const uint8_t *entry = s.ram + i * 3;
+        Memory::write(entry[2], vectors::read_16(entry));
+    }
+}
+
+// empty if the CPU matches the final state, otherwise a description of the first mismatch
+static std::string check_final(const vectors::State &s)
+{
+    std::ostringstream out;
+    auto check = [&out](const char *name, const int &got, const int &want)
+    {
+        if (got != want && out.tellp() == 0)
+        {
+            out << name << ": " << got << " vs " << want;
+        }
+    };
+
+    check("a", CPU::get_a(), s.a);
+    check("b", CPU::get_b(), s.b);
+    check("c", CPU::get_c(), s.c);
+    check("d", CPU::get_d(), s.d);
+    check("e", CPU::get_e(), s.e);
+    check("f", CPU::get_f(), s.f);
+    check("h", CPU::get_h(), s.h);
+    check("l", CPU::get_l(), s.l);
+    check("pc", CPU::get_pc(), s.pc);
+    check("sp", CPU::get_sp(), s.sp);
+
+    for (int i = 0; i < s.ram_entries; i++)
+    {
+        const uint8_t *entry = s.ram + i * 3;
+        const uint16_t address = vectors::read_16(entry);
+        check(("ram " + std::to_string(address)).c_str(), *Memory::get_8b(address), entry[2]);
+    }
+    return out.str();
+}
+
+#ifdef GAMEBOY_BUS_RECORDER
+// operand bytes following each opcode, which the CPU is handed rather than reading over the bus
+static int operands(const uint8_t &opcode)
+{
+    switch (opcode)
+    {
+        case 0x01: case 0x08: case 0x11: case 0x21: case 0x31:
+        case 0xC2: case 0xC3: case 0xC4: case 0xCA: case 0xCC: case 0xCD:
+        case 0xD2: case 0xD4: case 0xDA: case 0xDC: case 0xEA: case 0xFA:
+            return 2;
+        case 0x06: case 0x0E: case 0x10: case 0x16: case 0x18: case 0x1E:
+        case 0x20: case 0x26: case 0x28: case 0x2E: case 0x30: case 0x36: case 0x38: case 0x3E:
+        case 0xC6: case 0xCB: case 0xCE: case 0xD6: case 0xDE: case 0xE0: case 0xE6: case 0xE8:
+        case 0xEE: case 0xF0: case 0xF6: case 0xF8: case 0xFE:
+            return 1;
+        default:
+            return 0;
+    }
+}
+#endif
+
+// empty if the M-cycle count and the data accesses recorded match the vector's cycles
+//
+// every vector's cycles start with its operand reads and end with the fetch of the next opcode,
+// the accesses in between and the number of idle cycles depend on the instruction
+static std::string check_cycles(const vectors::Vector &v, const uint64_t &taken)
+{
+    std::ostringstream out;
+    if (taken != v.cycle_entries * 4u)
+    {
+        out << "took " << taken << " cycles vs " << v.cycle_entries * 4;
+        return out.str();
+    }
+#ifdef GAMEBOY_BUS_RECORDER
+    size_t recorded = 0;
+    for (int i = operands(v.bytes[0]); i < v.cycle_entries - 1; i++)
+    {
+        const uint8_t *cycle = v.cycles + i * 4;
+        if (cycle[3] == vectors::IDLE)
+        {
+            continue;
+        }
+        if (recorded >= BusRecorder::count())
+        {
+            out << "missing access to " << vectors::read_16(cycle);
+            return out.str();
+        }
+
+        const BusRecorder::Event &e = BusRecorder::event(recorded++);
+        if (e.address != vectors::read_16(cycle) || e.value != cycle[2] || e.kind != cycle[3])
+        {
+            out << (e.kind == BusRecorder::WRITE ? "write " : "read ") << e.address << " = " << e.value + 0
+                << " vs " << (cycle[3] == vectors::WRITE ? "write " : "read ") << vectors::read_16(cycle)
+                << " = " << cycle[2] + 0;
+            return out.str();
+        }
+    }
+    if (recorded != BusRecorder::count())
+    {
+        out << "extra access to " << BusRecorder::event(recorded).address;
+    }
+#endif
+    return out.str();
+}
+
+// run every vector of one opcode file on the calling thread's CPU
+static void run_file(const vectors::File &file, const size_t &i, std::vector<std::string> &failures)
+{
+    const uint8_t *p = file.first(i);
+    for (uint32_t n = 0; n < file.count(i); n++)
+    {
+        vectors::Vector v;
+        p = vectors::read_vector(p, v);
+
+        set_initial(v.initial);
+        const uint64_t start = CPU::cycles;
+#ifdef GAMEBOY_BUS_RECORDER
+        BusRecorder::start();
+#endif
+        CPU::instruction(v.bytes[0], v.bytes[1], v.bytes[2], 0x00);
+#ifdef GAMEBOY_BUS_RECORDER
+        BusRecorder::stop();
+#endif
+
+        std::string mismatch = check_final(v.final);
+        if (mismatch.empty())
+        {
+            mismatch = check_cycles(v, CPU::cycles - start);
+        }
+        if (!mismatch.empty())
+        {
+            std::ostringstream out;
+            out << std::hex << v.bytes[0] + 0 << " " << v.bytes[1] + 0 << " " << v.bytes[2] + 0 << ": " << mismatch;
+            failures.push_back(out.str());
+        }
+    }
+}
+
+TEST_CASE("Packed CPU vectors", "[core]")
+{
+    vectors::File file;
+    REQUIRE(file.open(CPUVECTORS_FILE));
+    REQUIRE(file.files() > 0);
+
+    // CPU and memory state is per thread, so each worker is an independent CPU
+    const size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    std::atomic<size_t> next(0);
+    std::vector<std::vector<std::string>> failures(workers);
+    std::vector<std::thread> threads;
+    for (size_t w = 0; w < workers; w++)
+    {
+        threads.emplace_back([&file, &next, &failures, w]()
+        {
+            for (size_t i = next++; i < file.files(); i = next++)
+            {
+                run_file(file, i, failures[w]);
+            }
+        });
+    }
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+
+    // catch assertions are only made from this thread
+    size_t failed = 0;
+    for (const std::vector<std::string> &list : failures)
+    {
+        for (const std::string &f : list)
+        {
+            if (failed++ < 20)
+            {
+                UNSCOPED_INFO(f);
+            }
+        }
+    }
+    REQUIRE(failed == 0);
+}
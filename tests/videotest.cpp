@@ -0,0 +1,161 @@
+#define CATCH_CONFIG_MAIN
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "gameboy-emulator/core/memory.hpp"
+#include "gameboy-emulator/core/oam.hpp"
+#include "gameboy-emulator/core/ppu.hpp"
+#include "gameboy-emulator/core/video.hpp"
+
+using namespace emulator;
+
+void run_frame()
+{
+    // 154 lines of 456 dots, starting and ending at ly 0
+    for (int i = 0; i < 154; i++)
+    {
+        PPU::tick(456);
+    }
+}
+
+int count_dirty()
+{
+    return static_cast<int>(PPU::dirty_lines().count());
+}
+
+TEST_CASE("Damage tracking", "[video]") {
+    Memory::write((uint8_t)0x91, (uint16_t)0xFF40); // lcd on, bg on, tiles at 0x8000
+    Memory::write((uint8_t)0xE4, (uint16_t)0xFF47);
+
+    run_frame();
+    REQUIRE( count_dirty() == PPU::height ); // first frame is entirely new
+
+    run_frame();
+    REQUIRE( count_dirty() == 0 );
+
+    // first row of tile 0 covers every eighth line
+    Memory::write((uint8_t)0xFF, (uint16_t)0x8000);
+    run_frame();
+    REQUIRE( count_dirty() == PPU::height / 8 );
+    REQUIRE( PPU::line_dirty(0) );
+    REQUIRE( PPU::line_dirty(8) );
+    REQUIRE( !PPU::line_dirty(1) );
+    REQUIRE( PPU::framebuffer[0][0] == 1 );
+
+    run_frame();
+    REQUIRE( count_dirty() == 0 );
+
+    // palette changes alter every line without touching the pixel indices
+    Memory::write((uint8_t)0x1B, (uint16_t)0xFF47);
+    run_frame();
+    REQUIRE( count_dirty() == PPU::height );
+
+    PPU::invalidate();
+    REQUIRE( count_dirty() == PPU::height );
+    run_frame();
+    REQUIRE( count_dirty() == PPU::height );
+    run_frame();
+    REQUIRE( count_dirty() == 0 );
+}
+
+TEST_CASE("Object priority", "[video]") {
+    Memory::write((uint8_t)0x93, (uint16_t)0xFF40); // objects on
+    for (int i = 0; i < 16; i++)
+    {
+        Memory::write((uint8_t)0xFF, (uint16_t)(0x8010 + i)); // tile 1 solid colour 3
+        Memory::write((uint8_t)0xFF, (uint16_t)(0x8020 + (i & 0xE))); // tile 2 solid colour 1
+        Memory::write((uint8_t)0x00, (uint16_t)(0x8020 + (i | 1)));
+    }
+
+    // object 0 at x 20 with tile 2, object 1 at x 16 with tile 1 using obp1
+    Memory::write((uint8_t)16, (uint16_t)0xFE00);
+    Memory::write((uint8_t)20, (uint16_t)0xFE01);
+    Memory::write((uint8_t)2, (uint16_t)0xFE02);
+    Memory::write((uint8_t)0x00, (uint16_t)0xFE03);
+    Memory::write((uint8_t)16, (uint16_t)0xFE04);
+    Memory::write((uint8_t)16, (uint16_t)0xFE05);
+    Memory::write((uint8_t)1, (uint16_t)0xFE06);
+    Memory::write((uint8_t)0x10, (uint16_t)0xFE07);
+
+    PPU::render_line(0);
+    REQUIRE( PPU::framebuffer[0][8] == ((2 << 2) | 3) ); // lower x wins the overlap
+    REQUIRE( PPU::framebuffer[0][15] == ((2 << 2) | 3) );
+    REQUIRE( PPU::framebuffer[0][16] == ((1 << 2) | 1) );
+    REQUIRE( PPU::framebuffer[0][7] == 1 ); // background
+}
+
+TEST_CASE("Object selection", "[video]") {
+    uint8_t table[160];
+    uint32_t seed = 1;
+    for (int round = 0; round < 2000; round++)
+    {
+        for (int i = 0; i < 160; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            table[i] = static_cast<uint8_t>(seed >> 16);
+            if (i % 4 == 1 && round % 2) { table[i] &= 0x0F; } // force x ties
+        }
+        uint8_t ly = static_cast<uint8_t>(round % 154);
+        uint8_t size = (round % 3) ? 8 : 16;
+
+        // reference: first 10 overlapping objects in oam order, stable sorted by x
+        std::vector<uint8_t> expected;
+        for (int i = 0; i < 40 && expected.size() < 10; i++)
+        {
+            if (static_cast<uint8_t>(ly + 16 - table[i * 4]) < size)
+            {
+                expected.push_back(i);
+            }
+        }
+        std::stable_sort(expected.begin(), expected.end(), [&](uint8_t a, uint8_t b) {
+            return table[a * 4 + 1] < table[b * 4 + 1];
+        });
+
+        uint8_t selected[10];
+        int n = oam::select(table, ly, size, selected);
+        REQUIRE( std::vector<uint8_t>(selected, selected + n) == expected );
+    }
+}
+
+TEST_CASE("Pixel formats", "[video]") {
+    const uint8_t pixels[5] = { 0, 1, 2, 3, (1 << 2) | 3 };
+    std::memset(PPU::framebuffer[5], 0, PPU::width);
+    std::memcpy(PPU::framebuffer[5], pixels, sizeof(pixels));
+    PPU::palettes[5][0] = 0xE4; // identity
+    PPU::palettes[5][1] = 0x1B; // reversed
+    PPU::palettes[5][2] = 0x00;
+
+    uint8_t rgba[PPU::width * 4];
+    video::convert_line(video::PixelFormat::RGBA8888, 5, rgba);
+    REQUIRE( rgba[0] == 0xFF );
+    REQUIRE( rgba[3] == 0xFF );
+    REQUIRE( rgba[4] == 0xAA );
+    REQUIRE( rgba[12] == 0x00 );
+    REQUIRE( rgba[16] == 0xFF ); // obp0 maps colour 3 to shade 0
+
+    uint16_t rgb565[PPU::width];
+    video::convert_line(video::PixelFormat::RGB565, 5, reinterpret_cast<uint8_t *>(rgb565));
+    REQUIRE( rgb565[0] == 0xFFFF );
+    REQUIRE( rgb565[3] == 0x0000 );
+
+    uint8_t gray[PPU::width];
+    video::convert_line(video::PixelFormat::GRAY8, 5, gray);
+    REQUIRE( gray[1] == 0xAA );
+    REQUIRE( gray[2] == 0x55 );
+
+    uint8_t packed[PPU::width / 4];
+    video::convert_line(video::PixelFormat::INDEX2, 5, packed);
+    REQUIRE( packed[0] == 0x1B );
+    REQUIRE( packed[1] == 0xC0 ); // the colour index, not the shade obp0 maps it to
+
+    std::bitset<PPU::height> lines;
+    lines.set(5);
+    uint8_t frame[PPU::height][PPU::width] = {};
+    REQUIRE( video::convert(video::PixelFormat::GRAY8, &frame[0][0], PPU::width, lines) == 1 );
+    REQUIRE( frame[5][2] == 0x55 );
+    REQUIRE( frame[4][2] == 0x00 );
+}